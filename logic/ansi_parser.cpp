@@ -0,0 +1,43 @@
+#include "ansi_parser.h"
+
+#include <algorithm>
+
+void Ansi_parser::reset() {
+	state = State::ground;
+	sequence.clear();
+	sequence_overflow = false;
+}
+
+bool Ansi_parser::is_in_sequence() const {
+	return state != State::ground || sequence.empty() == false;
+}
+
+const char *Ansi_parser::get_complete_utf8_end(const char *begin, const char *end) {
+	//a UTF-8 character is at most 4 bytes long, so only the last 3 bytes can belong to an incomplete character
+	for (auto position = end; position != begin && end - position < 4;) {
+		const auto byte = static_cast<unsigned char>(*--position);
+		if ((byte & 0xC0) == 0x80) { //continuation byte
+			continue;
+		}
+		const auto size = byte >= 0xF0 ? 4 : byte >= 0xE0 ? 3 : byte >= 0xC0 ? 2 : 1;
+		return end - position < size ? position : end;
+	}
+	return end;
+}
+
+void Ansi_parser::append(char c) {
+	if (sequence.size() < max_sequence_size) {
+		sequence += c;
+	} else {
+		sequence_overflow = true;
+	}
+}
+
+void Ansi_parser::append(std::string_view data) {
+	if (sequence.data() == data.data()) { //already in there
+		return;
+	}
+	const auto size = std::min(data.size(), max_sequence_size - std::min(sequence.size(), max_sequence_size));
+	sequence.append(data.data(), size);
+	sequence_overflow = sequence_overflow || size < data.size();
+}
@@ -0,0 +1,195 @@
+#ifndef ANSI_PARSER_H
+#define ANSI_PARSER_H
+
+#include <cstddef>
+#include <cstring>
+#include <string>
+#include <string_view>
+
+/* Splits the output of a tool into text and VT/ANSI escape sequences.
+ * Output arrives in arbitrary chunks, so a sequence or a UTF-8 encoded character may be split between two calls of feed. The parser keeps the
+ * incomplete part and finishes it with the next chunk, so the handler only ever sees whole sequences and whole characters.
+ * A Handler needs these functions, derive from Ansi_parser::Default_handler to ignore what you don't need:
+ *	on_text(std::string_view text)                                            UTF-8 text including control characters other than ESC
+ *	on_control_sequence(std::string_view parameters, char final_byte)         CSI parameters and intermediates, for example "1;31" and 'm'
+ *	on_escape_sequence(std::string_view intermediates, char final_byte)       other escape sequences such as ESC c or ESC ( B
+ *	on_operating_system_command(std::string_view command)                     OSC such as "0;window title" */
+class Ansi_parser {
+	public:
+	struct Default_handler {
+		void on_text(std::string_view) {}
+		void on_control_sequence(std::string_view, char) {}
+		void on_escape_sequence(std::string_view, char) {}
+		void on_operating_system_command(std::string_view) {}
+	};
+	constexpr static std::size_t max_sequence_size = 4096; //longer sequences are garbage and get dropped
+
+	template <class Handler>
+	void feed(std::string_view data, Handler &&handler);
+	void reset();
+	bool is_in_sequence() const; //true if the last chunk ended inside an escape sequence or character
+
+	private:
+	enum class State : unsigned char {
+		ground,
+		escape,
+		control_sequence,
+		operating_system_command,
+		ignored_string,        //DCS, SOS, PM and APC which we don't support
+		string_escape,         //ESC inside a string, which is the start of the string terminator ESC \ or a new sequence
+	};
+
+	static const char *get_complete_utf8_end(const char *begin, const char *end);
+	void append(char c);
+	void append(std::string_view data);
+
+	State state{State::ground};
+	State string_state{State::ground}; //the string an ESC in State::string_escape belongs to
+	std::string sequence;              //the incomplete sequence or incomplete UTF-8 character so far
+	bool sequence_overflow{false};
+};
+
+template <class Handler>
+void Ansi_parser::feed(std::string_view data, Handler &&handler) {
+	constexpr char escape = '\033';
+	constexpr char bell = '\a';
+	constexpr char cancel = '\030';
+	constexpr char substitute = '\032';
+	const char *position = data.data();
+	const char *const end = position + data.size();
+	while (position != end) {
+		switch (state) {
+			case State::ground: {
+				if (sequence.empty() == false) { //finish the character that was split by the last chunk
+					const auto lead = static_cast<unsigned char>(sequence.front());
+					const std::size_t size = lead >= 0xF0 ? 4 : lead >= 0xE0 ? 3 : 2;
+					while (sequence.size() < size && position != end && (static_cast<unsigned char>(*position) & 0xC0) == 0x80) {
+						sequence += *position++;
+					}
+					if (sequence.size() < size && position == end) {
+						return;
+					}
+					handler.on_text(sequence); //invalid sequences are passed on too, the decoder replaces them
+					sequence.clear();
+					continue;
+				}
+				for (;;) {
+					const auto escape_position = static_cast<const char *>(std::memchr(position, escape, end - position));
+					const auto text_end = escape_position ? escape_position : get_complete_utf8_end(position, end);
+					if (text_end != position) {
+						handler.on_text({position, static_cast<std::size_t>(text_end - position)});
+					}
+					if (escape_position == nullptr) {
+						sequence.assign(text_end, end);
+						return;
+					}
+					position = escape_position + 1;
+					//most sequences are CSI sequences that are complete in this chunk, they don't need to go through the states
+					if (position == end || *position != '[') {
+						break;
+					}
+					auto parameters_end = position + 1;
+					while (parameters_end != end && *parameters_end >= 0x20 && *parameters_end <= 0x3F) {
+						parameters_end++;
+					}
+					if (parameters_end == end || *parameters_end < 0x40 || *parameters_end > 0x7E) {
+						break;
+					}
+					handler.on_control_sequence({position + 1, static_cast<std::size_t>(parameters_end - position - 1)}, *parameters_end);
+					position = parameters_end + 1;
+				}
+				state = State::escape;
+				sequence_overflow = false;
+			} break;
+			case State::escape: {
+				const char c = *position++;
+				if (c == '[') {
+					state = State::control_sequence;
+				} else if (c == ']') {
+					state = State::operating_system_command;
+				} else if (c == 'P' || c == 'X' || c == '^' || c == '_') {
+					state = State::ignored_string;
+				} else if (c >= 0x20 && c <= 0x2F) { //intermediate
+					append(c);
+				} else if (c >= 0x30 && c <= 0x7E) {
+					handler.on_escape_sequence(sequence, c);
+					sequence.clear();
+					state = State::ground;
+				} else if (c == escape) { //start over
+					sequence.clear();
+				} else if (c == cancel || c == substitute) {
+					sequence.clear();
+					state = State::ground;
+				} //other control characters are ignored
+			} break;
+			case State::control_sequence: {
+				//parameters and intermediates are usually in the same chunk as the final byte, then we don't need to copy them
+				auto parameters_end = position;
+				while (parameters_end != end && *parameters_end >= 0x20 && *parameters_end <= 0x3F) {
+					parameters_end++;
+				}
+				std::string_view parameters{position, static_cast<std::size_t>(parameters_end - position)};
+				position = parameters_end;
+				if (sequence.empty() == false || position == end) {
+					append(parameters);
+					parameters = sequence;
+				}
+				if (position == end) {
+					break;
+				}
+				const char c = *position++;
+				if (c >= 0x40 && c <= 0x7E) {
+					if (sequence_overflow == false) {
+						handler.on_control_sequence(parameters, c);
+					}
+					sequence.clear();
+					state = State::ground;
+				} else if (c == escape) {
+					sequence.clear();
+					sequence_overflow = false;
+					state = State::escape;
+				} else if (c == cancel || c == substitute) {
+					sequence.clear();
+					state = State::ground;
+				} else { //other control characters are ignored, but the sequence continues
+					append(parameters);
+				}
+			} break;
+			case State::operating_system_command:
+			case State::ignored_string: {
+				const char c = *position++;
+				if (c == bell && state == State::operating_system_command) { //xterm also accepts BEL as the terminator
+					if (sequence_overflow == false) {
+						handler.on_operating_system_command(sequence);
+					}
+					sequence.clear();
+					state = State::ground;
+				} else if (c == escape) {
+					string_state = state;
+					state = State::string_escape;
+				} else if (c == cancel || c == substitute) {
+					sequence.clear();
+					state = State::ground;
+				} else if (state == State::operating_system_command) {
+					append(c);
+				}
+			} break;
+			case State::string_escape: {
+				if (*position == '\\') { //string terminator
+					position++;
+					if (string_state == State::operating_system_command && sequence_overflow == false) {
+						handler.on_operating_system_command(sequence);
+					}
+					sequence.clear();
+					state = State::ground;
+				} else { //the string ended without terminator, the ESC starts a new sequence
+					sequence.clear();
+					sequence_overflow = false;
+					state = State::escape;
+				}
+			} break;
+		}
+	}
+}
+
+#endif // ANSI_PARSER_H
@@ -0,0 +1,92 @@
+#include "background_tokenizer.h"
+
+#include <algorithm>
+#include <climits>
+
+Background_tokenizer::Background_tokenizer(Highlighting_rules rules, Receiver receiver)
+	: rules{std::move(rules)}
+	, receiver{std::move(receiver)} {}
+
+Background_tokenizer::~Background_tokenizer() {
+	stop();
+}
+
+void Background_tokenizer::set_rules(Highlighting_rules rules) {
+	stop();
+	this->rules = std::move(rules);
+}
+
+std::size_t Background_tokenizer::start(std::vector<std::u16string> lines, std::size_t first_line, int start_state) {
+	stop();
+	const auto job = ++job_count;
+	worker = std::thread{&Background_tokenizer::run, this, job, std::move(lines), first_line, start_state};
+	return job;
+}
+
+void Background_tokenizer::stop() {
+	if (worker.joinable()) {
+		stop_requested = true;
+		worker.join();
+		stop_requested = false;
+	}
+}
+
+void Background_tokenizer::set_viewport(std::size_t first_line, std::size_t line_count) {
+	std::lock_guard lock{viewport_mutex};
+	viewport_first_line = first_line;
+	viewport_line_count = line_count;
+}
+
+std::uint64_t Background_tokenizer::get_text_hash(std::u16string_view text) {
+	std::uint64_t hash = 0xcbf29ce484222325;
+	for (const auto c : text) {
+		hash = (hash ^ c) * 0x100000001b3;
+	}
+	return hash;
+}
+
+void Background_tokenizer::run(std::size_t job, std::vector<std::u16string> lines, std::size_t first_line, int start_state) {
+	constexpr int unknown_state = INT_MIN;
+	//the states each line was last sent with
+	std::vector<int> start_states(lines.size(), unknown_state);
+	std::vector<int> end_states(lines.size(), unknown_state);
+	std::vector<Line_tokens> batch;
+	const auto tokenize = [&](std::size_t index, int state) {
+		Line_tokens tokens{first_line + index, get_text_hash(lines[index]), state, state, {}};
+		tokens.end_state = rules.find_tokens(lines[index], state, [&tokens](const Highlighting_rules::Token &token) { tokens.tokens.push_back(token); });
+		start_states[index] = state;
+		end_states[index] = tokens.end_state;
+		batch.push_back(std::move(tokens));
+		return end_states[index];
+	};
+
+	std::size_t position = 0; //lines before it have been tokenized in order
+	int state = start_state;
+	do {
+		if (stop_requested) {
+			return;
+		}
+		std::size_t viewport_begin;
+		std::size_t viewport_end;
+		{
+			std::lock_guard lock{viewport_mutex};
+			viewport_begin = std::clamp(viewport_first_line, first_line + position, first_line + lines.size()) - first_line;
+			viewport_end = std::clamp(viewport_first_line + viewport_line_count, first_line + position, first_line + lines.size()) - first_line;
+		}
+		for (auto line = viewport_begin; line < viewport_end; line++) {
+			if (start_states[line] == unknown_state) {
+				tokenize(line, line > 0 && end_states[line - 1] != unknown_state ? end_states[line - 1] : Highlighting_rules::no_region);
+			}
+		}
+		if (batch.empty() == false) {
+			receiver(job, std::move(batch), false);
+			batch.clear();
+			continue; //the viewport may have moved while tokenizing it
+		}
+		for (const auto batch_end = std::min(position + batch_size, lines.size()); position < batch_end; position++) {
+			state = start_states[position] == state ? end_states[position] : tokenize(position, state);
+		}
+		receiver(job, std::move(batch), position == lines.size());
+		batch.clear();
+	} while (position < lines.size());
+}
@@ -0,0 +1,56 @@
+#ifndef BACKGROUND_TOKENIZER_H
+#define BACKGROUND_TOKENIZER_H
+
+#include "highlighting_rules.h"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+/* Tokenizes lines in a worker thread so highlighting big files doesn't block the GUI. A job works on a copy of the lines and hands the tokens to
+ * the receiver in batches, in the worker thread. Lines in the viewport come first, starting in the state of the line before them if that is known
+ * and in no region otherwise. When the lines in order reach the viewport with a different state, they are tokenized and sent again. */
+class Background_tokenizer {
+	public:
+	constexpr static std::size_t batch_size = 512;
+	struct Line_tokens {
+		std::size_t line;
+		std::uint64_t text_hash; //to check that the line still has the text that was tokenized
+		int start_state;
+		int end_state;
+		std::vector<Highlighting_rules::Token> tokens;
+	};
+	using Receiver = std::function<void(std::size_t job, std::vector<Line_tokens> batch, bool is_finished)>;
+
+	Background_tokenizer(Highlighting_rules rules, Receiver receiver);
+	Background_tokenizer(const Background_tokenizer &) = delete;
+	~Background_tokenizer();
+
+	void set_rules(Highlighting_rules rules); //stops the running job
+	//stops the running job, lines[0] is line first_line. Returns the id of the job that the receiver gets.
+	std::size_t start(std::vector<std::u16string> lines, std::size_t first_line, int start_state);
+	void stop();
+	void set_viewport(std::size_t first_line, std::size_t line_count); //can be called while a job runs
+
+	static std::uint64_t get_text_hash(std::u16string_view text);
+
+	private:
+	void run(std::size_t job, std::vector<std::u16string> lines, std::size_t first_line, int start_state);
+
+	Highlighting_rules rules; //only used by the worker thread
+	Receiver receiver;
+	std::thread worker;
+	std::atomic<bool> stop_requested{false};
+	std::size_t job_count{};
+	std::mutex viewport_mutex;
+	std::size_t viewport_first_line{};
+	std::size_t viewport_line_count{};
+};
+
+#endif // BACKGROUND_TOKENIZER_H
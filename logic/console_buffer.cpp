@@ -0,0 +1,156 @@
+#include "console_buffer.h"
+
+#include <algorithm>
+#include <cassert>
+#include <iterator>
+
+Console_buffer::Console_buffer(std::size_t max_line_count)
+	: max_line_count{std::max<std::size_t>(max_line_count, 1)} {}
+
+void Console_buffer::append(std::string_view output, Stream_state &state) {
+	struct : Ansi_parser::Default_handler {
+		void on_text(std::string_view text) {
+			//split at control characters, tabs are kept and everything else other than newlines and carriage returns is dropped
+			std::size_t begin = 0;
+			for (std::size_t position = 0; position < text.size(); position++) {
+				const auto c = static_cast<unsigned char>(text[position]);
+				if ((c >= 0x20 && c != 0x7f) || c == '\t') {
+					continue;
+				}
+				buffer->add_text(text.substr(begin, position - begin), *state);
+				if (c == '\n') {
+					state->carriage_return = false;
+					buffer->add_line();
+				} else if (c == '\r') {
+					state->carriage_return = true;
+				}
+				begin = position + 1;
+			}
+			buffer->add_text(text.substr(begin), *state);
+		}
+		void on_control_sequence(std::string_view parameters, char final_byte) {
+			if (final_byte == 'm') {
+				state->attributes.apply(parameters);
+			}
+		}
+		Console_buffer *buffer;
+		Stream_state *state;
+	} handler;
+	handler.buffer = this;
+	handler.state = &state;
+	state.parser.feed(output, handler);
+}
+
+void Console_buffer::clear() {
+	text.clear();
+	text_position = 0;
+	line_positions = {0};
+	attribute_changes.clear();
+	dropped_line_count = 0;
+	max_line_length = 0;
+}
+
+void Console_buffer::set_max_line_count(std::size_t max_line_count) {
+	this->max_line_count = std::max<std::size_t>(max_line_count, 1);
+	drop_lines();
+}
+
+std::size_t Console_buffer::get_line_count() const {
+	return line_positions.size();
+}
+
+std::uint64_t Console_buffer::get_dropped_line_count() const {
+	return dropped_line_count;
+}
+
+std::size_t Console_buffer::get_max_line_length() const {
+	return max_line_length;
+}
+
+std::size_t Console_buffer::get_size() const {
+	return static_cast<std::size_t>(get_end_position() - line_positions.front());
+}
+
+std::string_view Console_buffer::get_line(std::size_t line) const {
+	assert(line < line_positions.size());
+	const auto begin = line_positions[line];
+	return std::string_view{text}.substr(begin - text_position, get_line_end_position(line) - begin);
+}
+
+std::vector<Console_buffer::Run> Console_buffer::get_runs(std::size_t line) const {
+	assert(line < line_positions.size());
+	auto position = line_positions[line];
+	const auto end = get_line_end_position(line);
+	auto change = std::upper_bound(std::begin(attribute_changes), std::end(attribute_changes), position,
+								   [](std::uint64_t position, const Attribute_change &change) { return position < change.position; });
+	auto attributes = change == std::begin(attribute_changes) ? Sgr_attributes{} : std::prev(change)->attributes;
+	std::vector<Run> runs;
+	while (position < end) {
+		const auto run_end = change == std::end(attribute_changes) ? end : std::min(end, change->position);
+		if (run_end > position) {
+			runs.push_back({std::string_view{text}.substr(position - text_position, run_end - position), attributes});
+		}
+		position = run_end;
+		if (change != std::end(attribute_changes)) {
+			attributes = change->attributes;
+			++change;
+		}
+	}
+	return runs;
+}
+
+void Console_buffer::add_text(std::string_view new_text, Stream_state &state) {
+	if (new_text.empty()) {
+		return;
+	}
+	if (state.carriage_return) { //overwrite the current line, which is how progress bars work
+		state.carriage_return = false;
+		const auto line_position = line_positions.back();
+		text.resize(line_position - text_position);
+		while (attribute_changes.empty() == false && attribute_changes.back().position > line_position) {
+			attribute_changes.pop_back();
+		}
+	}
+	const auto position = get_end_position();
+	const auto current_attributes = attribute_changes.empty() ? Sgr_attributes{} : attribute_changes.back().attributes;
+	if (state.attributes != current_attributes) {
+		if (attribute_changes.empty() == false && attribute_changes.back().position == position) {
+			attribute_changes.back().attributes = state.attributes;
+		} else {
+			attribute_changes.push_back({position, state.attributes});
+		}
+	}
+	text += new_text;
+	max_line_length = std::max(max_line_length, static_cast<std::size_t>(get_end_position() - line_positions.back()));
+}
+
+void Console_buffer::add_line() {
+	text += '\n';
+	line_positions.push_back(get_end_position());
+	drop_lines();
+}
+
+void Console_buffer::drop_lines() {
+	if (line_positions.size() <= max_line_count) {
+		return;
+	}
+	dropped_line_count += line_positions.size() - max_line_count;
+	line_positions.erase(std::begin(line_positions), std::end(line_positions) - max_line_count);
+	const auto first_position = line_positions.front();
+	//keep the last change before the first line, it has the attributes the first line starts with
+	while (attribute_changes.size() > 1 && attribute_changes[1].position <= first_position) {
+		attribute_changes.pop_front();
+	}
+	if (first_position - text_position > text.size() / 2) {
+		text.erase(0, first_position - text_position);
+		text_position = first_position;
+	}
+}
+
+std::uint64_t Console_buffer::get_end_position() const {
+	return text_position + text.size();
+}
+
+std::uint64_t Console_buffer::get_line_end_position(std::size_t line) const {
+	return line + 1 < line_positions.size() ? line_positions[line + 1] - 1 : get_end_position(); //without the newline
+}
@@ -0,0 +1,68 @@
+#ifndef CONSOLE_BUFFER_H
+#define CONSOLE_BUFFER_H
+
+#include "ansi_parser.h"
+#include "sgr_attributes.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/* Scrollback of the console. Text is kept as UTF-8 in one string without escape sequences, lines are an index of start positions into it and
+ * attributes are only stored where they change, so a line costs its text plus 8 bytes.
+ * Once there are more than max_line_count lines the oldest ones are dropped, the index works like a ring buffer and the text is compacted once
+ * the dropped part makes up half of it.
+ * Positions are counted from the first byte ever appended, so they stay valid when old lines are dropped. */
+class Console_buffer {
+	public:
+	//what survives from one chunk of output of a stream to the next, every stream writing into the buffer needs its own
+	struct Stream_state {
+		Ansi_parser parser;
+		Sgr_attributes attributes;
+		bool carriage_return{}; //the next text overwrites the current line unless it starts with a newline
+	};
+	struct Run {
+		std::string_view text;
+		Sgr_attributes attributes;
+	};
+	constexpr static std::size_t default_max_line_count = 100'000;
+
+	Console_buffer(std::size_t max_line_count = default_max_line_count);
+
+	void append(std::string_view output, Stream_state &state);
+	void clear();
+	void set_max_line_count(std::size_t max_line_count);
+
+	std::size_t get_line_count() const; //including the unfinished last line, so it is never 0
+	std::uint64_t get_dropped_line_count() const;
+	std::size_t get_max_line_length() const; //in bytes
+	std::size_t get_size() const;            //bytes of text currently stored
+	std::string_view get_line(std::size_t line) const;
+	//parts of line with the same attributes, only valid until the next append
+	std::vector<Run> get_runs(std::size_t line) const;
+
+	private:
+	struct Attribute_change {
+		std::uint64_t position;
+		Sgr_attributes attributes;
+	};
+
+	void add_text(std::string_view text, Stream_state &state);
+	void add_line();
+	void drop_lines();
+	std::uint64_t get_end_position() const;
+	std::uint64_t get_line_end_position(std::size_t line) const;
+
+	std::string text;
+	std::uint64_t text_position{}; //position of text[0]
+	std::deque<std::uint64_t> line_positions{0};
+	std::deque<Attribute_change> attribute_changes; //text before the first change has default attributes
+	std::uint64_t dropped_line_count{};
+	std::size_t max_line_count;
+	std::size_t max_line_length{};
+};
+
+#endif // CONSOLE_BUFFER_H
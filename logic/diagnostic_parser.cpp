@@ -0,0 +1,264 @@
+#include "diagnostic_parser.h"
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <iterator>
+
+std::size_t Diagnostic_index::add(Diagnostic diagnostic) {
+	const auto id = get_end_id();
+	locations_by_file[diagnostic.file].emplace(std::make_pair(diagnostic.line, diagnostic.column), id);
+	diagnostics.push_back(std::move(diagnostic));
+	return id;
+}
+
+void Diagnostic_index::add_fix_it(std::size_t id, Diagnostic::Fix_it fix_it) {
+	assert(id < get_end_id());
+	if (id >= first_id) {
+		diagnostics[id - first_id].fix_its.push_back(std::move(fix_it));
+	}
+}
+
+void Diagnostic_index::drop_before(std::size_t id) {
+	for (; first_id < id && diagnostics.empty() == false; first_id++) {
+		const auto &diagnostic = diagnostics.front();
+		const auto locations = locations_by_file.find(diagnostic.file);
+		const auto [same_location_begin, same_location_end] = locations->second.equal_range({diagnostic.line, diagnostic.column});
+		const auto location =
+			std::find_if(same_location_begin, same_location_end, [id = first_id](const auto &location_id) { return location_id.second == id; });
+		assert(location != same_location_end);
+		locations->second.erase(location);
+		if (locations->second.empty()) {
+			locations_by_file.erase(locations);
+		}
+		diagnostics.pop_front();
+	}
+}
+
+void Diagnostic_index::clear() {
+	first_id = get_end_id();
+	diagnostics.clear();
+	locations_by_file.clear();
+}
+
+std::size_t Diagnostic_index::get_size() const {
+	return diagnostics.size();
+}
+
+std::size_t Diagnostic_index::get_end_id() const {
+	return first_id + diagnostics.size();
+}
+
+const Diagnostic &Diagnostic_index::get(std::size_t id) const {
+	assert(id >= first_id && id < get_end_id());
+	return diagnostics[id - first_id];
+}
+
+const Diagnostic *Diagnostic_index::find(const std::string &file, int line, int column) const {
+	const auto locations = locations_by_file.find(file);
+	if (locations == std::end(locations_by_file)) {
+		return nullptr;
+	}
+	const auto location = locations->second.find({line, column});
+	return location == std::end(locations->second) ? nullptr : &get(location->second);
+}
+
+const Diagnostic *Diagnostic_index::find_next(const std::string &file, int line, int column) const {
+	const auto locations = locations_by_file.find(file);
+	if (locations == std::end(locations_by_file)) {
+		return nullptr;
+	}
+	const auto location = locations->second.upper_bound({line, column});
+	return location == std::end(locations->second) ? nullptr : &get(location->second);
+}
+
+Diagnostic_parser::Diagnostic_parser(std::string directory)
+	: directory{std::move(directory)} {}
+
+void Diagnostic_parser::feed(std::string_view output, Diagnostic_index &index) {
+	struct : Ansi_parser::Default_handler { //color codes are dropped
+		void on_text(std::string_view text) {
+			for (auto newline = text.find('\n'); newline != std::string_view::npos; newline = text.find('\n')) {
+				append(text.substr(0, newline));
+				parser->parse(*index);
+				text.remove_prefix(newline + 1);
+			}
+			append(text);
+		}
+		void append(std::string_view text) {
+			if (parser->line.size() + text.size() > max_line_size) {
+				parser->line_overflow = true;
+				return;
+			}
+			parser->line += text;
+		}
+		Diagnostic_parser *parser;
+		Diagnostic_index *index;
+	} handler;
+	handler.parser = this;
+	handler.index = &index;
+	ansi_parser.feed(output, handler);
+}
+
+void Diagnostic_parser::finish(Diagnostic_index &index) {
+	if (line.empty() == false) {
+		parse(index);
+	}
+	ansi_parser.reset();
+}
+
+static std::optional<int> read_number(std::string_view &text) {
+	int number = 0;
+	std::size_t digits = 0;
+	for (; digits < text.size() && text[digits] >= '0' && text[digits] <= '9'; digits++) {
+		if (number > 100'000'000) {
+			return std::nullopt;
+		}
+		number = number * 10 + (text[digits] - '0');
+	}
+	if (digits == 0) {
+		return std::nullopt;
+	}
+	text.remove_prefix(digits);
+	return number;
+}
+
+static bool skip(std::string_view &text, std::string_view prefix) {
+	if (text.substr(0, prefix.size()) != prefix) {
+		return false;
+	}
+	text.remove_prefix(prefix.size());
+	return true;
+}
+
+std::optional<Diagnostic> Diagnostic_parser::parse_line(std::string_view line) {
+	constexpr std::array<std::pair<std::string_view, Diagnostic::Severity>, 5> severities{{
+		{"fatal error: ", Diagnostic::Severity::fatal_error},
+		{"error: ", Diagnostic::Severity::error},
+		{"warning: ", Diagnostic::Severity::warning},
+		{"note: ", Diagnostic::Severity::note},
+		{"remark: ", Diagnostic::Severity::remark},
+	}};
+	if (line.empty() == false && line.back() == '\r') {
+		line.remove_suffix(1);
+	}
+	//the file name may contain colons itself, so try every colon as the end of the file name
+	for (auto colon = line.find(':', 1); colon != std::string_view::npos; colon = line.find(':', colon + 1)) {
+		auto rest = line.substr(colon + 1);
+		Diagnostic diagnostic;
+		const auto line_number = read_number(rest);
+		if (!line_number || !skip(rest, ":")) {
+			continue;
+		}
+		diagnostic.line = *line_number;
+		if (const auto column = read_number(rest)) {
+			if (!skip(rest, ":")) {
+				continue;
+			}
+			diagnostic.column = *column;
+		}
+		if (!skip(rest, " ")) {
+			continue;
+		}
+		const auto severity = std::find_if(std::begin(severities), std::end(severities), [&rest](const auto &severity) { return skip(rest, severity.first); });
+		if (severity == std::end(severities)) {
+			continue;
+		}
+		diagnostic.file = line.substr(0, colon);
+		diagnostic.severity = severity->second;
+		diagnostic.message = rest;
+		return diagnostic;
+	}
+	return std::nullopt;
+}
+
+//reads a string in double quotes with C escapes, which is how compilers print file names and replacements of fix-its
+static std::optional<std::string> read_quoted(std::string_view &text) {
+	if (!skip(text, "\"")) {
+		return std::nullopt;
+	}
+	std::string result;
+	while (text.empty() == false) {
+		const char c = text.front();
+		text.remove_prefix(1);
+		if (c == '"') {
+			return result;
+		}
+		if (c != '\\' || text.empty()) {
+			result += c;
+			continue;
+		}
+		const char escaped = text.front();
+		text.remove_prefix(1);
+		switch (escaped) {
+			case 'n':
+				result += '\n';
+				break;
+			case 't':
+				result += '\t';
+				break;
+			case 'r':
+				result += '\r';
+				break;
+			default:
+				if (escaped >= '0' && escaped <= '7') { //up to 3 octal digits
+					int value = escaped - '0';
+					for (int digit = 1; digit < 3 && text.empty() == false && text.front() >= '0' && text.front() <= '7'; digit++) {
+						value = value * 8 + (text.front() - '0');
+						text.remove_prefix(1);
+					}
+					result += static_cast<char>(value);
+				} else {
+					result += escaped;
+				}
+		}
+	}
+	return std::nullopt;
+}
+
+std::optional<Diagnostic::Fix_it> Diagnostic_parser::parse_fix_it(std::string_view line) {
+	if (line.empty() == false && line.back() == '\r') {
+		line.remove_suffix(1);
+	}
+	if (!skip(line, "fix-it:")) {
+		return std::nullopt;
+	}
+	auto file = read_quoted(line);
+	if (!file || !skip(line, ":{")) {
+		return std::nullopt;
+	}
+	const auto first_line = read_number(line);
+	const auto first_column = skip(line, ":") ? read_number(line) : std::nullopt;
+	const auto end_line = skip(line, "-") ? read_number(line) : std::nullopt;
+	const auto end_column = skip(line, ":") ? read_number(line) : std::nullopt;
+	if (!first_line || !first_column || !end_line || !end_column || !skip(line, "}:")) {
+		return std::nullopt;
+	}
+	auto replacement = read_quoted(line);
+	if (!replacement) {
+		return std::nullopt;
+	}
+	return Diagnostic::Fix_it{std::move(*file), *first_line, *first_column, *end_line, *end_column, std::move(*replacement)};
+}
+
+void Diagnostic_parser::parse(Diagnostic_index &index) {
+	if (line_overflow) {
+		line_overflow = false;
+	} else if (auto diagnostic = parse_line(line)) {
+		diagnostic->file = get_path(std::move(diagnostic->file));
+		last_id = index.add(std::move(*diagnostic));
+	} else if (auto fix_it = parse_fix_it(line)) {
+		if (last_id) {
+			fix_it->file = get_path(std::move(fix_it->file));
+			index.add_fix_it(*last_id, std::move(*fix_it));
+		}
+	}
+	line.clear();
+}
+
+std::string Diagnostic_parser::get_path(std::string file) const {
+	if (directory.empty() || file.empty() || file.front() == '/') {
+		return file;
+	}
+	return directory + (directory.back() == '/' ? "" : "/") + file;
+}
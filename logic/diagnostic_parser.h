@@ -0,0 +1,84 @@
+#ifndef DIAGNOSTIC_PARSER_H
+#define DIAGNOSTIC_PARSER_H
+
+#include "ansi_parser.h"
+
+#include <cstddef>
+#include <deque>
+#include <map>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+//an error, warning or note of GCC or Clang
+struct Diagnostic {
+	enum class Severity { note, remark, warning, error, fatal_error };
+	//a replacement suggested with -fdiagnostics-parseable-fixits, columns are 1 based and the end is exclusive
+	struct Fix_it {
+		std::string file;
+		int first_line{};
+		int first_column{};
+		int end_line{};
+		int end_column{};
+		std::string replacement;
+	};
+	std::string file;
+	int line{};
+	int column{}; //1 based, 0 if the compiler printed no column
+	Severity severity{};
+	std::string message;
+	std::vector<Fix_it> fix_its;
+};
+
+//Diagnostics in the order they arrived, plus an index per file to look them up by location in O(log n).
+//The oldest diagnostics can be dropped, ids keep counting so the ids of the others stay valid.
+class Diagnostic_index {
+	public:
+	std::size_t add(Diagnostic diagnostic); //returns the id
+	void add_fix_it(std::size_t id, Diagnostic::Fix_it fix_it); //ignored for dropped diagnostics
+	void drop_before(std::size_t id);
+	void clear(); //drops all diagnostics
+	std::size_t get_size() const;   //of the diagnostics that weren't dropped
+	std::size_t get_end_id() const; //the id of the next diagnostic
+	const Diagnostic &get(std::size_t id) const;
+	//the first diagnostic at exactly that location, nullptr if there is none
+	const Diagnostic *find(const std::string &file, int line, int column) const;
+	//the first diagnostic after the location, for going through the diagnostics of a file one by one
+	const Diagnostic *find_next(const std::string &file, int line, int column) const;
+
+	private:
+	std::deque<Diagnostic> diagnostics;
+	std::size_t first_id{}; //of diagnostics.front()
+	std::unordered_map<std::string, std::multimap<std::pair<int, int>, std::size_t>> locations_by_file;
+};
+
+/* Extracts diagnostics from the output of a compiler while it is still running. Output may arrive in arbitrary chunks and contain color codes,
+ * every line is parsed as soon as it is complete. Fix-its are added to the diagnostic before them, even if source lines come in between. */
+class Diagnostic_parser {
+	public:
+	constexpr static std::size_t max_line_size = 1 << 16; //longer lines are no diagnostics and get dropped
+
+	Diagnostic_parser(std::string directory = {}); //relative paths in the output are relative to directory
+
+	void feed(std::string_view output, Diagnostic_index &index);
+	void finish(Diagnostic_index &index); //parses the last line if it has no newline
+	//for lines such as "main.cpp:3:14: error: expected ';'", the file is returned as printed
+	static std::optional<Diagnostic> parse_line(std::string_view line);
+	//for lines such as fix-it:"main.cpp":{3:14-3:14}:";"
+	static std::optional<Diagnostic::Fix_it> parse_fix_it(std::string_view line);
+
+	private:
+	void parse(Diagnostic_index &index);
+	std::string get_path(std::string file) const;
+
+	Ansi_parser ansi_parser;
+	std::string line;
+	bool line_overflow{false};
+	std::string directory;
+	std::optional<std::size_t> last_id; //of the diagnostic the following fix-its belong to
+};
+
+#endif // DIAGNOSTIC_PARSER_H
@@ -0,0 +1,288 @@
+#include "highlighting_rules.h"
+#include "utility/binary_io.h"
+
+#include <algorithm>
+#include <iterator>
+#include <stdexcept>
+
+bool Highlighting_rules::is_word_character(char16_t c) {
+	return (c >= '0' && c <= '9') || (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_';
+}
+
+std::string_view Highlighting_rules::get_keyword(std::string_view pattern) {
+	constexpr std::string_view boundary = "\\b";
+	if (pattern.size() <= 2 * boundary.size() || pattern.substr(0, boundary.size()) != boundary ||
+		pattern.substr(pattern.size() - boundary.size()) != boundary) {
+		return {};
+	}
+	const auto word = pattern.substr(boundary.size(), pattern.size() - 2 * boundary.size());
+	const bool is_word = std::all_of(std::begin(word), std::end(word), [](char c) { return is_word_character(c); });
+	return is_word ? word : std::string_view{};
+}
+
+std::size_t Highlighting_rules::add_rule(std::string_view pattern) {
+	if (const auto keyword = get_keyword(pattern); keyword.empty() == false) {
+		keywords.emplace_back(keyword, rule_count);
+	} else {
+		automaton.add_rule(pattern);
+		automaton_rules.push_back(rule_count);
+	}
+	rule_regions.push_back(not_a_region);
+	is_prepared = false;
+	return rule_count++;
+}
+
+//the pattern for matching text literally
+static std::string escape(std::string_view text) {
+	std::string pattern;
+	for (const char c : text) {
+		const bool is_alphanumeric = (c >= '0' && c <= '9') || (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z');
+		if (is_alphanumeric == false) {
+			pattern += '\\';
+		}
+		pattern += c;
+	}
+	return pattern;
+}
+
+static std::string replace_group(std::string_view pattern, std::string_view group_pattern) {
+	std::string result;
+	for (std::size_t i = 0; i < pattern.size(); i++) {
+		if (pattern[i] == '\\' && i + 1 < pattern.size()) {
+			if (pattern[i + 1] == '1') {
+				result += group_pattern;
+			} else {
+				result += pattern.substr(i, 2);
+			}
+			i++;
+		} else {
+			result += pattern[i];
+		}
+	}
+	return result;
+}
+
+//finds syntax errors when the region is added instead of when it is found
+void Highlighting_rules::check_region_patterns(const Region &region) {
+	Token_automaton{}.add_rule(replace_group(region.end, ""));
+	if (region.nested_begin.empty() == false) {
+		Token_automaton{}.add_rule(region.nested_begin);
+		Token_automaton{}.add_rule(region.nested_end);
+	}
+}
+
+std::size_t Highlighting_rules::add_region(std::string_view begin, std::string_view end, std::string_view nested_begin, std::string_view nested_end) {
+	if (nested_begin.empty() != nested_end.empty()) {
+		throw std::runtime_error{"Regions need both or neither of nested begin and nested end"};
+	}
+	Region region{rule_count, std::string{begin}, std::string{end}, std::nullopt, std::string{nested_begin}, std::string{nested_end}};
+	check_region_patterns(region);
+	if (replace_group(end, "") != end) {
+		region.begin_regex.emplace(std::string{begin}); //throws std::regex_error, which is a std::runtime_error
+	}
+	automaton.add_rule(begin);
+	automaton_rules.push_back(rule_count);
+	rule_regions.push_back(regions.size());
+	regions.push_back(std::move(region));
+	is_prepared = false;
+	return rule_count++;
+}
+
+std::size_t Highlighting_rules::get_rule_count() const {
+	return rule_count;
+}
+
+std::size_t Highlighting_rules::get_keyword_count() const {
+	return keywords.size();
+}
+
+void Highlighting_rules::save(Utility::Binary_writer &writer) const {
+	automaton.save(writer);
+	writer.write<std::uint64_t>(automaton_rules.size());
+	for (const auto rule : automaton_rules) {
+		writer.write<std::uint64_t>(rule);
+	}
+	writer.write<std::uint64_t>(keywords.size());
+	for (const auto &[keyword, rule] : keywords) {
+		writer.write_string(keyword);
+		writer.write<std::uint64_t>(rule);
+	}
+	writer.write<std::uint64_t>(regions.size());
+	for (const auto &region : regions) {
+		writer.write<std::uint64_t>(region.rule);
+		writer.write_string(region.begin);
+		writer.write_string(region.end);
+		writer.write<std::uint8_t>(region.begin_regex.has_value());
+		writer.write_string(region.nested_begin);
+		writer.write_string(region.nested_end);
+	}
+	writer.write<std::uint64_t>(rule_count);
+}
+
+Highlighting_rules Highlighting_rules::load(Utility::Binary_reader &reader) {
+	Highlighting_rules rules;
+	rules.automaton = Token_automaton::load(reader);
+	const auto automaton_rule_count = reader.read<std::uint64_t>();
+	for (std::uint64_t i = 0; i < automaton_rule_count; i++) {
+		rules.automaton_rules.push_back(static_cast<std::size_t>(reader.read<std::uint64_t>()));
+	}
+	const auto keyword_count = reader.read<std::uint64_t>();
+	for (std::uint64_t i = 0; i < keyword_count; i++) {
+		auto keyword = reader.read_string();
+		rules.keywords.emplace_back(std::move(keyword), static_cast<std::size_t>(reader.read<std::uint64_t>()));
+	}
+	const auto region_count = reader.read<std::uint64_t>();
+	for (std::uint64_t i = 0; i < region_count; i++) {
+		Region region;
+		region.rule = static_cast<std::size_t>(reader.read<std::uint64_t>());
+		region.begin = reader.read_string();
+		region.end = reader.read_string();
+		if (reader.read<std::uint8_t>() != 0) {
+			region.begin_regex.emplace(region.begin);
+		}
+		region.nested_begin = reader.read_string();
+		region.nested_end = reader.read_string();
+		if (region.nested_begin.empty() != region.nested_end.empty()) {
+			throw std::runtime_error{"Invalid region in saved highlighting rules"};
+		}
+		check_region_patterns(region);
+		rules.regions.push_back(std::move(region));
+	}
+	rules.rule_count = static_cast<std::size_t>(reader.read<std::uint64_t>());
+
+	const auto is_rule = [&rules](std::size_t rule) { return rule < rules.rule_count; };
+	//every rule is either a keyword or in the automaton
+	if (rules.rule_count != rules.automaton_rules.size() + rules.keywords.size() || rules.automaton.get_rule_count() != rules.automaton_rules.size() ||
+		std::all_of(std::begin(rules.automaton_rules), std::end(rules.automaton_rules), is_rule) == false ||
+		std::all_of(std::begin(rules.keywords), std::end(rules.keywords), [&](const auto &keyword) { return is_rule(keyword.second); }) == false) {
+		throw std::runtime_error{"Invalid rules in saved highlighting rules"};
+	}
+	rules.rule_regions.assign(rules.rule_count, not_a_region);
+	for (std::size_t region = 0; region < rules.regions.size(); region++) {
+		if (is_rule(rules.regions[region].rule) == false) {
+			throw std::runtime_error{"Invalid region in saved highlighting rules"};
+		}
+		rules.rule_regions[rules.regions[region].rule] = region;
+	}
+	rules.is_prepared = false;
+	return rules;
+}
+
+void Highlighting_rules::prepare() {
+	keyword_table = Keyword_table{keywords};
+	//keywords only start at the start of words
+	can_skip_words = automaton_rules.empty() || automaton.can_start_inside_words() == false;
+	is_prepared = true;
+}
+
+int Highlighting_rules::get_state(Region_state region_state) {
+	std::lock_guard lock{shared_states->mutex};
+	const auto key = std::make_tuple(region_state.region, region_state.end, region_state.depth);
+	if (const auto state = shared_states->state_ids.find(key); state != std::end(shared_states->state_ids)) {
+		return state->second;
+	}
+	shared_states->region_states.push_back(region_state);
+	const auto state = static_cast<int>(shared_states->region_states.size() - 1);
+	shared_states->state_ids.emplace(key, state);
+	return state;
+}
+
+const Highlighting_rules::Region_state &Highlighting_rules::get_region_state(int state) {
+	if (static_cast<std::size_t>(state) >= region_states.size()) {
+		std::lock_guard lock{shared_states->mutex};
+		region_states.assign(std::begin(shared_states->region_states), std::end(shared_states->region_states));
+	}
+	return region_states[static_cast<std::size_t>(state)];
+}
+
+Highlighting_rules::Region_end &Highlighting_rules::get_region_end(std::size_t end) {
+	if (end >= region_ends.size()) {
+		region_ends.resize(end + 1);
+	}
+	auto &region_end = region_ends[end];
+	if (region_end) {
+		return *region_end;
+	}
+	std::pair<std::size_t, std::string> region_and_pattern;
+	{
+		std::lock_guard lock{shared_states->mutex};
+		region_and_pattern = shared_states->ends[end];
+	}
+	const auto &region = regions[region_and_pattern.first];
+	region_end.emplace();
+	region_end->outer.add_rule(region_and_pattern.second);
+	if (region.nested_begin.empty() == false) {
+		region_end->outer.add_rule(region.nested_begin);
+		region_end->inner.add_rule(region.nested_end);
+		region_end->inner.add_rule(region.nested_begin);
+	}
+	return *region_end;
+}
+
+int Highlighting_rules::begin_region(std::size_t region_index, std::u16string_view begin_text) {
+	const auto &region = regions[region_index];
+	std::string end = region.end;
+	if (region.begin_regex) {
+		//the group only matters for ASCII delimiters like the ones of raw string literals, other characters never match it
+		std::string text;
+		std::transform(std::begin(begin_text), std::end(begin_text), std::back_inserter(text), [](char16_t c) { return c < 128 ? static_cast<char>(c) : '\0'; });
+		std::smatch match;
+		const bool found_group = std::regex_match(text, match, *region.begin_regex) && match.size() > 1;
+		end = replace_group(end, found_group ? escape(match.str(1)) : "");
+	}
+	std::size_t end_id;
+	{
+		std::lock_guard lock{shared_states->mutex};
+		auto &ends = shared_states->ends;
+		end_id = shared_states->end_ids.try_emplace(std::make_pair(region_index, end), ends.size()).first->second;
+		if (end_id == ends.size()) {
+			ends.emplace_back(region_index, std::move(end));
+		}
+	}
+	return get_state({region_index, end_id, 0});
+}
+
+std::size_t Highlighting_rules::find_region_end(std::u16string_view text, std::size_t position, int &state) {
+	auto region_state = get_region_state(state);
+	auto &region_end = get_region_end(region_state.end);
+	while (position < text.size()) {
+		const auto token = (region_state.depth == 0 ? region_end.outer : region_end.inner).match(text, position);
+		if (token.length == 0) {
+			position++;
+			continue;
+		}
+		position += token.length;
+		if (token.rule == 1) {
+			region_state.depth++;
+		} else if (region_state.depth == 0) {
+			state = no_region;
+			return position;
+		} else {
+			region_state.depth--;
+		}
+	}
+	state = get_state(region_state);
+	return position;
+}
+
+Highlighting_rules::Token Highlighting_rules::match(std::u16string_view text, std::size_t position) {
+	auto token = automaton_rules.empty() ? Token{position, 0, 0} : automaton.match(text, position);
+	if (token.length > 0) {
+		token.rule = automaton_rules[token.rule];
+	}
+	if (is_word_character(text[position]) == false || (position > 0 && is_word_character(text[position - 1]))) {
+		return token;
+	}
+	auto end = position + 1;
+	while (end < text.size() && is_word_character(text[end])) {
+		end++;
+	}
+	const auto length = end - position;
+	if (length < token.length) {
+		return token;
+	}
+	if (const auto rule = keyword_table.find(text.substr(position, length)); rule && (length > token.length || *rule < token.rule)) {
+		return {position, length, *rule};
+	}
+	return token;
+}
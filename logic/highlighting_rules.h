@@ -0,0 +1,139 @@
+#ifndef HIGHLIGHTING_RULES_H
+#define HIGHLIGHTING_RULES_H
+
+#include "keyword_table.h"
+#include "token_automaton.h"
+
+#include <cstddef>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <regex>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+/* The token rules of a syntax highlighter. Rules that match exactly one word, like \bfor\b, are looked up in a perfect hash table once per word,
+ * only the other rules go into the Token_automaton. Tokens are found the same way Token_automaton finds them, as if all rules were in it.
+ * Regions are tokens that can span lines, like block comments. Text is tokenized line by line, a line that ends inside of a region returns a state
+ * that the next line starts with. States are small numbers that are equal for equal situations, so a line only needs to be tokenized again when
+ * its text or the state it starts with changed.
+ * Copies share their states, so copies used by different threads return the same states for the same situations. Rules have to be added before
+ * copying. */
+class Highlighting_rules {
+	public:
+	using Token = Token_automaton::Token;
+
+	constexpr static int no_region = -1; //the state of lines that don't end inside of a region, same as the initial QTextBlock::userState
+
+	//returns the id of the rule, throws std::runtime_error for syntax that Token_automaton doesn't support
+	std::size_t add_rule(std::string_view pattern);
+	//A region starts with a match of begin and includes everything up to and including the next match of end. \1 in end stands for the text
+	//of the first group of begin, so raw string literals can end with their own delimiter. If nested_begin is given, a match of it inside of the
+	//region starts an inner region that ends with nested_end and doesn't end the outer one, like #if inside of #if 0.
+	//Returns the id of the rule the tokens of the region are reported with.
+	std::size_t add_region(std::string_view begin, std::string_view end, std::string_view nested_begin = {}, std::string_view nested_end = {});
+	std::size_t get_rule_count() const;
+	std::size_t get_keyword_count() const; //rules that didn't need the automaton
+	//the compiled rules without states and DFAs, load throws std::runtime_error for data that save didn't write
+	void save(Utility::Binary_writer &writer) const;
+	static Highlighting_rules load(Utility::Binary_reader &reader);
+
+	//tokenizes one line starting in state, returns the state the next line starts in
+	template <class Callback> //void(const Token &)
+	int find_tokens(std::u16string_view text, int state, Callback &&callback);
+	template <class Callback> //void(const Token &)
+	void find_tokens(std::u16string_view text, Callback &&callback) {
+		find_tokens(text, no_region, std::forward<Callback>(callback));
+	}
+
+	private:
+	static bool is_word_character(char16_t c);
+	static std::string_view get_keyword(std::string_view pattern); //the word of patterns like \bword\b, empty for other patterns
+	constexpr static auto not_a_region = static_cast<std::size_t>(-1);
+	struct Region {
+		std::size_t rule;
+		std::string begin;
+		std::string end;
+		std::optional<std::regex> begin_regex; //to find the text of \1 of end, only if end contains it
+		std::string nested_begin;
+		std::string nested_end;
+	};
+	struct Region_end {
+		Token_automaton outer; //rule 0 is the end, rule 1 the nested begin
+		Token_automaton inner; //rule 0 is the nested end, rule 1 the nested begin
+	};
+	struct Region_state {
+		std::size_t region;
+		std::size_t end; //index into Shared_states::ends
+		int depth;
+	};
+	struct Shared_states {
+		std::mutex mutex;
+		std::vector<std::pair<std::size_t, std::string>> ends; //region and end pattern with \1 replaced
+		std::map<std::pair<std::size_t, std::string>, std::size_t> end_ids;
+		std::vector<Region_state> region_states; //the state is the index
+		std::map<std::tuple<std::size_t, std::size_t, int>, int> state_ids;
+	};
+
+	static void check_region_patterns(const Region &region);
+	void prepare();
+	Token match(std::u16string_view text, std::size_t position);
+	int get_state(Region_state region_state);
+	const Region_state &get_region_state(int state);
+	Region_end &get_region_end(std::size_t end);
+	int begin_region(std::size_t region, std::u16string_view begin_text);
+	std::size_t find_region_end(std::u16string_view text, std::size_t position, int &state); //position after the end or text.size()
+
+	Token_automaton automaton;
+	std::vector<std::size_t> automaton_rules; //id of each rule of the automaton
+	std::vector<std::pair<std::string, std::size_t>> keywords;
+	Keyword_table keyword_table; //built from keywords when tokens are needed
+	bool is_prepared{true};
+	bool can_skip_words{true}; //whether the rest of a word can be skipped when there is no token at its start
+	std::size_t rule_count{};
+	std::vector<Region> regions;
+	std::vector<std::size_t> rule_regions; //index into regions for each rule, not_a_region for other rules
+	std::shared_ptr<Shared_states> shared_states = std::make_shared<Shared_states>();
+	//copies of the shared states and the automata for their ends, built when first needed
+	std::vector<Region_state> region_states;
+	std::vector<std::optional<Region_end>> region_ends;
+};
+
+template <class Callback>
+int Highlighting_rules::find_tokens(std::u16string_view text, int state, Callback &&callback) {
+	if (is_prepared == false) {
+		prepare();
+	}
+	std::size_t position = 0;
+	if (state != no_region) {
+		const auto rule = regions[get_region_state(state).region].rule;
+		position = find_region_end(text, 0, state);
+		if (position > 0) {
+			const Token token{0, position, rule};
+			callback(token);
+		}
+	}
+	while (position < text.size()) {
+		auto token = match(text, position);
+		if (token.length == 0) {
+			position++;
+			while (can_skip_words && position < text.size() && is_word_character(text[position]) && is_word_character(text[position - 1])) {
+				position++;
+			}
+			continue;
+		}
+		if (const auto region = rule_regions[token.rule]; region != not_a_region) {
+			state = begin_region(region, text.substr(position, token.length));
+			token.length = find_region_end(text, position + token.length, state) - position;
+		}
+		callback(token);
+		position += token.length;
+	}
+	return state;
+}
+
+#endif // HIGHLIGHTING_RULES_H
@@ -0,0 +1,55 @@
+#include "input_producer.h"
+
+#include <algorithm>
+
+static void append_utf8(std::string &output, char32_t code_point) {
+	if (code_point < 0x80) {
+		output += static_cast<char>(code_point);
+	} else if (code_point < 0x800) {
+		output += static_cast<char>(0xC0 | code_point >> 6);
+		output += static_cast<char>(0x80 | (code_point & 0x3F));
+	} else if (code_point < 0x10000) {
+		output += static_cast<char>(0xE0 | code_point >> 12);
+		output += static_cast<char>(0x80 | (code_point >> 6 & 0x3F));
+		output += static_cast<char>(0x80 | (code_point & 0x3F));
+	} else {
+		output += static_cast<char>(0xF0 | code_point >> 18);
+		output += static_cast<char>(0x80 | (code_point >> 12 & 0x3F));
+		output += static_cast<char>(0x80 | (code_point >> 6 & 0x3F));
+		output += static_cast<char>(0x80 | (code_point & 0x3F));
+	}
+}
+
+Input_producer::Input_producer(std::vector<QString> segments, std::size_t chunk_size)
+	: segments{std::move(segments)}
+	, chunk_size{std::max<std::size_t>(chunk_size, 2)} { //a chunk must fit a surrogate pair
+	chunk.reserve(this->chunk_size * 3);
+}
+
+std::string_view Input_producer::next_chunk() {
+	chunk.clear();
+	while (segment_index < segments.size() && chunk.empty()) {
+		const auto &segment = segments[segment_index];
+		const auto data = segment.utf16();
+		const int end = static_cast<int>(std::min<std::size_t>(segment.size(), position + chunk_size));
+		while (position < end) {
+			const char16_t code_unit = data[position++];
+			if (code_unit >= 0xD800 && code_unit < 0xDC00 && position < segment.size() && data[position] >= 0xDC00 && data[position] < 0xE000) {
+				append_utf8(chunk, 0x10000 + ((code_unit - 0xD800) << 10) + (data[position++] - 0xDC00));
+			} else if (code_unit >= 0xD800 && code_unit < 0xE000) { //unpaired surrogate, encode the replacement character like QString::toUtf8
+				append_utf8(chunk, 0xFFFD);
+			} else {
+				append_utf8(chunk, code_unit);
+			}
+		}
+		if (position >= segment.size()) {
+			segment_index++;
+			position = 0;
+		}
+	}
+	return chunk;
+}
+
+bool Input_producer::is_empty() const {
+	return std::all_of(std::begin(segments), std::end(segments), [](const QString &segment) { return segment.isEmpty(); });
+}
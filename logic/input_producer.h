@@ -0,0 +1,31 @@
+#ifndef INPUT_PRODUCER_H
+#define INPUT_PRODUCER_H
+
+#include <QString>
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/* Produces the standard input of a tool as UTF-8 one chunk at a time, so a multi-megabyte selection is never converted as a whole.
+ * The input is a list of segments, such as the literal parts of Tool::input and the values of its placeholders, which are sent one after another.
+ * QString is reentrant and the segments are owned by the producer, so it can be created in the GUI thread and used in another thread. */
+class Input_producer {
+	public:
+	constexpr static std::size_t default_chunk_size = 16 * 1024; //in UTF-16 code units, which encode to at most 3 bytes each
+
+	Input_producer(std::vector<QString> segments = {}, std::size_t chunk_size = default_chunk_size);
+
+	//returns the next part of the input, which is valid until the next call, or an empty view once all input was produced
+	std::string_view next_chunk();
+	bool is_empty() const; //true if there is no input at all
+
+	private:
+	std::vector<QString> segments;
+	std::size_t segment_index{};
+	int position{};
+	std::size_t chunk_size;
+	std::string chunk;
+};
+
+#endif // INPUT_PRODUCER_H
@@ -0,0 +1,120 @@
+#include "keyword_table.h"
+
+#include <algorithm>
+#include <iterator>
+#include <numeric>
+#include <set>
+
+template <class Char>
+static std::uint64_t get_hash(std::basic_string_view<Char> text) {
+	std::uint64_t hash = 0xcbf29ce484222325;
+	for (const auto c : text) {
+		hash = (hash ^ static_cast<std::uint64_t>(c)) * 0x100000001b3;
+	}
+	return hash;
+}
+
+//the word is only hashed once, the bucket and the entry are picked from differently mixed versions of the hash
+static std::uint64_t mix(std::uint64_t hash, std::uint64_t seed) {
+	hash ^= seed * 0x9e3779b97f4a7c15;
+	hash ^= hash >> 33;
+	hash *= 0xff51afd7ed558ccd;
+	return hash ^ hash >> 33;
+}
+
+Keyword_table::Keyword_table(const std::vector<std::pair<std::string, std::size_t>> &keywords) {
+	std::vector<std::pair<std::string, std::size_t>> unique_keywords;
+	std::set<std::string_view> known_keywords;
+	for (const auto &keyword : keywords) {
+		if (keyword.first.empty() == false && known_keywords.insert(keyword.first).second) {
+			unique_keywords.push_back(keyword);
+		}
+	}
+	if (unique_keywords.empty()) {
+		return;
+	}
+	//at most half of the entries are used, unlucky sets get more room
+	std::size_t entry_count = 1;
+	while (entry_count < 2 * unique_keywords.size()) {
+		entry_count *= 2;
+	}
+	while (place(unique_keywords, entry_count) == false) {
+		entry_count *= 2;
+	}
+	size = unique_keywords.size();
+	for (const auto &keyword : unique_keywords) {
+		const auto first_character = static_cast<unsigned char>(keyword.first[0]);
+		if (keyword.first.size() >= 64 || first_character >= sizes_by_first_character.size()) {
+			sizes_by_first_character.fill(~std::uint64_t{}); //can't be filtered, so the hash decides
+			break;
+		}
+		sizes_by_first_character[first_character] |= std::uint64_t{1} << keyword.first.size();
+	}
+}
+
+std::optional<std::size_t> Keyword_table::find(std::u16string_view word) const {
+	//most words can't be keywords because of their first character and length, which is cheaper to find out than the hash
+	if (word.empty() || word.size() >= 64 || word[0] >= sizes_by_first_character.size() || (sizes_by_first_character[word[0]] >> word.size() & 1) == 0) {
+		return std::nullopt;
+	}
+	const auto hash = get_hash(word);
+	const auto &entry = entries[mix(hash, bucket_seeds[(hash >> 32) & (bucket_seeds.size() - 1)]) & (entries.size() - 1)];
+	if (entry.keyword.size() != word.size() || !std::equal(std::begin(word), std::end(word), std::begin(entry.keyword),
+															[](char16_t c, char keyword_c) { return c == static_cast<unsigned char>(keyword_c); })) {
+		return std::nullopt;
+	}
+	return entry.value;
+}
+
+std::size_t Keyword_table::get_size() const {
+	return size;
+}
+
+bool Keyword_table::place(const std::vector<std::pair<std::string, std::size_t>> &keywords, std::size_t entry_count) {
+	constexpr std::uint32_t max_seed = 100'000;
+	std::size_t bucket_count = 1;
+	while (bucket_count * 4 < keywords.size()) {
+		bucket_count *= 2;
+	}
+	std::vector<std::vector<std::size_t>> buckets(bucket_count);
+	std::vector<std::uint64_t> hashes;
+	for (std::size_t i = 0; i < keywords.size(); i++) {
+		hashes.push_back(get_hash(std::string_view{keywords[i].first}));
+		buckets[(hashes.back() >> 32) & (bucket_count - 1)].push_back(i);
+	}
+	//big buckets are the hardest to place, so they go first while most entries are free
+	std::vector<std::size_t> bucket_order(bucket_count);
+	std::iota(std::begin(bucket_order), std::end(bucket_order), 0);
+	std::stable_sort(std::begin(bucket_order), std::end(bucket_order), [&buckets](std::size_t lhs, std::size_t rhs) { return buckets[lhs].size() > buckets[rhs].size(); });
+
+	bucket_seeds.assign(bucket_count, 0);
+	entries.assign(entry_count, {});
+	std::vector<std::size_t> bucket_entries;
+	for (const auto bucket : bucket_order) {
+		if (buckets[bucket].empty()) {
+			break;
+		}
+		std::uint32_t seed = 1;
+		for (; seed < max_seed; seed++) {
+			bucket_entries.clear();
+			for (const auto keyword : buckets[bucket]) {
+				const auto entry = mix(hashes[keyword], seed) & (entry_count - 1);
+				if (entries[entry].keyword.empty() == false || std::find(std::begin(bucket_entries), std::end(bucket_entries), entry) != std::end(bucket_entries)) {
+					break;
+				}
+				bucket_entries.push_back(entry);
+			}
+			if (bucket_entries.size() == buckets[bucket].size()) {
+				break;
+			}
+		}
+		if (seed == max_seed) {
+			return false;
+		}
+		bucket_seeds[bucket] = seed;
+		for (std::size_t i = 0; i < bucket_entries.size(); i++) {
+			entries[bucket_entries[i]] = {keywords[buckets[bucket][i]].first, keywords[buckets[bucket][i]].second};
+		}
+	}
+	return true;
+}
@@ -0,0 +1,38 @@
+#ifndef KEYWORD_TABLE_H
+#define KEYWORD_TABLE_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+/* A perfect hash table from keywords to values, built once with all keywords known. Keywords are hashed into buckets and each bucket gets a seed
+ * that hashes its keywords into free entries (hash and displace), so a lookup hashes the word once and compares it with one keyword, there is no
+ * probing. Words whose first character and size don't fit any keyword are rejected before hashing. */
+class Keyword_table {
+	public:
+	Keyword_table() = default;
+	Keyword_table(const std::vector<std::pair<std::string, std::size_t>> &keywords); //the first value of duplicate keywords is kept
+
+	std::optional<std::size_t> find(std::u16string_view word) const;
+	std::size_t get_size() const;
+
+	private:
+	struct Entry {
+		std::string keyword; //empty for unused entries
+		std::size_t value;
+	};
+
+	bool place(const std::vector<std::pair<std::string, std::size_t>> &keywords, std::size_t entry_count);
+
+	std::vector<std::uint32_t> bucket_seeds; //both a power of 2 in size
+	std::vector<Entry> entries;
+	std::size_t size{};
+	std::array<std::uint64_t, 128> sizes_by_first_character{}; //bit n is set if a keyword of size n starts with the character
+};
+
+#endif // KEYWORD_TABLE_H
@@ -0,0 +1,118 @@
+#include "output_channel.h"
+#include "utility/thread_call.h"
+
+#include <QTimer>
+#include <algorithm>
+#include <cassert>
+
+Output_channel::Output_channel(Receiver receiver, std::size_t byte_budget)
+	: receiver{std::move(receiver)}
+	, byte_budget{byte_budget} {}
+
+bool Output_channel::push(Stream stream, std::string_view data) {
+	std::unique_lock lock{mutex};
+	assert(closed == false);
+	statistics.pushes++;
+	if (data.empty()) {
+		return producer_paused == false;
+	}
+	if (pending.chunks.empty()) {
+		pending.oldest_push = Clock::now();
+	}
+	pending.data += data;
+	if (pending.chunks.empty() == false && pending.chunks.back().stream == stream) {
+		pending.chunks.back().size += data.size();
+	} else {
+		pending.chunks.push_back({stream, data.size()});
+	}
+	statistics.queued_bytes = pending.data.size();
+	statistics.queued_chunks = pending.chunks.size();
+	statistics.max_queued_bytes = std::max(statistics.max_queued_bytes, statistics.queued_bytes);
+	if (pending.data.size() >= byte_budget) {
+		producer_paused = true;
+		statistics.pauses++;
+	}
+	const auto keep_reading = producer_paused == false;
+	request_delivery(lock);
+	return keep_reading;
+}
+
+void Output_channel::set_resume_callback(std::function<void()> callback) {
+	std::lock_guard lock{mutex};
+	resume_callback = std::move(callback);
+}
+
+void Output_channel::close(std::function<void()> completion_function) {
+	std::unique_lock lock{mutex};
+	assert(closed == false);
+	closed = true;
+	completion = std::move(completion_function);
+	request_delivery(lock);
+}
+
+Output_channel::Statistics Output_channel::get_statistics() const {
+	std::lock_guard lock{mutex};
+	return statistics;
+}
+
+void Output_channel::request_delivery(std::unique_lock<std::mutex> &lock) {
+	if (delivery_requested) { //the GUI thread will pick up this data with the wakeup that is already on its way
+		return;
+	}
+	delivery_requested = true;
+	statistics.wakeups++;
+	lock.unlock();
+	Utility::gui_call([this, alive = std::weak_ptr<const bool>{lifetime}] {
+		if (alive.expired()) {
+			return;
+		}
+		const auto next_frame = last_delivery + frame_interval;
+		const auto now = Clock::now();
+		if (now < next_frame) { //wait for the next frame to collect more data instead of waking up for every line
+			QTimer::singleShot(static_cast<int>(std::chrono::ceil<std::chrono::milliseconds>(next_frame - now).count()), [this, alive] {
+				if (alive.expired() == false) {
+					deliver();
+				}
+			});
+		} else {
+			deliver();
+		}
+	});
+}
+
+void Output_channel::deliver() {
+	std::function<void()> resume;
+	std::function<void()> completion_function;
+	{
+		std::lock_guard lock{mutex};
+		std::swap(pending, delivering);
+		delivery_requested = false;
+		last_delivery = Clock::now();
+		if (delivering.chunks.empty() == false) {
+			statistics.last_latency = std::chrono::duration_cast<std::chrono::microseconds>(last_delivery - delivering.oldest_push);
+			statistics.max_latency = std::max(statistics.max_latency, statistics.last_latency);
+		}
+		statistics.queued_bytes = 0;
+		statistics.queued_chunks = 0;
+		if (producer_paused && closed == false) {
+			resume = resume_callback;
+		}
+		producer_paused = false;
+		if (closed) {
+			completion_function = std::move(completion);
+		}
+	}
+	if (resume) { //let the producer refill pending while we display this batch
+		resume();
+	}
+	std::string_view data = delivering.data;
+	for (const auto &chunk : delivering.chunks) {
+		receiver(chunk.stream, data.substr(0, chunk.size));
+		data.remove_prefix(chunk.size);
+	}
+	delivering.data.clear();
+	delivering.chunks.clear();
+	if (completion_function) {
+		completion_function();
+	}
+}
@@ -0,0 +1,78 @@
+#ifndef OUTPUT_CHANNEL_H
+#define OUTPUT_CHANNEL_H
+
+#include <chrono>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/* Carries the output of a tool from the thread reading it to the GUI thread.
+ * Chunks pushed between two deliveries are coalesced and delivered with a single event at most once per frame.
+ * The channel holds at most byte_budget bytes (plus the last push). When push returns false the producer should stop reading until the resume
+ * callback is called, so a tool that writes faster than the GUI can display is slowed down instead of filling memory.
+ * The channel may be destroyed in the GUI thread while a delivery is on its way, but only once the producer stopped pushing. */
+class Output_channel {
+	public:
+	enum class Stream { output, error };
+	using Clock = std::chrono::steady_clock;
+	using Receiver = std::function<void(Stream stream, std::string_view data)>;
+
+	struct Statistics {
+		std::size_t queued_bytes;     //bytes waiting for the GUI thread right now
+		std::size_t max_queued_bytes; //the most bytes that ever waited
+		std::size_t queued_chunks;    //coalesced chunks waiting right now
+		std::size_t pushes;           //number of push calls
+		std::size_t wakeups;          //number of events posted to the GUI thread
+		std::size_t pauses;           //how often the producer had to stop reading
+		std::chrono::microseconds last_latency; //time the oldest byte of the last delivery waited
+		std::chrono::microseconds max_latency;
+	};
+
+	constexpr static std::size_t default_byte_budget = 1 << 20;
+	constexpr static std::chrono::milliseconds frame_interval{16};
+
+	Output_channel(Receiver receiver, std::size_t byte_budget = default_byte_budget);
+	Output_channel(const Output_channel &) = delete;
+
+	//called from the producer thread
+	bool push(Stream stream, std::string_view data);
+	void set_resume_callback(std::function<void()> callback); //called from the GUI thread when a paused producer may read again
+	void close(std::function<void()> completion);             //completion is called in the GUI thread after all data has been delivered
+
+	//called from any thread
+	Statistics get_statistics() const;
+
+	private:
+	struct Chunk {
+		Stream stream;
+		std::size_t size;
+	};
+	struct Batch {
+		std::string data;
+		std::vector<Chunk> chunks;
+		Clock::time_point oldest_push;
+	};
+
+	void request_delivery(std::unique_lock<std::mutex> &lock);
+	void deliver();
+
+	Receiver receiver;
+	std::size_t byte_budget;
+	mutable std::mutex mutex;
+	Batch pending;    //filled by the producer
+	Batch delivering; //drained by the GUI thread, swapped with pending so neither allocates once warmed up
+	bool delivery_requested{false};
+	bool producer_paused{false};
+	bool closed{false};
+	std::function<void()> resume_callback;
+	std::function<void()> completion;
+	Clock::time_point last_delivery{};
+	Statistics statistics{};
+	std::shared_ptr<const bool> lifetime = std::make_shared<const bool>(); //deliveries check it, they may arrive after the channel is gone
+};
+
+#endif // OUTPUT_CHANNEL_H
@@ -0,0 +1,289 @@
+#include "output_search.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cctype>
+#include <iterator>
+#include <regex>
+
+constexpr std::size_t recent_trigrams_size = 4096;
+
+static char fold_case(char c) {
+	return c >= 'A' && c <= 'Z' ? c - 'A' + 'a' : c;
+}
+
+static std::uint32_t get_trigram(const char *text) {
+	return static_cast<std::uint32_t>(static_cast<unsigned char>(fold_case(text[0]))) << 16 |
+		   static_cast<std::uint32_t>(static_cast<unsigned char>(fold_case(text[1]))) << 8 | static_cast<unsigned char>(fold_case(text[2]));
+}
+
+Output_search::Output_search(std::size_t max_size)
+	: recent_trigrams(recent_trigrams_size, ~std::uint64_t{})
+	, max_size{std::max(max_size, block_size)} {}
+
+std::size_t Output_search::start_run(std::string name) {
+	runs.push_back({std::move(name), {}, {}});
+	return dropped_run_count + runs.size() - 1;
+}
+
+void Output_search::append(std::size_t run, std::string_view output) {
+	struct : Ansi_parser::Default_handler {
+		void on_text(std::string_view text) {
+			for (auto newline = text.find('\n'); newline != std::string_view::npos; newline = text.find('\n')) {
+				auto line = text.substr(0, std::min(newline, max_line_size));
+				if (run->line.empty() == false) {
+					append(line);
+					line = run->line;
+				}
+				if (line.empty() == false && line.back() == '\r') {
+					line.remove_suffix(1);
+				}
+				search->add_line(run_id, line);
+				run->line.clear();
+				text.remove_prefix(newline + 1);
+			}
+			append(text);
+		}
+		void append(std::string_view text) {
+			run->line.append(text.substr(0, max_line_size - std::min(run->line.size(), max_line_size)));
+		}
+		Output_search *search;
+		Run *run;
+		std::size_t run_id;
+	} handler;
+	handler.search = this;
+	handler.run = &get_run(run);
+	handler.run_id = run;
+	handler.run->parser.feed(output, handler);
+}
+
+void Output_search::finish_run(std::size_t run) {
+	auto &finished_run = get_run(run);
+	if (finished_run.line.empty() == false) {
+		add_line(run, finished_run.line);
+	}
+	finished_run.line = {};
+	finished_run.parser.reset();
+	finished_run.is_finished = true;
+	drop_finished_runs();
+}
+
+const std::string &Output_search::get_run_name(std::size_t run) const {
+	assert(run >= dropped_run_count && run - dropped_run_count < runs.size());
+	return runs[run - dropped_run_count].name;
+}
+
+std::size_t Output_search::get_run_count() const {
+	return runs.size();
+}
+
+std::size_t Output_search::get_size() const {
+	return line_positions.empty() ? 0 : text_position + text.size() - line_positions.front();
+}
+
+std::size_t Output_search::get_line_count() const {
+	return line_positions.size();
+}
+
+std::vector<Output_search::Match> Output_search::find(std::string_view text, Case match_case, std::size_t max_matches) const {
+	if (text.empty()) {
+		return {};
+	}
+	if (match_case == Case::sensitive) {
+		return find_lines(text, [text](std::string_view line) { return line.find(text); }, max_matches);
+	}
+	return find_lines(text,
+					  [text](std::string_view line) {
+						  const auto match = std::search(std::begin(line), std::end(line), std::begin(text), std::end(text),
+														 [](char lhs, char rhs) { return fold_case(lhs) == fold_case(rhs); });
+						  return match == std::end(line) ? std::string_view::npos : static_cast<std::size_t>(match - std::begin(line));
+					  },
+					  max_matches);
+}
+
+//the longest text every match of pattern has to contain, only looking outside of groups and not at all if there are alternatives
+static std::string get_required_text(std::string_view pattern) {
+	std::string longest;
+	std::string current;
+	const auto end_current = [&] {
+		if (current.size() > longest.size()) {
+			longest = current;
+		}
+		current.clear();
+	};
+	int depth = 0;
+	for (std::size_t i = 0; i < pattern.size(); i++) {
+		const char c = pattern[i];
+		if (c == '|') {
+			return {};
+		}
+		if (c == '\\' && i + 1 < pattern.size()) {
+			const char escaped = pattern[++i];
+			const bool is_literal = !(std::isalnum(static_cast<unsigned char>(escaped))); //\d, \b, \1 and the like are not literals
+			if (is_literal && depth == 0) {
+				current += escaped;
+			} else {
+				end_current();
+			}
+		} else if (c == '*' || c == '?' || c == '{') { //the character before is optional or repeated
+			if (current.empty() == false) {
+				current.pop_back();
+			}
+			end_current();
+			if (c == '{') {
+				i = std::min(pattern.find('}', i), pattern.size());
+			}
+		} else if (c == '+') { //the character before is there, but maybe more than once
+			end_current();
+		} else if (c == '[') { //skipped, ignoring a class that contains ] only means we look at more lines
+			end_current();
+			for (i++; i < pattern.size() && pattern[i] != ']'; i++) {
+				i += pattern[i] == '\\';
+			}
+		} else if (c == '(' || c == ')' || c == '.' || c == '^' || c == '$') {
+			end_current();
+			depth += c == '(' ? 1 : c == ')' ? -1 : 0;
+		} else if (depth == 0) {
+			current += c;
+		}
+	}
+	end_current();
+	return longest;
+}
+
+std::vector<Output_search::Match> Output_search::find_regex(const std::string &pattern, Case match_case, std::size_t max_matches) const {
+	const std::regex regex{pattern, match_case == Case::sensitive ? std::regex::ECMAScript : std::regex::ECMAScript | std::regex::icase};
+	return find_lines(get_required_text(pattern),
+					  [&regex](std::string_view line) {
+						  std::cmatch match;
+						  if (std::regex_search(line.data(), line.data() + line.size(), match, regex)) {
+							  return static_cast<std::size_t>(match.position());
+						  }
+						  return std::string_view::npos;
+					  },
+					  max_matches);
+}
+
+void Output_search::add_line(std::size_t run, std::string_view line) {
+	if (block_first_lines.empty() || last_block_size >= block_size) {
+		block_first_lines.push_back(dropped_line_count + line_positions.size());
+		last_block_size = 0;
+	}
+	const auto block = static_cast<std::uint32_t>(dropped_block_count + block_first_lines.size() - 1);
+	for (std::size_t i = 2; i < line.size(); i++) {
+		const auto trigram = get_trigram(line.data() + i - 2);
+		const auto tagged_trigram = std::uint64_t{block} << 32 | trigram;
+		auto &recent = recent_trigrams[(trigram ^ trigram >> 12) % recent_trigrams_size];
+		if (recent == tagged_trigram) {
+			continue;
+		}
+		recent = tagged_trigram;
+		auto &blocks = blocks_by_trigram[trigram];
+		if (blocks.empty() || blocks.back() != block) {
+			blocks.push_back(block);
+		}
+	}
+	line_positions.push_back(text_position + text.size());
+	line_runs.push_back(static_cast<std::uint32_t>(run));
+	get_run(run).line_count++;
+	text += line;
+	text += '\n';
+	last_block_size += line.size() + 1;
+	while (get_size() > max_size && block_first_lines.size() > 1) {
+		drop_block();
+	}
+}
+
+void Output_search::drop_block() {
+	const auto line_count = static_cast<std::size_t>(block_first_lines[1] - block_first_lines[0]);
+	for (auto run = std::begin(line_runs); run != std::begin(line_runs) + line_count; ++run) {
+		get_run(*run).line_count--;
+	}
+	line_positions.erase(std::begin(line_positions), std::begin(line_positions) + line_count);
+	line_runs.erase(std::begin(line_runs), std::begin(line_runs) + line_count);
+	dropped_line_count += line_count;
+	block_first_lines.pop_front();
+	dropped_block_count++;
+	drop_finished_runs();
+	const auto dropped_size = static_cast<std::size_t>(line_positions.front() - text_position);
+	if (dropped_size < text.size() / 2) {
+		return;
+	}
+	//compacting the text and the index at the same time keeps both from growing beyond twice their size
+	text.erase(0, dropped_size);
+	text_position += dropped_size;
+	for (auto it = std::begin(blocks_by_trigram); it != std::end(blocks_by_trigram);) {
+		auto &blocks = it->second;
+		blocks.erase(std::begin(blocks), std::lower_bound(std::begin(blocks), std::end(blocks), dropped_block_count));
+		it = blocks.empty() ? blocks_by_trigram.erase(it) : std::next(it);
+	}
+}
+
+//runs are dropped in the order they were started, so run ids stay valid like line numbers
+void Output_search::drop_finished_runs() {
+	while (runs.empty() == false && runs.front().is_finished && runs.front().line_count == 0) {
+		runs.pop_front();
+		dropped_run_count++;
+	}
+}
+
+Output_search::Run &Output_search::get_run(std::size_t run) {
+	assert(run >= dropped_run_count && run - dropped_run_count < runs.size());
+	return runs[run - dropped_run_count];
+}
+
+std::string_view Output_search::get_line(std::uint64_t line) const {
+	const auto index = static_cast<std::size_t>(line - dropped_line_count);
+	const auto begin = line_positions[index];
+	const auto end = index + 1 < line_positions.size() ? line_positions[index + 1] : text_position + text.size();
+	return std::string_view{text}.substr(static_cast<std::size_t>(begin - text_position), static_cast<std::size_t>(end - begin - 1));
+}
+
+std::vector<std::uint32_t> Output_search::get_candidate_blocks(std::string_view required_text) const {
+	std::vector<std::uint32_t> candidates;
+	if (required_text.size() < 3) {
+		for (std::size_t block = 0; block < block_first_lines.size(); block++) {
+			candidates.push_back(static_cast<std::uint32_t>(dropped_block_count + block));
+		}
+		return candidates;
+	}
+	std::vector<const std::vector<std::uint32_t> *> block_lists;
+	for (std::size_t i = 2; i < required_text.size(); i++) {
+		const auto blocks = blocks_by_trigram.find(get_trigram(required_text.data() + i - 2));
+		if (blocks == std::end(blocks_by_trigram)) {
+			return {};
+		}
+		block_lists.push_back(&blocks->second);
+	}
+	//intersect starting with the rarest trigram so the candidates shrink fast
+	std::sort(std::begin(block_lists), std::end(block_lists), [](const auto lhs, const auto rhs) { return lhs->size() < rhs->size(); });
+	block_lists.erase(std::unique(std::begin(block_lists), std::end(block_lists)), std::end(block_lists));
+	const auto &rarest = *block_lists.front();
+	candidates.assign(std::lower_bound(std::begin(rarest), std::end(rarest), dropped_block_count), std::end(rarest));
+	for (auto blocks = std::next(std::begin(block_lists)); blocks != std::end(block_lists) && candidates.empty() == false; ++blocks) {
+		candidates.erase(std::remove_if(std::begin(candidates), std::end(candidates),
+										[blocks](std::uint32_t block) { return !std::binary_search(std::begin(**blocks), std::end(**blocks), block); }),
+						 std::end(candidates));
+	}
+	return candidates;
+}
+
+template <class Matcher>
+std::vector<Output_search::Match> Output_search::find_lines(std::string_view required_text, Matcher &&matcher, std::size_t max_matches) const {
+	std::vector<Match> matches;
+	const auto end_line = dropped_line_count + line_positions.size();
+	for (const auto block : get_candidate_blocks(required_text)) {
+		const auto block_index = static_cast<std::size_t>(block - dropped_block_count);
+		const auto block_end_line = block_index + 1 < block_first_lines.size() ? block_first_lines[block_index + 1] : end_line;
+		for (auto line = block_first_lines[block_index]; line < block_end_line; line++) {
+			const auto text = get_line(line);
+			if (const auto column = matcher(text); column != std::string_view::npos) {
+				matches.push_back({line_runs[static_cast<std::size_t>(line - dropped_line_count)], line, column, text});
+				if (matches.size() == max_matches) {
+					return matches;
+				}
+			}
+		}
+	}
+	return matches;
+}
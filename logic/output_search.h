@@ -0,0 +1,82 @@
+#ifndef OUTPUT_SEARCH_H
+#define OUTPUT_SEARCH_H
+
+#include "ansi_parser.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+/* Keeps the recent output of tools searchable. Lines are grouped into blocks of about block_size bytes and every block is indexed by the
+ * trigrams it contains, so a query only looks at the blocks that contain all trigrams of the text it needs. The index is built as output arrives,
+ * escape sequences are dropped. Once more than max_size bytes are kept the oldest blocks are dropped.
+ * Trigrams ignore ASCII case so the same index works for case insensitive queries. Lines longer than max_line_size are cut, such as the progress
+ * bars of tools that only print carriage returns. A run is dropped once it is finished and all its lines were dropped. */
+class Output_search {
+	public:
+	struct Match {
+		std::size_t run;
+		std::uint64_t line;    //counted from the first line ever stored, so it stays valid when old lines are dropped
+		std::size_t column;    //byte offset of the match in text
+		std::string_view text; //the whole line without newline, only valid until the next append
+	};
+	enum class Case { sensitive, insensitive };
+	constexpr static std::size_t block_size = 16 * 1024;
+	constexpr static std::size_t default_max_size = 64 * 1024 * 1024;
+	constexpr static std::size_t default_max_matches = 1000;
+	constexpr static std::size_t max_line_size = 1 << 16;
+
+	Output_search(std::size_t max_size = default_max_size);
+
+	std::size_t start_run(std::string name); //returns the id of the run to append its output to
+	void append(std::size_t run, std::string_view output);
+	void finish_run(std::size_t run); //stores the last line if it has no newline, nothing may be appended to the run afterwards
+	const std::string &get_run_name(std::size_t run) const; //of a run that was not dropped yet, such as the run of a match
+	std::size_t get_run_count() const; //of the runs that were not dropped yet
+	std::size_t get_size() const; //bytes of text currently stored
+	std::size_t get_line_count() const;
+
+	//matches in the order the lines arrived, at most one per line
+	std::vector<Match> find(std::string_view text, Case match_case = Case::sensitive, std::size_t max_matches = default_max_matches) const;
+	//ECMAScript syntax, throws std::regex_error for invalid patterns. Only patterns with a literal part outside of groups and alternatives
+	//can use the index, others are checked against every line.
+	std::vector<Match> find_regex(const std::string &pattern, Case match_case = Case::sensitive, std::size_t max_matches = default_max_matches) const;
+
+	private:
+	struct Run {
+		std::string name;
+		Ansi_parser parser;
+		std::string line; //incomplete last line
+		std::size_t line_count{}; //stored lines
+		bool is_finished{false};
+	};
+
+	void add_line(std::size_t run, std::string_view line);
+	void drop_block();
+	void drop_finished_runs();
+	Run &get_run(std::size_t run);
+	std::string_view get_line(std::uint64_t line) const;
+	std::vector<std::uint32_t> get_candidate_blocks(std::string_view required_text) const;
+	template <class Matcher>
+	std::vector<Match> find_lines(std::string_view required_text, Matcher &&matcher, std::size_t max_matches) const;
+
+	std::deque<Run> runs;
+	std::size_t dropped_run_count{};
+	std::string text;              //complete lines of all runs, each ending with a newline
+	std::uint64_t text_position{}; //position of text[0] counting dropped bytes
+	std::deque<std::uint64_t> line_positions;
+	std::deque<std::uint32_t> line_runs;
+	std::uint64_t dropped_line_count{};
+	std::deque<std::uint64_t> block_first_lines; //the last block is the one lines are added to
+	std::uint32_t dropped_block_count{};
+	std::size_t last_block_size{};
+	std::unordered_map<std::uint32_t, std::vector<std::uint32_t>> blocks_by_trigram; //ascending block numbers, including dropped ones
+	std::vector<std::uint64_t> recent_trigrams; //direct mapped cache of block << 32 | trigram already indexed, saves most map lookups
+	std::size_t max_size;
+};
+
+#endif // OUTPUT_SEARCH_H
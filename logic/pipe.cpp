@@ -0,0 +1,124 @@
+#include "pipe.h"
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cstring>
+#include <fcntl.h>
+#include <initializer_list>
+#include <pty.h>
+#include <stdexcept>
+#include <sys/uio.h>
+#include <unistd.h>
+
+Pipe::Pipe(std::size_t chunk_size)
+	: buffer{chunk_size * bulk_chunks}
+	, chunk_size{chunk_size} {
+	std::array<int, 2> file_descriptors;
+	if (pipe2(file_descriptors.data(), O_CLOEXEC) != 0) {
+		throw std::runtime_error("Failed creating pipe");
+	}
+	read_channel = file_descriptors[0];
+	write_channel = file_descriptors[1];
+}
+
+Pipe::Pipe(const termios &terminal_settings, const winsize &window_size, std::size_t chunk_size)
+	: buffer{chunk_size * bulk_chunks}
+	, chunk_size{chunk_size} {
+	std::array<int, 2> file_descriptors;
+	if (openpty(&file_descriptors[0], &file_descriptors[1], nullptr, &terminal_settings, &window_size) != 0) {
+		throw std::runtime_error(strerror(errno));
+	}
+	read_channel = file_descriptors[0];
+	write_channel = file_descriptors[1];
+	set_close_on_exec();
+}
+
+void Pipe::close_read_channel() {
+	read_channel.reset();
+}
+
+void Pipe::close_write_channel() {
+	write_channel.reset();
+}
+
+bool Pipe::is_open() const {
+	return read_channel || write_channel;
+}
+
+void Pipe::write(std::string_view &s) {
+	assert(write_channel);
+	const auto written = ::write(write_channel.get(), s.data(), s.size());
+	if (written == -1) {
+		if (errno != EAGAIN) {
+			close_write_channel();
+		}
+		return;
+	}
+	s.remove_prefix(written);
+}
+
+void Pipe::write_all(std::string_view s) {
+	while (s.size()) {
+		if (is_open() == false) {
+			throw std::runtime_error("Failed writing to pipe");
+		}
+		write(s);
+	}
+}
+
+void Pipe::set_close_on_exec() {
+	//Every tool is spawned from the reactor thread, so a pipe of one tool must not leak into the children of others or it never reports end of file.
+	for (auto &channel : {&read_channel, &write_channel}) {
+		if (*channel) {
+			fcntl(channel->get(), F_SETFD, FD_CLOEXEC);
+		}
+	}
+}
+
+void Pipe::set_non_blocking() {
+	//the reactor is shared by all tools, so waiting on a single pipe would stall all of them
+	for (auto &channel : {&read_channel, &write_channel}) {
+		if (*channel) {
+			fcntl(channel->get(), F_SETFL, fcntl(channel->get(), F_GETFL) | O_NONBLOCK);
+		}
+	}
+}
+
+void Pipe::set_read_mode(Read_mode mode) {
+	read_mode = mode;
+	bulk_reading = mode == Read_mode::bulk;
+}
+
+int Pipe::get_read_channel() {
+	return read_channel.get();
+}
+
+int Pipe::get_write_channel() {
+	return write_channel.get();
+}
+
+ssize_t Pipe::fill_buffer() {
+	assert(buffer.is_empty());
+	const auto free_regions = buffer.get_free_regions();
+	auto bytes_to_read = bulk_reading ? buffer.get_free_space() : chunk_size;
+	std::array<iovec, 2> io_vectors;
+	int io_vector_count = 0;
+	for (const auto &region : free_regions) {
+		const auto size = std::min(region.size, bytes_to_read);
+		if (size > 0) {
+			io_vectors[io_vector_count++] = {region.data, size};
+			bytes_to_read -= size;
+		}
+	}
+	const auto requested = (bulk_reading ? buffer.get_free_space() : chunk_size) - bytes_to_read;
+	const auto bytes_read = readv(read_channel.get(), io_vectors.data(), io_vector_count);
+	if (bytes_read > 0) {
+		buffer.commit(bytes_read);
+		if (read_mode == Read_mode::adaptive) {
+			//chatty tools fill every request, so stop wasting system calls on small chunks until they calm down
+			bulk_reading = static_cast<std::size_t>(bytes_read) == requested;
+		}
+	}
+	return bytes_read;
+}
@@ -0,0 +1,73 @@
+#ifndef PIPE_H
+#define PIPE_H
+
+#include "utility/file_descriptor.h"
+#include "utility/ring_buffer.h"
+
+#include <cerrno>
+#include <cstddef>
+#include <string_view>
+#include <sys/types.h>
+
+struct termios;
+struct winsize;
+
+//A pipe or pseudo terminal to talk to a child process. Reading goes through a ring buffer that is reused for the lifetime of the pipe.
+struct Pipe {
+	enum class Read_mode {
+		chunked,  //read at most chunk_size bytes at a time
+		bulk,     //readv into all the free space of the buffer
+		adaptive, //switch to bulk reading while the previous read filled the whole request
+	};
+	constexpr static std::size_t default_chunk_size = 4096;
+	constexpr static std::size_t bulk_chunks = 16; //bulk reads go into a buffer of bulk_chunks * chunk_size bytes
+
+	Pipe(std::size_t chunk_size = default_chunk_size);
+	Pipe(const termios &terminal_settings, const winsize &window_size, std::size_t chunk_size = default_chunk_size);
+
+	void close_read_channel();
+	void close_write_channel();
+	bool is_open() const;
+
+	void write(std::string_view &s);
+	void write_all(std::string_view s);
+
+	void set_close_on_exec();
+	void set_non_blocking();
+	void set_read_mode(Read_mode mode);
+
+	//Reads what is available and passes it to callback as string_views into the buffer, which are only valid during the call.
+	//Closes the read channel on end of file or error.
+	template <class Callback>
+	void read(Callback &&callback) {
+		const auto bytes_read = fill_buffer();
+		if (bytes_read <= 0) {
+			if (bytes_read == -1 && errno == EAGAIN) {
+				return;
+			}
+			close_read_channel();
+			return;
+		}
+		for (const auto &data : buffer.get_data()) {
+			if (data.empty() == false) {
+				callback(data);
+			}
+		}
+		buffer.consume(buffer.get_size());
+	}
+
+	int get_read_channel();
+	int get_write_channel();
+
+	private:
+	ssize_t fill_buffer();
+
+	Utility::File_descriptor read_channel;
+	Utility::File_descriptor write_channel;
+	Utility::Ring_buffer buffer;
+	std::size_t chunk_size;
+	Read_mode read_mode{Read_mode::adaptive};
+	bool bulk_reading{false};
+};
+
+#endif // PIPE_H
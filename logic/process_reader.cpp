@@ -1,738 +1,895 @@
 #include "process_reader.h"
+#include "tool_statistics.h"
 #include "ui/edit_window.h"
 #include "ui/mainwindow.h"
 #include "utility/thread_call.h"
+#include "utility/utf8_decoder.h"
 
 #include <QApplication>
 #include <QPlainTextEdit>
 #include <QProcess>
+#include <chrono>
 #include <cassert>
 #include <initializer_list>
-#include <sstream>
+#include <memory>
+#include <numeric>
+#include <optional>
+#include <unordered_map>
+#include <utility>
 
 using namespace std::string_literals;
 
 #if USING_TTY
-#include "utility/unique_handle.h"
+#include "pipe.h"
+#include "spawn.h"
+#include "utility/reactor.h"
 #include <QMessageBox>
-#include <fcntl.h>
+#include <future>
 #include <iostream>
 #include <pty.h>
 #include <signal.h>
 #include <sstream>
+#include <fcntl.h>
+#include <sys/epoll.h>
+#include <sys/ioctl.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <sys/wait.h>
 #include <unistd.h>
 
-struct File_descriptor_policy {
-	using Handle_type = int;
+static termios get_termios_settings() {
+	termios terminal_settings{};
+	terminal_settings.c_iflag = ICRNL | IXOFF | IXON | IUTF8;
+	terminal_settings.c_oflag = OPOST | ONLCR;
+	terminal_settings.c_cflag = B38400 | CSIZE | CREAD;
+	terminal_settings.c_lflag = ISIG | ICANON | ECHO | ECHOE | ECHOK | ECHOCTL | ECHOKE | IEXTEN;
+	const auto cc_data = {VKILL,
+						  VREPRINT | VEOL2,
+						  127, //why 127? That's not a legal value
+						  VTIME | VEOL2,
+						  VEOF,
+						  VINTR,
+						  VQUIT,
+						  VINTR,
+						  VEOL2 | VQUIT,
+						  VQUIT | VERASE | VKILL | VEOL2,
+						  VERASE | VSTART | VSUSP | VEOL2,
+						  VINTR,
+						  VERASE | VEOL2,
+						  VLNEXT,
+						  VQUIT | VERASE | VKILL | VEOF | VTIME | VMIN | VSWTC | VEOL2,
+						  VERASE | VEOF | VMIN | VEOL2};
+	std::copy(std::begin(cc_data), std::end(cc_data), std::begin(terminal_settings.c_cc));
+	terminal_settings.c_ispeed = B38400;
+	terminal_settings.c_line = 0;
+	terminal_settings.c_ospeed = B38400;
 
-	constexpr static auto invalid_file_descriptor = -1;
+	return terminal_settings;
+}
 
-	constexpr static Handle_type get_null() {
-		return invalid_file_descriptor;
-	}
+//added to the environment of tools so they produce colored output
+static const std::vector<Spawn_request::Environment_variable> tool_environment = {
+	{"LS_COLORS",
+	 "rs=0:di=01;34:ln=01;36:mh=00:pi=40;33:so=01;35:do=01;35:bd=40;33;01:cd=40;33;01:or=40;31;01:mi=00:su=37;41:sg=30;43:ca=30;41:tw=30;42:ow=34;42:st="
+	 "37;44:ex=01;32:*.tar=01;31:*.tgz=01;31:*.arc=01;31:*.arj=01;31:*.taz=01;31:*.la=01;31:*.lz4=01;31:*.lzh=01;31:*.lzma=01;31:*.tlz=01;31:*.txz=01;31:"
+	 "*.tzo=01;31:*.t7z=01;31:*.zip=01;31:*.z=01;31:*.Z=01;31:*.dz=01;31:*.gz=01;31:*.lrz=01;31:*.lz=01;31:*.lzo=01;31:*.xz=01;31:*.zst=01;31:*.tzst=01;"
+	 "31:*.bz2=01;31:*.bz=01;31:*.tbz=01;31:*.tbz2=01;31:*.tz=01;31:*.deb=01;31:*.rpm=01;31:*.jar=01;31:*.war=01;31:*.ear=01;31:*.sar=01;31:*.rar=01;31:*"
+	 ".alz=01;31:*.ace=01;31:*.zoo=01;31:*.cpio=01;31:*.7z=01;31:*.rz=01;31:*.cab=01;31:*.jpg=01;35:*.jpeg=01;35:*.mjpg=01;35:*.mjpeg=01;35:*.gif=01;35:*"
+	 ".bmp=01;35:*.pbm=01;35:*.pgm=01;35:*.ppm=01;35:*.tga=01;35:*.xbm=01;35:*.xpm=01;35:*.tif=01;35:*.tiff=01;35:*.png=01;35:*.svg=01;35:*.svgz=01;35:*."
+	 "mng=01;35:*.pcx=01;35:*.mov=01;35:*.mpg=01;35:*.mpeg=01;35:*.m2v=01;35:*.mkv=01;35:*.webm=01;35:*.ogm=01;35:*.mp4=01;35:*.m4v=01;35:*.mp4v=01;35:*."
+	 "vob=01;35:*.qt=01;35:*.nuv=01;35:*.wmv=01;35:*.asf=01;35:*.rm=01;35:*.rmvb=01;35:*.flc=01;35:*.avi=01;35:*.fli=01;35:*.flv=01;35:*.gl=01;35:*.dl="
+	 "01;35:*.xcf=01;35:*.xwd=01;35:*.yuv=01;35:*.cgm=01;35:*.emf=01;35:*.ogv=01;35:*.ogx=01;35:*.aac=00;36:*.au=00;36:*.flac=00;36:*.m4a=00;36:*.mid=00;"
+	 "36:*.midi=00;36:*.mka=00;36:*.mp3=00;36:*.mpc=00;36:*.ogg=00;36:*.ra=00;36:*.wav=00;36:*.oga=00;36:*.opus=00;36:*.spx=00;36:*.xspf=00;36:"},
+	{"TERM", "xterm-256color"},
+	{"COLORTERM", "truecolor"},
+	{"COLORFGBG", "0;15"},
+};
 
-	constexpr static bool is_null(int file_descriptor) {
-		return file_descriptor == invalid_file_descriptor;
-	}
+static const winsize window_size{.ws_row = 160, .ws_col = 80, .ws_xpixel = 160 * 8, .ws_ypixel = 80 * 10};
 
-	static void close(int file_descriptor) {
-		if (::close(file_descriptor) != 0) {
-			throw std::runtime_error("Failed to close file descriptor");
+static void broken_pipe_signal_handler(int) {
+	//don't do anything in the handler, it just exists so the program doesn't get killed when reading or writing a pipe fails and instead receives an error code
+}
+
+#else
+#include "spill_file.h"
+#include <thread>
+#endif
+
+static std::string get_timeout_message(const Tool &tool) {
+	return "\n" + QObject::tr("Tool %1 timed out after %2ms.").arg(tool.get_name()).arg(tool.timeout.count()).toStdString() + "\n";
+}
+
+//splits string into its literal parts and the values of its placeholders, so that a large selection is not copied into yet another string
+static std::vector<QString> resolve_placeholders(const QString &string, const Edit_window *edit_window) {
+	struct Placeholder {
+		QString name;
+		QString (*get_value)(const Edit_window *edit_window);
+	} const placeholders[] = {
+		{"$FilePath", &MainWindow::get_path},                    //
+		{"$Selection", &MainWindow::get_selection},              //
+		{"$DocumentVersion", &MainWindow::get_document_version}, //
+	};
+	std::vector<QString> segments;
+	int position = 0;
+	for (;;) {
+		const Placeholder *next_placeholder = nullptr;
+		int next_position = string.size();
+		for (const auto &placeholder : placeholders) {
+			const auto placeholder_position = string.indexOf(placeholder.name, position);
+			if (placeholder_position != -1 && placeholder_position < next_position) {
+				next_placeholder = &placeholder;
+				next_position = placeholder_position;
+			}
+		}
+		if (next_position > position) {
+			segments.push_back(string.mid(position, next_position - position));
+		}
+		if (next_placeholder == nullptr) {
+			return segments;
 		}
+		segments.push_back(next_placeholder->get_value(edit_window));
+		position = next_position + next_placeholder->name.size();
 	}
-};
+}
 
-struct Pipe {
-	Pipe() {
-		std::array<int, 2> file_descriptors;
-		if (pipe(file_descriptors.data()) != 0) {
-			throw std::runtime_error("Failed creating pipe");
+QStringList detail::create_arguments_list(const QString &args_string) {
+	//TODO: Warn about unbalanced quotation marks
+	QStringList arguments{""};
+	for (auto &args : args_string.split(' ')) {
+		if (args.isEmpty()) {
+			continue;
 		}
-		read_channel = file_descriptors[0];
-		write_channel = file_descriptors[1];
-	}
-	Pipe(const termios &terminal_settings, const winsize &window_size) {
-		std::array<int, 2> file_descriptors;
-		if (openpty(&file_descriptors[0], &file_descriptors[1], nullptr, &terminal_settings, &window_size) != 0) {
-			throw std::runtime_error(strerror(errno));
+		if (arguments.last().startsWith('"')) {
+			arguments.last().push_back(' ');
+			arguments.last() += args;
+		} else {
+			arguments << args;
+		}
+		if (arguments.last().endsWith('"')) {
+			arguments.last().chop(1);
+			arguments.last().remove(0, 1);
 		}
-		read_channel = file_descriptors[0];
-		write_channel = file_descriptors[1];
 	}
+	arguments.pop_front();
+	return arguments;
+}
 
-	void close_read_channel() {
-		read_channel.reset();
+#if USING_TTY
+//A running tool. It is owned by the handlers it registers in the reactor and dies when the last of them is removed.
+//It is created in the GUI thread, but all member functions run in the reactor thread, so we cannot use any GUI functions or access any non-local
+//memory without synchronization. For example writing `reader->state = State::running;`, `reader->completion_callback();` or
+//`new QPushButton("Click Me");` would be incorrect, instead we have to make the GUI thread do those things for us via Utility::gui_call.
+struct Process_reader::Process : std::enable_shared_from_this<Process> {
+	Process(Process_reader &reader, Tool tool, Input_producer input)
+		: reader{&reader}
+		, tool{std::move(tool)}
+		, input{std::move(input)}
+		, spawn_request{create_spawn_request(this->tool)}
+		, in_terminal{this->tool.output == Tool_output_target::terminal}
+		, keeps_input_open{this->tool.keeps_input_open()} {}
+
+	//argument splitting and string conversions happen here in the GUI thread, the reactor thread only makes the system calls
+	static Spawn_request create_spawn_request(const Tool &tool) {
+		auto arguments = detail::create_arguments_list(tool.arguments);
+		arguments.push_front(tool.path);
+		std::vector<std::string> string_arguments;
+		string_arguments.reserve(arguments.size());
+		std::transform(std::begin(arguments), std::end(arguments), std::back_inserter(string_arguments),
+					   [](const QString &argument) { return argument.toStdString(); });
+		return {tool.path.toStdString(), std::move(string_arguments), tool.working_directory.toStdString(), tool_environment};
 	}
 
-	void close_write_channel() {
-		write_channel.reset();
+	void run() {
+		signal(SIGPIPE, &broken_pipe_signal_handler);
+		if (start()) {
+			watch_exit();
+			watch_pipes();
+		}
+	}
+
+	void kill() {
+		killed = true;
+		terminate();
 	}
-	bool is_open() const {
-		return read_channel || write_channel;
+
+	//the Process_reader is being destroyed, the tool still gets killed, but its output and completion go nowhere
+	void detach() {
+		reader = nullptr;
+		resume_reading(); //nobody would resume it anymore, the tool must not block on a full pipe while it should exit
+		kill();
 	}
 
-	void write(std::string_view &s) {
-		assert(write_channel);
-		const auto written = ::write(write_channel.get(), s.data(), s.size());
-		if (written == -1) {
-			close_write_channel();
+	//asks the tool and everything it started to exit and forces them to if they have not after kill_grace_period
+	void terminate() {
+		if (child_pid <= 0 || kill_timer) { //never started or already terminating
 			return;
 		}
-		s.remove_prefix(written);
+		killpg(child_pid, SIGTERM);
+		kill_timer = Utility::Reactor::get().add_timer(Utility::Reactor::Clock::now() + kill_grace_period, [process = shared_from_this()] {
+			process->force_kill();
+		});
 	}
 
-	void write_all(std::string_view s) {
-		while (s.size()) {
-			if (is_open() == false) {
-				throw std::runtime_error("Failed writing to pipe");
+	void force_kill() {
+		killpg(child_pid, SIGKILL);
+		kill_timer = Utility::Reactor::get().add_timer(Utility::Reactor::Clock::now() + kill_grace_period, [process = shared_from_this()] {
+			process->abandon();
+		});
+	}
+
+	void abandon() {
+		//something that left the process group still holds our pipes, stop waiting for it
+		kill_timer.reset();
+		close_terminal_input();
+		auto &reactor = Utility::Reactor::get();
+		if (standard_input.is_open()) {
+			reactor.remove(standard_input.get_write_channel());
+			standard_input.close_write_channel();
+			watching_input = false;
+		}
+		for (auto &pipe : {&standard_output, &standard_error}) {
+			if (pipe->is_open()) {
+				reactor.remove(pipe->get_read_channel());
+				pipe->close_read_channel();
 			}
-			write(s);
 		}
+		check_finished();
 	}
 
-	void set_close_on_exec() {
-		for (auto &channel : {&read_channel, &write_channel}) {
-			if (*channel) {
-				fcntl(channel->get(), F_SETFD, FD_CLOEXEC);
+	bool start() {
+		child_pid = in_terminal ? spawn_request.spawn_in_terminal(standard_output.get_write_channel())
+								: spawn_request.spawn(standard_input.get_read_channel(), standard_output.get_write_channel(),
+													  standard_error.get_write_channel());
+		const auto spawn_error = errno;
+		start_time = Utility::Reactor::Clock::now();
+		//the child has its own copies of these now
+		standard_input.close_read_channel();
+		standard_output.close_write_channel();
+		standard_error.close_write_channel();
+		if (in_terminal) { //everything goes through the terminal, we write to its master side through a file descriptor of its own
+			standard_input.close_write_channel();
+			standard_error.close_read_channel();
+			if (child_pid != -1) {
+				terminal_input.reset(fcntl(standard_output.get_read_channel(), F_DUPFD_CLOEXEC, 0));
 			}
 		}
+		if (child_pid == -1) {
+			Utility::gui_call([tool = tool, spawn_error] {
+				QMessageBox::critical(MainWindow::get_main_window(), QObject::tr("Failed executing tool %1").arg(tool.get_name()),
+									  QObject::tr("Failed to execute command %1 %2 in working directory %3. Error: %4.")
+										  .arg(tool.path, tool.arguments, tool.working_directory.isEmpty() ? "." : tool.working_directory,
+											   QString{strerror(spawn_error)}));
+			});
+			reader->report_completion(State::error, {});
+			return false;
+		}
+		return true;
 	}
 
-	std::string read() {
-		char buffer[chunk_size];
-		const auto bytes_read = ::read(read_channel.get(), buffer, chunk_size);
-		if (bytes_read <= 0) {
-			close_read_channel();
-			return {};
+	void watch_exit() {
+		//a pidfd becomes readable when the child exits, without pidfd support (Linux < 5.3) we have to poll
+#ifdef SYS_pidfd_open
+		child_exit.reset(static_cast<int>(syscall(SYS_pidfd_open, child_pid, 0)));
+#endif
+		if (child_exit) {
+			Utility::Reactor::get().add(child_exit.get(), EPOLLIN, [process = shared_from_this()](std::uint32_t) { process->reap(); });
+		} else {
+			poll_exit();
 		}
-		return {buffer, buffer + bytes_read};
 	}
 
-	void set_standard_input() {
-		if (dup2(read_channel.get(), STDIN_FILENO) != STDIN_FILENO) {
-			throw std::runtime_error("Failed setting standard input");
-		}
+	void poll_exit() {
+		Utility::Reactor::get().add_timer(Utility::Reactor::Clock::now() + std::chrono::milliseconds{50}, [process = shared_from_this()] {
+			if (process->reap() == false) {
+				process->poll_exit();
+			}
+		});
 	}
-	void set_standard_output() {
-		if (dup2(write_channel.get(), STDOUT_FILENO) != STDOUT_FILENO) {
-			throw std::runtime_error("Failed setting standard output");
+
+	bool reap() {
+		int status;
+		rusage usage;
+		if (wait4(child_pid, &status, WNOHANG, &usage) != child_pid) {
+			return false;
 		}
-	}
-	void set_standard_error() {
-		if (dup2(write_channel.get(), STDERR_FILENO) != STDERR_FILENO) {
-			throw std::runtime_error("Failed setting standard error");
+		const auto to_microseconds = [](const timeval &time) { return std::chrono::seconds{time.tv_sec} + std::chrono::microseconds{time.tv_usec}; };
+		run_statistics.wall_time = std::chrono::duration_cast<std::chrono::microseconds>(Utility::Reactor::Clock::now() - start_time);
+		run_statistics.user_cpu_time = to_microseconds(usage.ru_utime);
+		run_statistics.system_cpu_time = to_microseconds(usage.ru_stime);
+		run_statistics.max_rss_kib = usage.ru_maxrss;
+		if (child_exit) {
+			Utility::Reactor::get().remove(child_exit.get());
+			child_exit.reset();
 		}
+		child_exited = true;
+		check_finished();
+		return true;
 	}
 
-	int get_read_channel() {
-		return read_channel.get();
-	}
-	int get_write_channel() {
-		return write_channel.get();
+	void watch_pipes() {
+		auto &reactor = Utility::Reactor::get();
+		for (auto &pipe : {&standard_input, &standard_output, &standard_error}) {
+			pipe->set_non_blocking();
+		}
+		if (in_terminal) {
+			for (auto chunk = input.next_chunk(); chunk.empty() == false; chunk = input.next_chunk()) {
+				terminal_input_data += chunk;
+			}
+			write_terminal();
+		} else if (input.is_empty() && keeps_input_open == false) {
+			standard_input.close_write_channel();
+		} else {
+			write();
+		}
+		watch_read(standard_output, Output_channel::Stream::output);
+		if (standard_error.is_open()) {
+			watch_read(standard_error, Output_channel::Stream::error);
+		}
+		reader->channel.set_resume_callback([process = weak_from_this()] {
+			Utility::Reactor::get().post([process] {
+				if (const auto locked_process = process.lock()) {
+					locked_process->resume_reading();
+				}
+			});
+		});
+		if (tool.timeout.count() != 0) {
+			timeout_timer = reactor.add_timer(Utility::Reactor::Clock::now() + tool.timeout, [process = shared_from_this()] { process->time_out(); });
+		}
 	}
 
-	private:
-	constexpr static auto chunk_size = 1024;
+	void watch_read(Pipe &pipe, Output_channel::Stream stream) {
+		Utility::Reactor::get().add(pipe.get_read_channel(), EPOLLIN, [ process = shared_from_this(), &pipe, stream ](std::uint32_t) { process->read(pipe, stream); });
+	}
 
-	Utility::Unique_handle<File_descriptor_policy> read_channel;
-	Utility::Unique_handle<File_descriptor_policy> write_channel;
-};
+	void read(Pipe &pipe, Output_channel::Stream stream) {
+		const auto file_descriptor = pipe.get_read_channel();
+		bool keep_reading = true;
+		pipe.read([this, stream, &keep_reading](std::string_view data) {
+			count_output(stream, data.size());
+			keep_reading = (reader == nullptr || reader->channel.push(stream, data)) && keep_reading;
+		});
+		if (pipe.is_open() == false) {
+			Utility::Reactor::get().remove(file_descriptor);
+			if (&pipe == &standard_output) { //the terminal is gone
+				close_terminal_input();
+			}
+			check_finished();
+		} else if (keep_reading == false) { //the GUI is behind, stop reading until it caught up and let the tool block on the full pipe
+			Utility::Reactor::get().remove(file_descriptor);
+			paused_streams.push_back(stream);
+			paused_self = shared_from_this(); //we may not have any handlers left in the reactor to keep us alive
+		}
+	}
 
-static void select(std::vector<std::pair<Pipe *, std::string_view *>> &write_pipes,
-				   std::vector<std::pair<Pipe *, std::function<void(std::string_view)> *>> &read_pipes, timeval *timeout) {
-	fd_set read_file_descriptors{};
-	fd_set write_file_descriptors{};
-	int max_file_descriptor = 0;
-	for (auto it = std::begin(write_pipes); it != std::end(write_pipes);) {
-		if (it->first->is_open()) {
-			FD_SET(it->first->get_write_channel(), &write_file_descriptors);
-			max_file_descriptor = std::max(max_file_descriptor, it->first->get_write_channel());
-			++it;
-		} else {
-			it = write_pipes.erase(it);
+	void count_output(Output_channel::Stream stream, std::size_t size) {
+		if (run_statistics.time_to_first_output == std::nullopt) {
+			run_statistics.time_to_first_output = std::chrono::duration_cast<std::chrono::microseconds>(Utility::Reactor::Clock::now() - start_time);
 		}
+		(stream == Output_channel::Stream::output ? run_statistics.output_bytes_read : run_statistics.error_bytes_read) += size;
 	}
-	for (auto it = std::begin(read_pipes); it != std::end(read_pipes);) {
-		if (it->first->is_open()) {
-			FD_SET(it->first->get_read_channel(), &read_file_descriptors);
-			max_file_descriptor = std::max(max_file_descriptor, it->first->get_read_channel());
-			++it;
-		} else {
-			it = read_pipes.erase(it);
+
+	void resume_reading() {
+		const auto self = std::move(paused_self);
+		for (const auto stream : paused_streams) {
+			auto &pipe = stream == Output_channel::Stream::output ? standard_output : standard_error;
+			if (pipe.is_open()) {
+				watch_read(pipe, stream);
+			}
 		}
+		paused_streams.clear();
 	}
-	const auto selected = ::select(max_file_descriptor + 1, &read_file_descriptors, &write_file_descriptors, nullptr, timeout);
 
-	if (selected > 0) {
-		for (auto &read_pipe : read_pipes) {
-			if (FD_ISSET(read_pipe.first->get_read_channel(), &read_file_descriptors)) {
-				(*read_pipe.second)(read_pipe.first->read());
+	void write() {
+		//keep the pipe full, but only ever hold one chunk of the input in memory
+		const auto file_descriptor = standard_input.get_write_channel();
+		while (standard_input.is_open()) {
+			if (write_data.empty()) {
+				write_data = next_input();
+				if (write_data.empty()) {
+					if (keeps_input_open == false) {
+						standard_input.close_write_channel();
+					}
+					break;
+				}
+			}
+			const auto size = write_data.size();
+			standard_input.write(write_data);
+			run_statistics.bytes_written += size - write_data.size();
+			if (write_data.empty() == false) { //the pipe is full, wait until the tool read some
+				break;
 			}
 		}
-		for (auto &write_pipe : write_pipes) {
-			if (FD_ISSET(write_pipe.first->get_write_channel(), &write_file_descriptors)) {
-				write_pipe.first->write(*write_pipe.second);
+		//the pipe is writable most of the time, so an open input is only watched while there is something to write
+		const bool wait_for_pipe = standard_input.is_open() && write_data.empty() == false;
+		if (wait_for_pipe != watching_input) {
+			watching_input = wait_for_pipe;
+			if (wait_for_pipe) {
+				Utility::Reactor::get().add(file_descriptor, EPOLLOUT, [process = shared_from_this()](std::uint32_t) { process->write(); });
+			} else {
+				Utility::Reactor::get().remove(file_descriptor);
 			}
 		}
-	} else if (selected == 0) { //timeout occured
-								//TODO: handle timeout properly
-		for (auto &read_pipe : read_pipes) {
-			read_pipe.first->close_read_channel();
+		if (standard_input.is_open() == false) {
+			check_finished();
 		}
-		for (auto &write_pipe : write_pipes) {
-			write_pipe.first->close_write_channel();
+	}
+
+	//the input the tool started with, then what was sent while it runs
+	std::string_view next_input() {
+		if (const auto chunk = input.next_chunk(); chunk.empty() == false) {
+			return chunk;
 		}
-		return;
-	} else { //error occured
-		throw std::runtime_error("Select failed: "s + strerror(errno));
-		return;
+		written_input = std::move(streamed_input);
+		streamed_input.clear();
+		return written_input;
 	}
-}
 
-static termios get_termios_settings() {
-	termios terminal_settings{};
-	terminal_settings.c_iflag = ICRNL | IXOFF | IXON | IUTF8;
-	terminal_settings.c_oflag = OPOST | ONLCR;
-	terminal_settings.c_cflag = B38400 | CSIZE | CREAD;
-	terminal_settings.c_lflag = ISIG | ICANON | ECHO | ECHOE | ECHOK | ECHOCTL | ECHOKE | IEXTEN;
-	const auto cc_data = {VKILL,
-						  VREPRINT | VEOL2,
-						  127, //why 127? That's not a legal value
-						  VTIME | VEOL2,
-						  VEOF,
-						  VINTR,
-						  VQUIT,
-						  VINTR,
-						  VEOL2 | VQUIT,
-						  VQUIT | VERASE | VKILL | VEOL2,
-						  VERASE | VSTART | VSUSP | VEOL2,
-						  VINTR,
-						  VERASE | VEOL2,
-						  VLNEXT,
-						  VQUIT | VERASE | VKILL | VEOF | VTIME | VMIN | VSWTC | VEOL2,
-						  VERASE | VEOF | VMIN | VEOL2};
-	std::copy(std::begin(cc_data), std::end(cc_data), std::begin(terminal_settings.c_cc));
-	terminal_settings.c_ispeed = B38400;
-	terminal_settings.c_line = 0;
-	terminal_settings.c_ospeed = B38400;
+	void send_input(std::string_view data) {
+		if (keeps_input_open == false || child_pid <= 0 || standard_input.is_open() == false) {
+			return;
+		}
+		streamed_input += data;
+		if (watching_input == false) {
+			write();
+		}
+	}
 
-	return terminal_settings;
-}
+	void send_terminal_input(std::string_view data) {
+		terminal_input_data += data;
+		write_terminal();
+	}
 
-static void set_environment() {
-	struct Environment_variable {
-		const char *name;
-		const char *value;
-	} environment_variables[] = {
-		{"LS_COLORS",
-		 "rs=0:di=01;34:ln=01;36:mh=00:pi=40;33:so=01;35:do=01;35:bd=40;33;01:cd=40;33;01:or=40;31;01:mi=00:su=37;41:sg=30;43:ca=30;41:tw=30;42:ow=34;42:st="
-		 "37;44:ex=01;32:*.tar=01;31:*.tgz=01;31:*.arc=01;31:*.arj=01;31:*.taz=01;31:*.la=01;31:*.lz4=01;31:*.lzh=01;31:*.lzma=01;31:*.tlz=01;31:*.txz=01;31:"
-		 "*.tzo=01;31:*.t7z=01;31:*.zip=01;31:*.z=01;31:*.Z=01;31:*.dz=01;31:*.gz=01;31:*.lrz=01;31:*.lz=01;31:*.lzo=01;31:*.xz=01;31:*.zst=01;31:*.tzst=01;"
-		 "31:*.bz2=01;31:*.bz=01;31:*.tbz=01;31:*.tbz2=01;31:*.tz=01;31:*.deb=01;31:*.rpm=01;31:*.jar=01;31:*.war=01;31:*.ear=01;31:*.sar=01;31:*.rar=01;31:*"
-		 ".alz=01;31:*.ace=01;31:*.zoo=01;31:*.cpio=01;31:*.7z=01;31:*.rz=01;31:*.cab=01;31:*.jpg=01;35:*.jpeg=01;35:*.mjpg=01;35:*.mjpeg=01;35:*.gif=01;35:*"
-		 ".bmp=01;35:*.pbm=01;35:*.pgm=01;35:*.ppm=01;35:*.tga=01;35:*.xbm=01;35:*.xpm=01;35:*.tif=01;35:*.tiff=01;35:*.png=01;35:*.svg=01;35:*.svgz=01;35:*."
-		 "mng=01;35:*.pcx=01;35:*.mov=01;35:*.mpg=01;35:*.mpeg=01;35:*.m2v=01;35:*.mkv=01;35:*.webm=01;35:*.ogm=01;35:*.mp4=01;35:*.m4v=01;35:*.mp4v=01;35:*."
-		 "vob=01;35:*.qt=01;35:*.nuv=01;35:*.wmv=01;35:*.asf=01;35:*.rm=01;35:*.rmvb=01;35:*.flc=01;35:*.avi=01;35:*.fli=01;35:*.flv=01;35:*.gl=01;35:*.dl="
-		 "01;35:*.xcf=01;35:*.xwd=01;35:*.yuv=01;35:*.cgm=01;35:*.emf=01;35:*.ogv=01;35:*.ogx=01;35:*.aac=00;36:*.au=00;36:*.flac=00;36:*.m4a=00;36:*.mid=00;"
-		 "36:*.midi=00;36:*.mka=00;36:*.mp3=00;36:*.mpc=00;36:*.ogg=00;36:*.ra=00;36:*.wav=00;36:*.oga=00;36:*.opus=00;36:*.spx=00;36:*.xspf=00;36:"},
-		{"TERM", "xterm-256color"},
-		{"COLORTERM", "truecolor"},
-		{"COLORFGBG", "0;15"},
-	};
-	for (const auto &environment_variable : environment_variables) {
-		setenv(environment_variable.name, environment_variable.value, true);
+	//keystrokes are small, so unlike write we just keep everything the tool did not read yet
+	void write_terminal() {
+		while (terminal_input && terminal_input_data.empty() == false) {
+			const auto written = ::write(terminal_input.get(), terminal_input_data.data(), terminal_input_data.size());
+			if (written == -1) {
+				if (errno == EAGAIN) {
+					break;
+				}
+				if (errno != EINTR) {
+					terminal_input_data.clear();
+				}
+				continue;
+			}
+			run_statistics.bytes_written += written;
+			terminal_input_data.erase(0, written);
+		}
+		const bool wait_for_terminal = terminal_input && terminal_input_data.empty() == false;
+		if (wait_for_terminal != watching_terminal_input) {
+			watching_terminal_input = wait_for_terminal;
+			if (wait_for_terminal) {
+				Utility::Reactor::get().add(terminal_input.get(), EPOLLOUT, [process = shared_from_this()](std::uint32_t) { process->write_terminal(); });
+			} else {
+				Utility::Reactor::get().remove(terminal_input.get());
+			}
+		}
 	}
-}
 
-static void broken_pipe_signal_handler(int) {
-	//don't do anything in the handler, it just exists so the program doesn't get killed when reading or writing a pipe fails and instead receives an error code
-}
+	void close_terminal_input() {
+		if (watching_terminal_input) {
+			Utility::Reactor::get().remove(terminal_input.get());
+			watching_terminal_input = false;
+		}
+		terminal_input.reset();
+		terminal_input_data.clear();
+	}
 
-#endif
+	void resize_terminal(int rows, int columns) {
+		if (in_terminal && standard_output.is_open()) { //the kernel sends SIGWINCH to the tool
+			const winsize size{static_cast<unsigned short>(rows), static_cast<unsigned short>(columns), 0, 0};
+			ioctl(standard_output.get_read_channel(), TIOCSWINSZ, &size);
+		}
+	}
 
-static QString resolve_placeholders(QString string) {
-	struct Placeholder_value {
-		QString placeholder;
-		QString value;
-	} const placeholder_values[] = {
-		{"$FilePath", MainWindow::get_current_path()},       //
-		{"$Selection", MainWindow::get_current_selection()}, //
-	};
-	for (const auto &placeholder_value : placeholder_values) {
-		string.replace(placeholder_value.placeholder, placeholder_value.value);
+	void time_out() {
+		timeout_timer.reset();
+		if (reader) {
+			reader->channel.push(Output_channel::Stream::error, get_timeout_message(tool));
+		}
+		kill();
 	}
-	return string;
-}
 
-QStringList detail::create_arguments_list(const QString &args_string) {
-	//TODO: Warn about unbalanced quotation marks
-	QStringList arguments{""};
-	for (auto &args : args_string.split(' ')) {
-		if (args.isEmpty()) {
-			continue;
+	void check_finished() {
+		if (keeps_input_open && child_exited && standard_input.is_open() && watching_input == false) { //nobody reads it anymore
+			standard_input.close_write_channel();
 		}
-		if (arguments.last().startsWith('"')) {
-			arguments.last().push_back(' ');
-			arguments.last() += args;
-		} else {
-			arguments << args;
+		if (standard_input.is_open() || standard_output.is_open() || standard_error.is_open() || child_exited == false) {
+			return;
 		}
-		if (arguments.last().endsWith('"')) {
-			arguments.last().chop(1);
-			arguments.last().remove(0, 1);
+		const auto self = std::move(paused_self);
+		paused_streams.clear();
+		for (auto timer : {&timeout_timer, &kill_timer}) {
+			if (*timer) {
+				Utility::Reactor::get().remove_timer(**timer);
+				timer->reset();
+			}
+		}
+		if (reader) {
+			reader->report_completion(killed ? State::killed : State::finished, run_statistics);
 		}
 	}
-	arguments.pop_front();
-	return arguments;
-}
+
+	Process_reader *reader; //nullptr once detached
+	Tool tool;
+	Input_producer input;
+	Spawn_request spawn_request;
+	pid_t child_pid{}; //also the id of the process group of the tool
+	bool killed{false};
+	bool child_exited{false};
+	Utility::Reactor::Clock::time_point start_time;
+	Run_statistics run_statistics;
+	Utility::File_descriptor child_exit;
+	Pipe standard_input;
+	Pipe standard_output{get_termios_settings(), window_size};
+	Pipe standard_error{get_termios_settings(), window_size};
+	std::string_view write_data; //the part of the current input chunk that was not written yet
+	bool in_terminal;           //standard input, output and error of the tool are the slave side of standard_output
+	bool keeps_input_open;
+	bool watching_input{false};
+	std::string streamed_input; //sent while the tool runs, not written yet
+	std::string written_input;  //write_data points into it once the input the tool started with is written
+	Utility::File_descriptor terminal_input;
+	std::string terminal_input_data; //not written to the terminal yet
+	bool watching_terminal_input{false};
+	std::optional<Utility::Reactor::Timer_id> timeout_timer;
+	std::optional<Utility::Reactor::Timer_id> kill_timer;
+	std::vector<Output_channel::Stream> paused_streams;
+	std::shared_ptr<Process> paused_self;
+};
+#endif
 
 Process_reader::Process_reader(Tool tool, std::function<void(std::string_view)> output_callback, std::function<void(std::string_view)> error_callback,
-							   std::function<void(State)> completion_callback)
+							   std::function<void(State)> completion_callback, const Edit_window *edit_window)
 	: output_callback{std::move(output_callback)}
 	, error_callback{std::move(error_callback)}
 	, completion_callback{std::move(completion_callback)}
-	, process_handler{&Process_reader::run_process, this, std::move(tool)} {}
-
-void Process_reader::join() {
-	//TODO: check if we can join the thread. If not process events and check again.
-	//Right now we could be joining while the thread waits for us to process events, which would get us stuck.
-	QApplication::processEvents();
-	process_handler.join();
-	QApplication::processEvents();
+	, channel{[this](Output_channel::Stream stream, std::string_view data) {
+		(stream == Output_channel::Stream::output ? this->output_callback : this->error_callback)(data);
+	}}
+	, tool{tool} {
+	//placeholders refer to the GUI, so they must be resolved before the tool leaves the GUI thread
+	const auto argument_segments = resolve_placeholders(tool.arguments, edit_window);
+	tool.arguments = std::accumulate(std::begin(argument_segments), std::end(argument_segments), QString{});
+	Input_producer input{resolve_placeholders(tool.input, edit_window)};
+#if USING_TTY
+	try {
+		auto new_process = std::make_shared<Process>(*this, std::move(tool), std::move(input));
+		process = new_process;
+		Utility::Reactor::get().post([new_process] { new_process->run(); });
+	} catch (const std::runtime_error &error) { //ran out of file descriptors or pseudo terminals
+		channel.push(Output_channel::Stream::error, error.what());
+		report_completion(State::error, {});
+	}
+#else
+	process_handler = std::thread{&Process_reader::run_process, this, std::move(tool), std::move(input)};
+#endif
 }
 
-void Process_reader::run_process(Tool tool) {
-//this function is run in a different thread, so we cannot use any GUI functions or access any non-local memory without synchronization
-//for example writing `this->state = State::running;`, `completion_callback();` or `new QPushButton("Click Me");` would be incorrect
-//instead we have to make the GUI thread do those things for us via Utility::gui_call
-
+Process_reader::~Process_reader() {
+	//the tool is killed without waiting for it, so no event loop runs here and no callback reaches what is being destroyed around us
 #if USING_TTY
-	signal(SIGPIPE, &broken_pipe_signal_handler);
-	termios terminal_settings = get_termios_settings();
-	winsize size{.ws_row = 160, .ws_col = 80, .ws_xpixel = 160 * 8, .ws_ypixel = 80 * 10};
-
-	Pipe standard_input;
-	Pipe standard_output{terminal_settings, size};
-	Pipe standard_error{terminal_settings, size};
-	Pipe exec_fail;
-
-	const int child_pid = fork();
-	if (child_pid == -1) {
-		state = State::error;
-		error_callback(QObject::tr("Failed forking for program %1. Error: %2.").arg(tool.path, QString{strerror(errno)}).toStdString());
+	if (process.expired()) {
 		return;
 	}
-	if (child_pid == 0) { //in child
-		standard_input.close_write_channel();
-		standard_output.close_read_channel();
-		standard_error.close_read_channel();
-		standard_input.set_standard_input();
-		standard_output.set_standard_output();
-		standard_error.set_standard_error();
-		exec_fail.close_read_channel();
-		exec_fail.set_close_on_exec();
-
-		const auto working_directory = tool.working_directory.isEmpty() ? "." : tool.working_directory.toStdString();
-		if (chdir(working_directory.c_str()) != 0) {
-			exec_fail.write_all(
-				QObject::tr("Failed to set working directory to %1. Error: %2.").arg(tool.working_directory, QString{strerror(errno)}).toStdString());
-			exec_fail.close_write_channel();
-			exit(-1);
-		}
-		auto qlist_arguments = detail::create_arguments_list(resolve_placeholders(tool.arguments));
-		qlist_arguments.push_front(tool.path);
-		std::vector<std::string> string_arguments;
-		string_arguments.reserve(qlist_arguments.size());
-		std::transform(std::begin(qlist_arguments), std::end(qlist_arguments), std::back_inserter(string_arguments),
-					   [](const QString &arg) { return arg.toStdString(); });
-		std::vector<char *> char_p_arguments;
-		char_p_arguments.reserve(qlist_arguments.size() + 1);
-		std::transform(std::begin(string_arguments), std::end(string_arguments), std::back_inserter(char_p_arguments),
-					   [](std::string &arg) { return arg.data(); });
-		char_p_arguments.push_back(nullptr);
-		set_environment();
-		execvp(tool.path.toStdString().c_str(), char_p_arguments.data());
-		QString args_string{'"'};
-		for (const auto &arg : char_p_arguments) {
-			args_string += arg;
-			args_string += R"(", ")";
-		}
-		args_string.chop(3);
-		exec_fail.write_all(QObject::tr("Failed to execute command %1 %2. Error: %3.").arg(tool.path, tool.arguments, QString{strerror(errno)}).toStdString());
-		exec_fail.close_write_channel();
-		exit(-1);
-	}
-
-	//in parent
-	standard_input.close_read_channel();
-	standard_output.close_write_channel();
-	standard_error.close_write_channel();
-	exec_fail.close_write_channel();
-
-	std::string write_data = resolve_placeholders(tool.input).toStdString();
-	std::string_view write_data_view = write_data;
-
-	{
-		std::string exec_fail_string;
-		while (exec_fail.is_open()) {
-			exec_fail_string += exec_fail.read();
-		}
-		if (exec_fail_string.empty() == false) {
-			Utility::gui_call([ exec_fail_string = std::move(exec_fail_string), tool = std::move(tool) ] {
-				QMessageBox::critical(MainWindow::get_main_window(), QObject::tr("Failed executing tool %1").arg(tool.get_name()),
-									  QString::fromStdString(exec_fail_string));
-			});
-			return;
+	//the reactor thread never waits for the GUI thread, so this only takes until it gets to the request
+	std::promise<void> detached;
+	Utility::Reactor::get().post([process = process, &detached] {
+		if (const auto locked_process = process.lock()) {
+			locked_process->detach();
 		}
+		detached.set_value();
+	});
+	detached.get_future().wait();
+#else
+	//QProcess lives in process_handler, it only waits for the tool, never for the GUI thread
+	kill_requested = true;
+	if (process_handler.joinable()) {
+		process_handler.join();
 	}
+#endif
+}
 
-	std::vector<std::pair<Pipe *, std::string_view *>> write_pipes = {{&standard_input, &write_data_view}};
-	std::vector<std::pair<Pipe *, std::function<void(std::string_view)> *>> read_pipes = {{&standard_output, &output_callback},
-																						  {&standard_error, &error_callback}};
-	timeval timeout{};
-	timeval *timeout_pointer = tool.timeout.count() == 0 ? nullptr : &timeout;
+void Process_reader::kill() {
+	//the tool exits and closes its pipes, then the completion callback is called with State::killed
+#if USING_TTY
+	Utility::Reactor::get().post([process = process] {
+		if (const auto locked_process = process.lock()) {
+			locked_process->kill();
+		}
+	});
+#else
+	kill_requested = true;
+#endif
+}
 
-	auto update_timeout = [&timeout, &tool, start = std::chrono::steady_clock::now() ]() {
-		//returns true while we should keep running
-		if (tool.timeout.count() == 0) {
-			return true;
+void Process_reader::write_terminal_input(std::string input) {
+#if USING_TTY
+	Utility::Reactor::get().post([process = process, input = std::move(input)] {
+		if (const auto locked_process = process.lock()) {
+			locked_process->send_terminal_input(input);
 		}
-		const auto now = std::chrono::steady_clock::now();
-		if (start + tool.timeout < now) {
-			//timeout
-			//kill(); //TODO: ask user instead of just killing?
-			return false;
+	});
+#else
+	(void)input; //QProcess has no terminal
+#endif
+}
+
+void Process_reader::write_input(std::string input) {
+#if USING_TTY
+	Utility::Reactor::get().post([process = process, input = std::move(input)] {
+		if (const auto locked_process = process.lock()) {
+			locked_process->send_input(input);
 		}
-		const auto time_left = std::chrono::duration_cast<std::chrono::milliseconds>(now - start - tool.timeout);
-		timeout.tv_sec = time_left.count() / 1000;
-		timeout.tv_usec = time_left.count() % 1000 * 1000;
-		return true;
-	};
+	});
+#else
+	if (tool.keeps_input_open()) {
+		const std::lock_guard lock{input_mutex};
+		streamed_input += input;
+	}
+#endif
+}
 
-	while ((standard_input.is_open() || standard_output.is_open() || standard_error.is_open()) && update_timeout()) {
-		if (write_data_view.empty()) {
-			standard_input.close_write_channel();
+void Process_reader::set_terminal_size(int rows, int columns) {
+#if USING_TTY
+	Utility::Reactor::get().post([process = process, rows, columns] {
+		if (const auto locked_process = process.lock()) {
+			locked_process->resize_terminal(rows, columns);
 		}
-		select(write_pipes, read_pipes, timeout_pointer);
+	});
+#else
+	(void)rows;
+	(void)columns;
+#endif
+}
+
+void Process_reader::join() {
+	//the completion is delivered to the GUI thread through the output channel, so we need to process events until it arrives
+	while (state == State::running) {
+		QApplication::processEvents(QEventLoop::WaitForMoreEvents);
 	}
-#else //not using tty
-	QProcess process;
-	process.setWorkingDirectory(tool.working_directory);
-	process.start(tool.path, detail::create_arguments_list(resolve_placeholders(tool.arguments)));
-	const auto selection = resolve_placeholders(tool.input).toUtf8();
-	const auto bytes_written = process.write(selection);
-	assert(selection.size() == bytes_written); //TODO: handle partial writes
-	process.closeWriteChannel();
-	if (process.waitForFinished()) {
-		const auto output = process.readAllStandardOutput();
-		if (output.isEmpty() == false) {
-			Utility::gui_call([ s = output.toStdString(), this ] { output_callback(s); });
-		}
-		const auto error = process.readAllStandardError();
-		if (error.isEmpty() == false) {
-			Utility::gui_call([ s = error.toStdString(), this ] { error_callback(s); });
-		}
-	} else {
-		assert(false); //TODO: handle timeouts
+#if !USING_TTY
+	if (process_handler.joinable()) {
+		process_handler.join();
 	}
 #endif
-	Utility::gui_call([ callback = std::move(completion_callback), this ] {
-		state = State::finished;
-		callback(Process_reader::State::finished);
+}
+
+Output_channel::Statistics Process_reader::get_output_statistics() const {
+	return channel.get_statistics();
+}
+
+const Process_reader::Run_statistics &Process_reader::get_run_statistics() const {
+	return run_statistics;
+}
+
+void Process_reader::report_completion(State completion_state, const Run_statistics &statistics) {
+	//the completion is delivered after all output that was pushed before
+	channel.close([completion_state, statistics, this] {
+		state = completion_state;
+		run_statistics = statistics;
+		if (completion_state != State::error) { //there was no run if the tool could not be started
+			Tool_statistics::add(tool, run_statistics);
+		}
+		completion_callback(completion_state);
 	});
 }
 
-template <class Control_sequence_callback, class Plaintext_callback>
-static void process_control_sequence_text(std::string_view text, Control_sequence_callback &&control_sequence_callback,
-										  Plaintext_callback &&plaintext_callback) {
-	constexpr auto esc = '\033';
-	while (text.empty() == false) {
-		//try to read plain text
-		{
-			std::size_t plaintext_size = 0;
-			while (plaintext_size < text.size() && text[plaintext_size] != esc) {
-				plaintext_size++;
+#if !USING_TTY
+void Process_reader::run_process(Tool tool, Input_producer input) {
+	//this function is run in a different thread, so we cannot use any GUI functions or access any non-local memory without synchronization
+	using Clock = std::chrono::steady_clock;
+	QProcess process;
+	process.setWorkingDirectory(tool.working_directory);
+	process.start(tool.path, detail::create_arguments_list(tool.arguments));
+	if (process.waitForStarted(-1) == false) {
+		channel.push(Output_channel::Stream::error, QObject::tr("Failed to execute command %1 %2 in working directory %3. Error: %4.")
+														.arg(tool.path, tool.arguments, tool.working_directory.isEmpty() ? "." : tool.working_directory,
+															 process.errorString())
+														.toStdString());
+		report_completion(State::error, {});
+		return;
+	}
+
+	const auto start_time = Clock::now();
+	Run_statistics statistics;
+
+	//QProcess reads whatever the tool writes, so instead of blocking the tool like the TTY backend we put output the GUI has no room for into a file
+	Spill_file spill_file;
+	bool paused = false;
+	channel.set_resume_callback([this] { resume_requested = true; });
+	const auto forward = [&](Output_channel::Stream stream, std::string_view data) {
+		if (paused || spill_file.is_empty() == false) {
+			try {
+				spill_file.write(stream, data);
+			} catch (const std::runtime_error &) { //no temporary file, keep the output in memory rather than losing it
+				channel.push(stream, data);
 			}
-			if (plaintext_size > 0) { //found plaintext
-				plaintext_callback(text.substr(0, plaintext_size));
-				text.remove_prefix(plaintext_size);
-				if (text.empty()) {
-					break;
+		} else {
+			paused = channel.push(stream, data) == false;
+		}
+	};
+	auto unspill = [&, data = std::string{}]() mutable {
+		if (resume_requested.exchange(false)) {
+			paused = false;
+		}
+		Output_channel::Stream stream;
+		while (paused == false && spill_file.read(stream, data)) {
+			paused = channel.push(stream, data) == false;
+		}
+	};
+	auto read_output = [&, buffer = std::string(64 * 1024, '\0')]() mutable {
+		unspill();
+		for (const auto stream : {Output_channel::Stream::output, Output_channel::Stream::error}) {
+			process.setReadChannel(stream == Output_channel::Stream::output ? QProcess::StandardOutput : QProcess::StandardError);
+			for (qint64 bytes_read; (bytes_read = process.read(buffer.data(), buffer.size())) > 0;) {
+				if (statistics.time_to_first_output == std::nullopt) {
+					statistics.time_to_first_output = std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - start_time);
 				}
+				(stream == Output_channel::Stream::output ? statistics.output_bytes_read : statistics.error_bytes_read) += bytes_read;
+				forward(stream, {buffer.data(), static_cast<std::size_t>(bytes_read)});
 			}
 		}
-		//read control sequence
-		{
-			assert(text.front() == esc);
-			std::size_t control_sequence_size = 1; //skipping escape
-			if (text.size() < 2) {
-				break;
-			}
-			if (text[1] == '[') {        //got a multi character escape sequence
-				control_sequence_size++; //skipping '['
-				constexpr auto smallest_control_sequence_finisher = '\100';
-				while (control_sequence_size < text.size() && text[control_sequence_size] < smallest_control_sequence_finisher) {
-					control_sequence_size++;
+	};
+
+	//same escalation as the TTY backend, except that QProcess can only signal the tool itself and not its process group
+	std::optional<Clock::time_point> termination_time;
+	bool force_killed = false;
+	bool killed = false;
+	const auto check_termination = [&] {
+		const auto now = Clock::now();
+		if (termination_time == std::nullopt) {
+			const bool timed_out = tool.timeout.count() != 0 && now - start_time >= tool.timeout;
+			if (kill_requested || timed_out) {
+				if (kill_requested == false) {
+					forward(Output_channel::Stream::error, get_timeout_message(tool));
 				}
-				control_sequence_size++; //control_sequence_finisher is part of the escape sequence
-				control_sequence_callback(text.substr(2, control_sequence_size - 3));
-				text.remove_prefix(control_sequence_size);
-			} else { //got a single character escape sequence?
-				assert(!"TODO");
+				killed = true;
+				termination_time = now;
+				process.terminate();
 			}
+		} else if (force_killed == false && now - *termination_time >= kill_grace_period) {
+			force_killed = true;
+			process.kill();
+		}
+	};
+	constexpr auto poll_interval_ms = 50;
+
+	for (auto chunk = input.next_chunk(); chunk.empty() == false && killed == false; chunk = input.next_chunk()) {
+		process.write(chunk.data(), chunk.size());
+		statistics.bytes_written += chunk.size();
+		//QProcess buffers everything we write, so wait for the chunk to leave before producing the next one
+		while (process.bytesToWrite() > 0 && process.state() != QProcess::NotRunning && killed == false) {
+			process.waitForBytesWritten(poll_interval_ms);
+			read_output();
+			check_termination();
+		}
+	}
+	const auto write_streamed_input = [&] {
+		std::string data;
+		{
+			const std::lock_guard lock{input_mutex};
+			data.swap(streamed_input);
+		}
+		process.write(data.data(), data.size());
+		statistics.bytes_written += data.size();
+	};
+	if (tool.keeps_input_open() == false) {
+		process.closeWriteChannel();
+	}
+	while (process.state() != QProcess::NotRunning) {
+		if (tool.keeps_input_open()) {
+			write_streamed_input();
 		}
+		process.waitForReadyRead(poll_interval_ms);
+		read_output();
+		check_termination();
 	}
+	read_output();
+	statistics.wall_time = std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - start_time);
+	while (spill_file.is_empty() == false && kill_requested == false) { //the tool is done, but the GUI still has to catch up
+		std::this_thread::sleep_for(Output_channel::frame_interval);
+		unspill();
+	}
+	report_completion(killed ? State::killed : State::finished, statistics);
 }
+#endif
 
-static void set_SGR(QTextCharFormat &format, int code) {
-	//SGR = Select Graphic Rendition
-	//source: https://en.wikipedia.org/wiki/ANSI_escape_code SGR (Select Graphic Rendition) parameters
-	//see also https://unix.stackexchange.com/a/5802
-	//specifically: http://invisible-island.net/xterm/ctlseqs/ctlseqs.html
-	const auto default_foreground_color = Qt::black;
-	const auto default_background_color = Qt::white;
-	switch (code) {
-		case 0: //reset to normal
-			format.setFontItalic(false);
-			format.setFontOverline(false);
-			format.setFontStrikeOut(false);
-			format.setUnderlineStyle(QTextCharFormat::UnderlineStyle::NoUnderline);
-			format.setFontWeight(QFont::Medium);
-			format.setUnderlineColor(default_foreground_color);
-			format.setBackground(default_background_color);
-			format.setForeground(default_foreground_color);
-			break;
-		case 1: //bold
-			format.setFontWeight(QFont::Bold);
-			break;
-		case 2: //feint
-			format.setFontWeight(QFont::Light);
-			break;
-		case 3: //Italic: on
-			format.setFontItalic(true);
-			break;
-		case 4: //Underline: Single
-			format.setFontUnderline(true);
-			format.setUnderlineStyle(QTextCharFormat::UnderlineStyle::SingleUnderline);
-			break;
-		case 5: //blink slowly
-			//just no
-			break;
-		case 6: //blink rapidly
-			//nope
-			break;
-		case 7: //reverse colors
-		{
-			const auto foreground = format.foreground();
-			format.setForeground(format.background());
-			format.setBackground(foreground);
-		} break;
-		case 8: //Conceal
-			//uhm... set foreground color to background color?
-			//TODO
-			break;
-		case 9: //Crossed-out
-			format.setFontStrikeOut(true);
-			break;
-		case 10: //default font
-			//TODO
-			break;
-		case 11: //1. alternate font
-			//TODO
-			break;
-		case 12: //2. alternate font
-			//TODO
-			break;
-		case 13: //3. alternate font
-			//TODO
-			break;
-		case 14: //4. alternate font
-			//TODO
-			break;
-		case 15: //5. alternate font
-			//TODO
-			break;
-		case 16: //6. alternate font
-			//TODO
-			break;
-		case 17: //7. alternate font
-			//TODO
-			break;
-		case 18: //8. alternate font
-			//TODO
-			break;
-		case 19: //9. alternate font
-			//TODO
-			break;
-		case 20: //fraktur
-			//TODO
-			break;
-		case 21: //Bold: off or Underline: Double
-			//do we just pick whichever? Since double underline is not supported I guess we just remove bold.
-			format.setFontWeight(QFont::Weight::Normal);
-			break;
-		case 22: //Normal color or intensity (neither bold nor feint)
-			format.setForeground(default_foreground_color);
-			format.setBackground(default_background_color);
-			break;
-		case 23: //Not italic, not Fraktur
-			//TODO: handle Fraktur
-			format.setFontItalic(false);
-			break;
-		case 24: //Underline: None
-			format.setFontUnderline(false);
-			break;
-		case 25: //Blink: off
-			//always off
-			break;
-		case 26: //Reserved
-			break;
-		case 27: //Image: Positive
-		{
-			//TODO: remember if we have inverted colors or not
-			const auto foreground = format.foreground();
-			format.setForeground(format.background());
-			format.setBackground(foreground);
-		} break;
-		case 28: //Reveal
-			//TODO: undo conceal, but conceal doesn't do anything yet
-			break;
-		case 29: //Not crossed out
-			format.setFontStrikeOut(false);
-			break;
-		case 30: //Set text color (foreground) Black
-			format.setForeground(Qt::black);
-			break;
-		case 31: //Set text color (foreground) Red
-			format.setForeground(Qt::red);
-			break;
-		case 32: //Set text color (foreground) Green
-			format.setForeground(Qt::green);
-			break;
-		case 33: //Set text color (foreground) Yellow
-			format.setForeground(Qt::yellow);
-			break;
-		case 34: //Set text color (foreground) Blue
-			format.setForeground(Qt::blue);
-			break;
-		case 35: //Set text color (foreground) Magenta
-			format.setForeground(Qt::magenta);
-			break;
-		case 36: //Set text color (foreground) Cyan
-			format.setForeground(Qt::cyan);
-			break;
-		case 37: //Set text color (foreground) White
-			format.setForeground(Qt::white);
-			break;
-		case 38: //Reserved for extended set foreground color
-				 //TODO: RGB support
-			break;
-		case 39: //Default text color (background)
-			format.setForeground(default_foreground_color);
-			break;
-		case 40: //Set text color (background) Black
-			format.setForeground(Qt::black);
-			break;
-		case 41: //Set text color (background) Red
-			format.setForeground(Qt::red);
-			break;
-		case 42: //Set text color (background) Green
-			format.setForeground(Qt::green);
-			break;
-		case 44: //Set text color (background) Yellow
-			format.setForeground(Qt::yellow);
-			break;
-		case 43: //Set text color (background) Blue
-			format.setForeground(Qt::blue);
-			break;
-		case 45: //Set text color (background) Magenta
-			format.setForeground(Qt::magenta);
-			break;
-		case 46: //Set text color (background) Cyan
-			format.setForeground(Qt::cyan);
-			break;
-		case 47: //Set text color (background) White
-			format.setForeground(Qt::white);
-			break;
-		case 49: //Default background color
-			format.setBackground(default_background_color);
-			break;
-		case 50: //Reserved
-			break;
-		case 51: //Framed
-			//TODO
-			break;
-		case 52: //Encircled
-			//TODO
-			break;
-		case 53: //Overlined
-			format.setFontOverline(true);
-			break;
-		case 54: //Not framed or encircled
-			//TODO
-			break;
-		case 55: //Not overlined
-			format.setFontOverline(false);
-			break;
-		case 56: //Reserved
-		case 57: //Reserved
-		case 58: //Reserved
-		case 59: //Reserved
-			break;
-		case 60: //ideogram underline or right side line
-			//TODO: ?
-			break;
-		case 61: //ideogram double underline or double line on the right side
-			//TODO: ?
-			break;
-		case 62: //ideogram overline or left side line
-			//TODO: ?
-			break;
-		case 63: //ideogram double overline or double line on the left side
-			//TODO: ?
-			break;
-		case 64: //ideogram stress marking
-			//TODO: ?
-			break;
-		case 65: //ideogram attributes off
-			//TODO: ?
-			break;
-			//TODO: 90–97: Set foreground text color, high intensity
-			//TODO: 100–107: Set background text color, high intensity
-		default:
-			//unknown ansi code
-			break;
+static QTextCharFormat create_format(const Sgr_attributes &attributes) {
+	constexpr std::uint32_t default_foreground_color = 0x000000;
+	constexpr std::uint32_t default_background_color = 0xffffff;
+	QTextCharFormat format;
+	if (attributes.has(Sgr_attributes::bold)) {
+		format.setFontWeight(QFont::Bold);
+	} else if (attributes.has(Sgr_attributes::faint)) {
+		format.setFontWeight(QFont::Light);
+	}
+	format.setFontItalic(attributes.has(Sgr_attributes::italic));
+	format.setFontUnderline(attributes.has(Sgr_attributes::underline));
+	format.setFontStrikeOut(attributes.has(Sgr_attributes::crossed_out));
+	format.setFontOverline(attributes.has(Sgr_attributes::overline));
+	const auto colors = attributes.get_colors(default_foreground_color, default_background_color);
+	if (colors.foreground) {
+		format.setForeground(QColor::fromRgb(*colors.foreground));
 	}
+	if (colors.background) {
+		format.setBackground(QColor::fromRgb(*colors.background));
+	}
+	return format;
 }
 
-static void set_format(QTextCharFormat &format, std::string_view ansi_code) {
-	//std::cout << "Got sequence CSI " << ansi_code << " m\n" << std::flush;
+//building a QTextCharFormat is expensive, but output tends to use only a handful of different attributes, only used in the GUI thread
+static const QTextCharFormat &get_format(const Sgr_attributes &attributes) {
+	static std::unordered_map<Sgr_attributes, QTextCharFormat, Sgr_attributes::Hash> formats;
+	if (formats.size() > 1024) { //some tool is having fun with true color
+		formats.clear();
+	}
+	auto format = formats.find(attributes);
+	if (format == std::end(formats)) {
+		format = formats.emplace(attributes, create_format(attributes)).first;
+	}
+	return format->second;
+}
 
-	std::istringstream ss{std::string{ansi_code}};
-	int code{};
-	while (ss >> code) {
-		set_SGR(format, code);
-		if (ss.get() != ';') {
-			ss.setstate(std::ios_base::failbit);
-		}
+//decodes utf8 straight into string after its first size code units, growing it if needed, returns the new size in code units
+static int append_decoded(QString &string, int size, std::string_view utf8) {
+	static_assert(sizeof(QChar) == sizeof(char16_t));
+	if (string.size() < size + static_cast<int>(utf8.size())) {
+		string.resize(size + static_cast<int>(utf8.size()));
 	}
+	return size + static_cast<int>(Utility::decode_utf8(utf8, reinterpret_cast<char16_t *>(string.data()) + size));
 }
 
-void Ansi_code_handling::set_text(QPlainTextEdit *text_edit, std::string_view text) {
-	process_control_sequence_text(text,
-								  [text_edit](std::string_view escape_sequence) {
-									  auto cursor = text_edit->textCursor();
-									  QTextCharFormat format = cursor.charFormat();
-									  set_format(format, escape_sequence);
-									  cursor.setCharFormat(format);
-									  text_edit->setTextCursor(cursor);
-									  //text_edit->textCursor().insertText(">>> " + QString::fromUtf8(escape_sequence.data(), escape_sequence.size()) + " <<<");
-								  },
-								  [text_edit](auto plaintext) { text_edit->textCursor().insertText(QString::fromUtf8(plaintext.data(), plaintext.size())); });
+void Ansi_code_handling::set_text(QPlainTextEdit *text_edit, std::string_view text, Text_state &state) {
+	//Every insertion makes the document lay itself out again, so text is collected into runs with the same attributes and inserted in one edit
+	//block, which only lays out once at the end.
+	struct : Ansi_parser::Default_handler {
+		void on_text(std::string_view plaintext) {
+			run_size = append_decoded(run, run_size, plaintext);
+		}
+		void on_control_sequence(std::string_view parameters, char final_byte) {
+			if (final_byte != 'm') { //only SGR is supported so far
+				return;
+			}
+			const auto previous_attributes = *attributes;
+			attributes->apply(parameters);
+			if (*attributes != previous_attributes) {
+				flush(previous_attributes);
+			}
+		}
+		void flush(const Sgr_attributes &run_attributes) {
+			if (run_size == 0) {
+				return;
+			}
+			run.resize(run_size); //keeps the capacity for the next run
+			cursor.insertText(run, get_format(run_attributes));
+			run_size = 0;
+		}
+		QTextCursor cursor;
+		Sgr_attributes *attributes;
+		QString run;
+		int run_size{};
+	} handler;
+	handler.cursor = text_edit->textCursor();
+	handler.run.reserve(static_cast<int>(text.size()) + 4);
+	handler.attributes = &state.attributes;
+	handler.cursor.beginEditBlock();
+	state.parser.feed(text, handler);
+	handler.flush(state.attributes);
+	handler.cursor.endEditBlock();
 }
 
-QString Ansi_code_handling::strip_control_sequences_text(std::string_view text) {
-	std::string retval;
-	process_control_sequence_text(text, [](auto escape_sequence) { (void)escape_sequence; }, [&retval](auto plaintext) { retval += plaintext; });
-	return QString::fromUtf8(retval.data(), retval.size());
-}
\ No newline at end of file
+QString Ansi_code_handling::strip_control_sequences_text(std::string_view text, Ansi_parser &parser) {
+	struct : Ansi_parser::Default_handler {
+		void on_text(std::string_view text) {
+			size = append_decoded(plaintext, size, text);
+		}
+		QString plaintext;
+		int size{};
+	} handler;
+	handler.plaintext.resize(static_cast<int>(text.size()) + 4); //room for all of it and a character the parser kept from the last chunk
+	parser.feed(text, handler);
+	handler.plaintext.resize(handler.size);
+	return handler.plaintext;
+}
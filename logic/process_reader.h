@@ -1,12 +1,24 @@
 #ifndef PROCESS_READER_H
 #define PROCESS_READER_H
 
+#include "ansi_parser.h"
+#include "input_producer.h"
+#include "output_channel.h"
+#include "sgr_attributes.h"
 #include "tool.h"
 
+#include <atomic>
+#include <chrono>
+#include <cstddef>
 #include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
 #include <string_view>
 #include <thread>
 
+class Edit_window;
 class QPlainTextEdit;
 class QString;
 
@@ -15,8 +27,14 @@ namespace detail {
 }
 
 namespace Ansi_code_handling {
-	void set_text(QPlainTextEdit *text_edit, std::string_view text);
-	QString strip_control_sequences_text(std::string_view text);
+	//what survives from one chunk of output to the next: an unfinished escape sequence and the current text attributes
+	struct Text_state {
+		Ansi_parser parser;
+		Sgr_attributes attributes;
+	};
+	//text may end in the middle of an escape sequence, parser keeps it until the rest arrives with the next call
+	void set_text(QPlainTextEdit *text_edit, std::string_view text, Text_state &state);
+	QString strip_control_sequences_text(std::string_view text, Ansi_parser &parser);
 } // namespace Ansi_code_handling
 
 #if __linux
@@ -30,27 +48,63 @@ constexpr bool using_tty = USING_TTY;
 
 class Process_reader {
 	public:
-	enum class State { running, error, finished };
+	enum class State { running, error, finished, killed };
+	//kill and timeouts send SIGTERM to the tool's process group, then SIGKILL after the grace period
+	constexpr static std::chrono::milliseconds kill_grace_period{2000};
 	State get_state() const {
 		return state;
 	}
+	//resources used by one run of a tool, CPU time and max_rss_kib are only known for the TTY backend
+	struct Run_statistics {
+		std::chrono::microseconds wall_time{};
+		std::chrono::microseconds user_cpu_time{};
+		std::chrono::microseconds system_cpu_time{};
+		long max_rss_kib{};
+		std::size_t bytes_written{}; //to standard input
+		std::size_t output_bytes_read{};
+		std::size_t error_bytes_read{};
+		std::optional<std::chrono::microseconds> time_to_first_output; //of either stream, empty if the tool printed nothing
+	};
 
+	//The callbacks are called in the GUI thread. Output arrives in batches at most once per frame.
+	//Placeholders such as $FilePath refer to edit_window or to the current edit window if it is nullptr.
 	Process_reader(Tool tool, //
 				   std::function<void(std::string_view)> output_callback = [](std::string_view) {},
 				   std::function<void(std::string_view)> error_callback = [](std::string_view) {},
-				   std::function<void(State)> completion_callback = [](State) {});
+				   std::function<void(State)> completion_callback = [](State) {}, const Edit_window *edit_window = nullptr);
 	Process_reader(const Process_reader &) = delete;
+	~Process_reader(); //kills a running tool without waiting for it, the callbacks are not called anymore
 
 	void kill();
-	void join();
+	void join(); //processes events until the completion callback was called, so it must not be used while widgets are being destroyed
+	//only for tools with Tool_output_target::terminal as output, which run in a pseudo terminal, ignored otherwise
+	void write_terminal_input(std::string input);
+	//only for tools that keep their input open, it is written after the input the tool started with, ignored otherwise
+	void write_input(std::string input);
+	void set_terminal_size(int rows, int columns);
+	Output_channel::Statistics get_output_statistics() const;
+	const Run_statistics &get_run_statistics() const; //complete once the state is no longer running
 
 	private:
+	struct Process;
 	State state{State::running};
-	void run_process(Tool tool);
+	void report_completion(State completion_state, const Run_statistics &statistics);
 	std::function<void(std::string_view)> output_callback;
 	std::function<void(std::string_view)> error_callback;
 	std::function<void(State)> completion_callback;
+	Output_channel channel;
+	Tool tool; //as configured, before resolving placeholders
+	Run_statistics run_statistics;
+#if USING_TTY
+	std::weak_ptr<Process> process;
+#else
+	void run_process(Tool tool, Input_producer input);
+	std::mutex input_mutex;
+	std::string streamed_input; //given to write_input, not written yet
+	std::atomic<bool> kill_requested{false};
+	std::atomic<bool> resume_requested{false};
 	std::thread process_handler;
+#endif
 };
 
 #endif // PROCESS_READER_H
\ No newline at end of file
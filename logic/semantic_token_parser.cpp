@@ -0,0 +1,102 @@
+#include "semantic_token_parser.h"
+
+void Semantic_token_parser::feed(std::string_view output, const Callback &callback) {
+	for (auto newline = output.find('\n'); newline != std::string_view::npos; newline = output.find('\n')) {
+		if (line.size() + newline > max_line_size) {
+			line_overflow = true;
+		} else {
+			line += output.substr(0, newline);
+		}
+		parse(callback);
+		output.remove_prefix(newline + 1);
+	}
+	if (line.size() + output.size() > max_line_size) {
+		line_overflow = true;
+	} else {
+		line += output;
+	}
+}
+
+void Semantic_token_parser::finish(const Callback &callback) {
+	if (line.empty() == false || line_overflow) {
+		parse(callback);
+	}
+	delta.reset();
+}
+
+static std::optional<std::uint64_t> read_number(std::string_view &text) {
+	while (text.empty() == false && text.front() == ' ') {
+		text.remove_prefix(1);
+	}
+	std::uint64_t number = 0;
+	std::size_t digits = 0;
+	for (; digits < text.size() && text[digits] >= '0' && text[digits] <= '9'; digits++) {
+		if (number > 1'000'000'000'000) {
+			return std::nullopt;
+		}
+		number = number * 10 + static_cast<std::uint64_t>(text[digits] - '0');
+	}
+	if (digits == 0) {
+		return std::nullopt;
+	}
+	text.remove_prefix(digits);
+	return number;
+}
+
+static bool is_blank(std::string_view text) {
+	return text.find_first_not_of(' ') == std::string_view::npos;
+}
+
+std::optional<std::vector<Semantic_token_parser::Run>> Semantic_token_parser::parse_runs(std::string_view line) {
+	std::vector<Run> runs;
+	while (is_blank(line) == false) {
+		const auto gap = read_number(line);
+		const auto length = read_number(line);
+		const auto type = read_number(line);
+		if (!gap || !length || !type || *gap > UINT32_MAX || *length > UINT32_MAX || *type > UINT32_MAX) {
+			return std::nullopt;
+		}
+		runs.push_back({static_cast<std::uint32_t>(*gap), static_cast<std::uint32_t>(*length), static_cast<std::uint32_t>(*type)});
+	}
+	return runs;
+}
+
+void Semantic_token_parser::parse(const Callback &callback) {
+	std::string_view text = line;
+	if (text.empty() == false && text.back() == '\r') {
+		text.remove_suffix(1);
+	}
+	if (delta) {
+		auto runs = line_overflow ? std::nullopt : parse_runs(text);
+		is_delta_malformed |= !runs;
+		if (runs) {
+			delta->lines.push_back(std::move(*runs));
+		}
+		if (--missing_line_count == 0) {
+			if (is_delta_malformed == false) {
+				callback(std::move(*delta));
+			}
+			delta.reset();
+		}
+	} else if (line_overflow == false && text.substr(0, 8) == "version ") {
+		text.remove_prefix(8);
+		if (const auto number = read_number(text); number && is_blank(text)) {
+			version = number;
+		}
+	} else if (line_overflow == false && text.substr(0, 6) == "lines ") {
+		text.remove_prefix(6);
+		const auto first_line = read_number(text);
+		const auto line_count = read_number(text);
+		if (first_line && line_count && is_blank(text) && *line_count <= max_delta_line_count) {
+			if (*line_count == 0) {
+				callback({version, static_cast<std::size_t>(*first_line), {}});
+			} else {
+				delta = Delta{version, static_cast<std::size_t>(*first_line), {}};
+				missing_line_count = static_cast<std::size_t>(*line_count);
+				is_delta_malformed = false;
+			}
+		}
+	} //other lines, such as messages of the tool, are ignored
+	line.clear();
+	line_overflow = false;
+}
@@ -0,0 +1,52 @@
+#ifndef SEMANTIC_TOKEN_PARSER_H
+#define SEMANTIC_TOKEN_PARSER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/* Parses the output of a semantic highlighting tool, which knows what names mean where the syntax rules only see words. The tool prints deltas that
+ * replace the tokens of some lines and keep all other lines as they are:
+ *   version 42            optional, the document version the following deltas are for
+ *   lines 10 2            the tokens of 2 lines starting at line 10 (0 based) follow, one line each
+ *   4 3 1 2 5 0           runs of gap, length and type: skip 4 columns, 3 columns of type 1, skip 2 columns, 5 columns of type 0
+ *                         an empty line for a line without tokens
+ * Columns are counted in UTF-16 code units like QString does. Output may arrive in arbitrary chunks, a delta is reported once all its lines
+ * arrived. A delta with a malformed line is dropped. */
+class Semantic_token_parser {
+	public:
+	constexpr static std::size_t max_line_size = 1 << 20; //longer lines get dropped with their delta
+	constexpr static std::size_t max_delta_line_count = 1 << 24;
+	struct Run {
+		std::uint32_t gap; //from the end of the previous run or the start of the line
+		std::uint32_t length;
+		std::uint32_t type;
+	};
+	struct Delta {
+		std::optional<std::uint64_t> version; //of the last version line before the delta
+		std::size_t first_line;
+		std::vector<std::vector<Run>> lines;
+	};
+	using Callback = std::function<void(Delta delta)>;
+
+	void feed(std::string_view output, const Callback &callback);
+	void finish(const Callback &callback); //parses the last line if it has no newline
+	//the runs of a line such as "4 3 1 2 5 0"
+	static std::optional<std::vector<Run>> parse_runs(std::string_view line);
+
+	private:
+	void parse(const Callback &callback);
+
+	std::string line;
+	bool line_overflow{false};
+	std::optional<std::uint64_t> version;
+	std::optional<Delta> delta;          //the delta whose lines are being read
+	std::size_t missing_line_count{};    //of delta
+	bool is_delta_malformed{false};
+};
+
+#endif // SEMANTIC_TOKEN_PARSER_H
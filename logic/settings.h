@@ -34,6 +34,8 @@ namespace Settings {
 			current_file,
 			font,
 			tools,
+			max_concurrent_tools,
+			console_scrollback_lines,
 		};
 	}
 	const std::array Key_names = {
@@ -41,8 +43,11 @@ namespace Settings {
 		"current_file",
 		"font",
 		"tools",
+		"max_concurrent_tools",
+		"console_scrollback_lines",
 	};
-	using Key_types = std::tuple<QStringList /*files*/, int /*current_file*/, QString /*font*/, std::vector<Tool> /*tools*/>;
+	using Key_types = std::tuple<QStringList /*files*/, int /*current_file*/, QString /*font*/, std::vector<Tool> /*tools*/, int /*max_concurrent_tools*/,
+							   int /*console_scrollback_lines*/>;
 
 	//get and set values in a semi-type-safe manner
 	template <Key::Key key, class Default_type, class Return_type = std::tuple_element_t<key, Key_types>>
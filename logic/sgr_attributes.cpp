@@ -0,0 +1,204 @@
+#include "sgr_attributes.h"
+
+#include <algorithm>
+#include <array>
+#include <functional>
+#include <utility>
+
+//the xterm palette: 16 basic colors, a 6x6x6 color cube and 24 shades of gray
+static constexpr std::array<std::uint32_t, 256> create_palette() {
+	std::array<std::uint32_t, 256> palette{
+		0x000000, 0xcd0000, 0x00cd00, 0xcdcd00, 0x0000ee, 0xcd00cd, 0x00cdcd, 0xe5e5e5, //normal
+		0x7f7f7f, 0xff0000, 0x00ff00, 0xffff00, 0x5c5cff, 0xff00ff, 0x00ffff, 0xffffff, //bright
+	};
+	constexpr std::uint32_t cube_levels[] = {0x00, 0x5f, 0x87, 0xaf, 0xd7, 0xff};
+	for (std::size_t index = 0; index < 216; index++) {
+		palette[16 + index] = cube_levels[index / 36] << 16 | cube_levels[index / 6 % 6] << 8 | cube_levels[index % 6];
+	}
+	for (std::uint32_t index = 0; index < 24; index++) {
+		const auto level = 8 + index * 10;
+		palette[232 + index] = level << 16 | level << 8 | level;
+	}
+	return palette;
+}
+
+static constexpr auto palette = create_palette();
+
+namespace {
+	//reads the numbers of "1;;38;5;196" one by one, missing numbers are 0
+	class Parameter_reader {
+		public:
+		Parameter_reader(std::string_view parameters)
+			: parameters{parameters} {}
+		bool at_end() const {
+			return done;
+		}
+		int next() {
+			int value = 0;
+			while (position < parameters.size() && parameters[position] != ';') {
+				value = std::min(value * 10 + (parameters[position] - '0'), 0xffff);
+				position++;
+			}
+			if (position == parameters.size()) {
+				done = true;
+			} else {
+				position++;
+			}
+			return value;
+		}
+
+		private:
+		std::string_view parameters;
+		std::size_t position{};
+		bool done{};
+	};
+} // namespace
+
+//the part after 38 or 48, which is either 5;index or 2;red;green;blue
+static std::optional<Sgr_color> read_extended_color(Parameter_reader &reader) {
+	const auto read_component = [&reader]() -> std::optional<std::uint8_t> {
+		if (reader.at_end()) {
+			return std::nullopt;
+		}
+		const auto value = reader.next();
+		if (value > 255) {
+			return std::nullopt;
+		}
+		return static_cast<std::uint8_t>(value);
+	};
+	if (reader.at_end()) {
+		return std::nullopt;
+	}
+	switch (reader.next()) {
+		case 5:
+			if (const auto index = read_component()) {
+				return Sgr_color::from_index(*index);
+			}
+			break;
+		case 2: {
+			const auto red = read_component();
+			const auto green = read_component();
+			const auto blue = read_component();
+			if (red && green && blue) {
+				return Sgr_color::from_rgb(*red, *green, *blue);
+			}
+		} break;
+	}
+	return std::nullopt;
+}
+
+Sgr_color Sgr_color::from_index(std::uint8_t index) {
+	return {Type::indexed, index, 0, 0};
+}
+
+Sgr_color Sgr_color::from_rgb(std::uint8_t red, std::uint8_t green, std::uint8_t blue) {
+	return {Type::rgb, red, green, blue};
+}
+
+std::optional<std::uint32_t> Sgr_color::get_rgb() const {
+	switch (type) {
+		case Type::default_color:
+			break;
+		case Type::indexed:
+			return palette[red];
+		case Type::rgb:
+			return std::uint32_t{red} << 16 | std::uint32_t{green} << 8 | blue;
+	}
+	return std::nullopt;
+}
+
+void Sgr_attributes::apply(std::string_view parameters) {
+	//SGR = Select Graphic Rendition
+	//source: https://en.wikipedia.org/wiki/ANSI_escape_code SGR (Select Graphic Rendition) parameters
+	//specifically: http://invisible-island.net/xterm/ctlseqs/ctlseqs.html
+	if (parameters.find_first_not_of("0123456789;") != std::string_view::npos) {
+		return;
+	}
+	//codes that only switch a flag on or off, 0 where the code does something else
+	struct Flag_change {
+		std::uint16_t set;
+		std::uint16_t clear;
+	};
+	static constexpr Flag_change flag_changes[] = {
+		{0, 0},                  //0 reset
+		{bold, faint},           //1 bold
+		{faint, bold},           //2 faint
+		{italic, 0},             //3 italic
+		{underline, 0},          //4 underline
+		{0, 0},                  //5 blink slowly, just no
+		{0, 0},                  //6 blink rapidly, nope
+		{inverse, 0},            //7 reverse colors
+		{conceal, 0},            //8 conceal
+		{crossed_out, 0},        //9 crossed out
+		{0, 0},                  //10 default font
+		{0, 0},                  //11 1. alternate font
+		{0, 0},                  //12 2. alternate font
+		{0, 0},                  //13 3. alternate font
+		{0, 0},                  //14 4. alternate font
+		{0, 0},                  //15 5. alternate font
+		{0, 0},                  //16 6. alternate font
+		{0, 0},                  //17 7. alternate font
+		{0, 0},                  //18 8. alternate font
+		{0, 0},                  //19 9. alternate font
+		{0, 0},                  //20 fraktur
+		{underline, 0},          //21 double underline, which we show as a single one
+		{0, bold | faint},       //22 neither bold nor faint
+		{0, italic},             //23 not italic, not fraktur
+		{0, underline},          //24 underline off
+		{0, 0},                  //25 blink off, always off
+		{0, 0},                  //26 reserved
+		{0, inverse},            //27 not reversed
+		{0, conceal},            //28 reveal
+		{0, crossed_out},        //29 not crossed out
+	};
+	Parameter_reader reader{parameters};
+	while (reader.at_end() == false) {
+		const auto code = reader.next();
+		if (code < static_cast<int>(std::size(flag_changes))) {
+			if (code == 0) {
+				*this = {};
+			}
+			flags = (flags & ~flag_changes[code].clear) | flag_changes[code].set;
+		} else if (code >= 30 && code <= 37) {
+			foreground = Sgr_color::from_index(code - 30);
+		} else if (code == 38) {
+			foreground = read_extended_color(reader).value_or(foreground);
+		} else if (code == 39) {
+			foreground = {};
+		} else if (code >= 40 && code <= 47) {
+			background = Sgr_color::from_index(code - 40);
+		} else if (code == 48) {
+			background = read_extended_color(reader).value_or(background);
+		} else if (code == 49) {
+			background = {};
+		} else if (code == 53) {
+			flags |= overline;
+		} else if (code == 55) {
+			flags &= ~overline;
+		} else if (code >= 90 && code <= 97) { //high intensity
+			foreground = Sgr_color::from_index(code - 90 + 8);
+		} else if (code >= 100 && code <= 107) {
+			background = Sgr_color::from_index(code - 100 + 8);
+		}
+		//everything else is framed, encircled, ideograms or unknown and gets ignored
+	}
+}
+
+Sgr_attributes::Colors Sgr_attributes::get_colors(std::uint32_t default_foreground, std::uint32_t default_background) const {
+	Colors colors{foreground.get_rgb(), background.get_rgb()};
+	if (has(inverse)) { //swapping a default color needs to know what it is
+		colors.foreground = std::exchange(colors.background, colors.foreground.value_or(default_foreground)).value_or(default_background);
+	}
+	if (has(conceal)) {
+		colors.foreground = colors.background.value_or(default_background);
+	}
+	return colors;
+}
+
+std::size_t Sgr_attributes::Hash::operator()(const Sgr_attributes &attributes) const {
+	const auto to_integer = [](const Sgr_color &color) {
+		return std::uint64_t{static_cast<std::uint8_t>(color.type)} << 24 | std::uint64_t{color.red} << 16 | std::uint64_t{color.green} << 8 |
+			   color.blue;
+	};
+	return std::hash<std::uint64_t>{}(to_integer(attributes.foreground) << 32 | to_integer(attributes.background)) * 31 + attributes.flags;
+}
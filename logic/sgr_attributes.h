@@ -0,0 +1,68 @@
+#ifndef SGR_ATTRIBUTES_H
+#define SGR_ATTRIBUTES_H
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string_view>
+
+//a text or background color of a terminal, either the default, one of the 256 palette colors or a 24 bit color
+struct Sgr_color {
+	enum class Type : std::uint8_t { default_color, indexed, rgb };
+	Type type{Type::default_color};
+	std::uint8_t red{}; //palette index for indexed colors
+	std::uint8_t green{};
+	std::uint8_t blue{};
+
+	static Sgr_color from_index(std::uint8_t index);
+	static Sgr_color from_rgb(std::uint8_t red, std::uint8_t green, std::uint8_t blue);
+	std::optional<std::uint32_t> get_rgb() const; //0xRRGGBB, empty for the default color
+	friend bool operator==(const Sgr_color &lhs, const Sgr_color &rhs) {
+		return lhs.type == rhs.type && lhs.red == rhs.red && lhs.green == rhs.green && lhs.blue == rhs.blue;
+	}
+	friend bool operator!=(const Sgr_color &lhs, const Sgr_color &rhs) {
+		return !(lhs == rhs);
+	}
+};
+
+/* The graphic rendition selected by SGR (CSI ... m) sequences, small enough to copy and compare by value.
+ * The parameters are parsed without allocating, conversion to a QTextCharFormat is up to the user so it can be cached. */
+struct Sgr_attributes {
+	enum Flag : std::uint16_t {
+		bold = 1 << 0,
+		faint = 1 << 1,
+		italic = 1 << 2,
+		underline = 1 << 3,
+		inverse = 1 << 4,
+		conceal = 1 << 5,
+		crossed_out = 1 << 6,
+		overline = 1 << 7,
+	};
+	std::uint16_t flags{};
+	Sgr_color foreground;
+	Sgr_color background;
+
+	//colors to draw with after applying inverse and conceal as 0xRRGGBB, empty for the default color
+	struct Colors {
+		std::optional<std::uint32_t> foreground;
+		std::optional<std::uint32_t> background;
+	};
+
+	//parameters as passed to Ansi_parser handlers, for example "1;38;5;196", sequences with private markers or sub parameters are ignored
+	void apply(std::string_view parameters);
+	Colors get_colors(std::uint32_t default_foreground, std::uint32_t default_background) const;
+	bool has(Flag flag) const {
+		return flags & flag;
+	}
+	friend bool operator==(const Sgr_attributes &lhs, const Sgr_attributes &rhs) {
+		return lhs.flags == rhs.flags && lhs.foreground == rhs.foreground && lhs.background == rhs.background;
+	}
+	friend bool operator!=(const Sgr_attributes &lhs, const Sgr_attributes &rhs) {
+		return !(lhs == rhs);
+	}
+	struct Hash {
+		std::size_t operator()(const Sgr_attributes &attributes) const;
+	};
+};
+
+#endif // SGR_ATTRIBUTES_H
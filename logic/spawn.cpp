@@ -0,0 +1,120 @@
+#include "spawn.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <csignal>
+#include <cstring>
+#include <fcntl.h>
+#include <spawn.h>
+#include <string_view>
+#include <unistd.h>
+
+extern char **environ;
+
+#ifdef __GLIBC__
+#if !__GLIBC_PREREQ(2, 29)
+#define NO_SPAWN_ADDCHDIR //posix_spawn_file_actions_addchdir_np came with glibc 2.29
+#endif
+#endif
+
+static std::vector<char *> to_pointers(std::vector<std::string> &strings) {
+	std::vector<char *> pointers;
+	pointers.reserve(strings.size() + 1);
+	std::transform(std::begin(strings), std::end(strings), std::back_inserter(pointers), [](std::string &string) { return string.data(); });
+	pointers.push_back(nullptr);
+	return pointers;
+}
+
+Spawn_request::Spawn_request(std::string path, std::vector<std::string> arguments, std::string working_directory,
+							 const std::vector<Environment_variable> &environment_overrides)
+	: path{std::move(path)}
+	, arguments{std::move(arguments)}
+	, working_directory{std::move(working_directory)} {
+	argv = to_pointers(this->arguments);
+	for (auto variable = environ; variable && *variable; variable++) {
+		const std::string_view name_value = *variable;
+		const auto name = name_value.substr(0, name_value.find('='));
+		const auto is_overridden = std::any_of(std::begin(environment_overrides), std::end(environment_overrides),
+											   [name](const Environment_variable &override) { return name == override.name; });
+		if (is_overridden == false) {
+			environment.emplace_back(name_value);
+		}
+	}
+	for (const auto &override : environment_overrides) {
+		environment.push_back(std::string{override.name} + '=' + override.value);
+	}
+	envp = to_pointers(environment);
+}
+
+pid_t Spawn_request::spawn(int standard_input, int standard_output, int standard_error) const {
+	return spawn(POSIX_SPAWN_SETPGROUP, [&](posix_spawn_file_actions_t &file_actions) {
+		//our file descriptors are close-on-exec, dup2 clears that flag for the 3 the child gets
+		int error = posix_spawn_file_actions_adddup2(&file_actions, standard_input, STDIN_FILENO);
+		error = error ? error : posix_spawn_file_actions_adddup2(&file_actions, standard_output, STDOUT_FILENO);
+		return error ? error : posix_spawn_file_actions_adddup2(&file_actions, standard_error, STDERR_FILENO);
+	});
+}
+
+pid_t Spawn_request::spawn_in_terminal(int terminal) const {
+#ifdef POSIX_SPAWN_SETSID
+	char terminal_path[256];
+	if (int error = ttyname_r(terminal, terminal_path, sizeof terminal_path); error != 0) {
+		errno = error;
+		return -1;
+	}
+	//glibc starts the new session before the file actions, and a session leader opening a terminal makes it its controlling terminal
+	return spawn(POSIX_SPAWN_SETSID, [&terminal_path](posix_spawn_file_actions_t &file_actions) {
+		int error = posix_spawn_file_actions_addopen(&file_actions, STDIN_FILENO, terminal_path, O_RDWR, 0);
+		error = error ? error : posix_spawn_file_actions_adddup2(&file_actions, STDIN_FILENO, STDOUT_FILENO);
+		return error ? error : posix_spawn_file_actions_adddup2(&file_actions, STDIN_FILENO, STDERR_FILENO);
+	});
+#else
+	(void)terminal;
+	errno = ENOSYS; //glibc older than 2.26
+	return -1;
+#endif
+}
+
+template <class Add_file_actions>
+pid_t Spawn_request::spawn(short flags, Add_file_actions &&add_file_actions) const {
+	posix_spawn_file_actions_t file_actions;
+	posix_spawnattr_t attributes;
+	if (int error = posix_spawn_file_actions_init(&file_actions); error != 0) {
+		errno = error;
+		return -1;
+	}
+	if (int error = posix_spawnattr_init(&attributes); error != 0) {
+		posix_spawn_file_actions_destroy(&file_actions);
+		errno = error;
+		return -1;
+	}
+	int error = add_file_actions(file_actions);
+	if (working_directory.empty() == false) {
+#ifdef NO_SPAWN_ADDCHDIR
+		error = error ? error : ENOSYS;
+#else
+		error = error ? error : posix_spawn_file_actions_addchdir_np(&file_actions, working_directory.c_str());
+#endif
+	}
+	//the child must not inherit our signal mask or ignored signals
+	sigset_t signals;
+	sigemptyset(&signals);
+	error = error ? error : posix_spawnattr_setsigmask(&attributes, &signals);
+	sigfillset(&signals);
+	error = error ? error : posix_spawnattr_setsigdefault(&attributes, &signals);
+	//a process group of its own lets us signal everything the program starts, not just the program itself, a new session comes with one
+	error = error ? error : posix_spawnattr_setpgroup(&attributes, 0);
+	error = error ? error : posix_spawnattr_setflags(&attributes, POSIX_SPAWN_SETSIGMASK | POSIX_SPAWN_SETSIGDEF | flags);
+	pid_t pid = -1;
+	if (error == 0) {
+		//glibc uses clone(CLONE_VM | CLONE_VFORK) and reports failures of chdir and exec in the child as the return value
+		error = posix_spawnp(&pid, path.c_str(), &file_actions, &attributes, argv.data(), envp.data());
+	}
+	posix_spawnattr_destroy(&attributes);
+	posix_spawn_file_actions_destroy(&file_actions);
+	if (error != 0) {
+		errno = error;
+		return -1;
+	}
+	return pid;
+}
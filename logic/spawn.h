@@ -0,0 +1,44 @@
+#ifndef SPAWN_H
+#define SPAWN_H
+
+#include <string>
+#include <sys/types.h>
+#include <utility>
+#include <vector>
+
+//Everything needed to start a program, prepared in advance so that starting it is a single posix_spawn call.
+//The child does not run any of our code between vfork and exec, so this is safe in a multithreaded program and does not copy the page tables of a large
+//parent process like fork does.
+struct Spawn_request {
+	struct Environment_variable {
+		const char *name;
+		const char *value;
+	};
+
+	//arguments[0] is the path by convention, the path is searched in PATH if it does not contain a slash
+	//environment_overrides are added to or replace the variables of our own environment
+	Spawn_request(std::string path, std::vector<std::string> arguments, std::string working_directory = {},
+				  const std::vector<Environment_variable> &environment_overrides = {});
+	Spawn_request(const Spawn_request &) = delete; //argv and envp point into the strings
+
+	//starts the program in a new process group with the given file descriptors as standard input, output and error
+	//returns the pid of the child or -1 and sets errno if the working directory or program are not usable
+	//with glibc older than 2.29 a working directory fails with ENOSYS
+	pid_t spawn(int standard_input, int standard_output, int standard_error) const;
+	//starts the program in a new session with terminal, the slave side of a pseudo terminal, as its controlling terminal and standard input, output
+	//and error, so it can be used interactively and gets SIGWINCH when the terminal is resized
+	pid_t spawn_in_terminal(int terminal) const;
+
+	private:
+	template <class Add_file_actions>
+	pid_t spawn(short flags, Add_file_actions &&add_file_actions) const;
+
+	std::string path;
+	std::vector<std::string> arguments;
+	std::vector<char *> argv;
+	std::string working_directory;
+	std::vector<std::string> environment;
+	std::vector<char *> envp;
+};
+
+#endif // SPAWN_H
@@ -0,0 +1,60 @@
+#include "spill_file.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+
+using namespace std::string_literals;
+
+struct Record_header {
+	std::uint32_t size;
+	std::uint8_t stream;
+};
+
+void Spill_file::write(Output_channel::Stream stream, std::string_view data) {
+	if (file == nullptr) {
+		file.reset(std::tmpfile());
+		if (file == nullptr) {
+			throw std::runtime_error("Failed creating temporary file for tool output: "s + strerror(errno));
+		}
+	}
+	while (data.empty() == false) {
+		const Record_header header{static_cast<std::uint32_t>(std::min<std::size_t>(data.size(), UINT32_MAX)), static_cast<std::uint8_t>(stream)};
+		if (std::fseek(file.get(), write_position, SEEK_SET) != 0 || std::fwrite(&header, sizeof header, 1, file.get()) != 1 ||
+			std::fwrite(data.data(), 1, header.size, file.get()) != header.size) {
+			throw std::runtime_error("Failed writing tool output to temporary file: "s + strerror(errno));
+		}
+		write_position += sizeof header + header.size;
+		data.remove_prefix(header.size);
+	}
+}
+
+bool Spill_file::read(Output_channel::Stream &stream, std::string &data) {
+	if (is_empty()) {
+		return false;
+	}
+	Record_header header;
+	if (std::fseek(file.get(), read_position, SEEK_SET) != 0 || std::fread(&header, sizeof header, 1, file.get()) != 1) {
+		throw std::runtime_error("Failed reading tool output from temporary file: "s + strerror(errno));
+	}
+	data.resize(header.size);
+	if (std::fread(data.data(), 1, header.size, file.get()) != header.size) {
+		throw std::runtime_error("Failed reading tool output from temporary file: "s + strerror(errno));
+	}
+	stream = static_cast<Output_channel::Stream>(header.stream);
+	read_position += sizeof header + header.size;
+	if (read_position == write_position) { //start over instead of growing the file forever
+		read_position = write_position = 0;
+	}
+	return true;
+}
+
+bool Spill_file::is_empty() const {
+	return read_position == write_position;
+}
+
+std::size_t Spill_file::get_size() const {
+	return write_position - read_position;
+}
@@ -0,0 +1,34 @@
+#ifndef SPILL_FILE_H
+#define SPILL_FILE_H
+
+#include "output_channel.h"
+
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <string_view>
+
+/* Output of a tool that arrived while the GUI was behind, kept in an anonymous temporary file instead of memory.
+ * Output and error are stored as records in one file, so reading them back keeps the order they arrived in.
+ * The file is created on the first write and reused once everything was read back. */
+class Spill_file {
+	public:
+	void write(Output_channel::Stream stream, std::string_view data);
+	//reads the oldest record into stream and data, returns false if there are no records
+	bool read(Output_channel::Stream &stream, std::string &data);
+	bool is_empty() const;
+	std::size_t get_size() const; //bytes written but not read yet, including record headers
+
+	private:
+	struct File_closer {
+		void operator()(std::FILE *file) const {
+			std::fclose(file);
+		}
+	};
+
+	std::unique_ptr<std::FILE, File_closer> file;
+	long read_position{};
+	long write_position{};
+};
+
+#endif // SPILL_FILE_H
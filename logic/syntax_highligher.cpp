@@ -1,101 +1,257 @@
 #include "syntax_highligher.h"
+#include "utility/thread_call.h"
 
-#include <QFile>
-#include <QJsonArray>
-#include <QJsonDocument>
-#include <QJsonObject>
-#include <QJsonValue>
+#include <QPointer>
 #include <QString>
-#include <cassert>
-#include <map>
+#include <QTextBlock>
+#include <QTextBlockUserData>
+#include <QTextDocument>
+#include <QTimer>
+#include <algorithm>
+#include <optional>
+#include <string_view>
+#include <utility>
+
+struct Block_data : QTextBlockUserData {
+	std::optional<Background_tokenizer::Line_tokens> background_tokens;
+	bool is_applied{false}; //background_tokens were used by highlightBlock
+	std::vector<Semantic_token_parser::Run> semantic_runs;
+	std::uint64_t semantic_text_hash{}; //of the text semantic_runs are for
+};
+
+static Block_data &get_block_data(QTextBlock &block) {
+	if (block.userData() == nullptr) {
+		block.setUserData(new Block_data);
+	}
+	return *static_cast<Block_data *>(block.userData());
+}
+
+static std::u16string_view get_text_view(const QString &text) {
+	static_assert(sizeof(QChar) == sizeof(char16_t));
+	return {reinterpret_cast<const char16_t *>(text.utf16()), static_cast<std::size_t>(text.size())};
+}
 
 Syntax_highligher::Syntax_highligher(QTextDocument *parent)
-	: QSyntaxHighlighter{parent} {}
+	: QSyntaxHighlighter{parent}
+	, background_tokenizer{{}, [highlighter = QPointer<Syntax_highligher>{this}](std::size_t job, std::vector<Background_tokenizer::Line_tokens> batch,
+																				  bool is_finished) {
+		//the tokenizer is stopped before the highlighter is destroyed, but events may still be delivered after that
+		Utility::thread_call(highlighter.data(), [highlighter, job, batch = std::move(batch), is_finished]() mutable {
+			if (highlighter) {
+				highlighter->apply_background_tokens(job, std::move(batch), is_finished);
+			}
+		});
+	}} {}
+
+void Syntax_highligher::load_rules(QString filename) {
+	set_rules(Syntax_rules::get(filename));
+}
+
+void Syntax_highligher::set_rules(std::shared_ptr<const Syntax_rules> syntax_rules) {
+	rules = std::move(syntax_rules);
+	token_rules = rules->token_rules;
+	formats = rules->get_formats(theme ? *theme : rules->theme);
+	background_tokenizer.set_rules(token_rules);
+	is_tokenizing_in_background = false;
+}
+
+void Syntax_highligher::set_theme(const Syntax_rules::Theme &new_theme) {
+	theme = new_theme;
+	formats = rules->get_formats(new_theme);
+	is_rehighlighting = true;
+	rehighlight();
+	is_rehighlighting = false;
+}
 
-struct Json_object_key_value_iterator {
-	QJsonObject::const_iterator iterator;
-	Json_object_key_value_iterator &operator++() {
-		++iterator;
-		return *this;
+//QSyntaxHighlighter only calls this for the edited blocks and the blocks after them whose previous block state changed
+void Syntax_highligher::highlightBlock(const QString &qtext) {
+	const auto text = get_text_view(qtext);
+	if (is_rehighlighting == false) { //the text of the block was edited
+		text_revision = document()->revision();
 	}
-	auto operator*() {
-		return std::make_pair(iterator.key(), iterator.value());
+	const auto previous_state = previousBlockState();
+	const auto block_data = static_cast<Block_data *>(currentBlockUserData());
+	const auto text_hash = block_data ? Background_tokenizer::get_text_hash(text) : 0;
+	auto state = pending_state;
+	if (const auto background_tokens = block_data && block_data->background_tokens ? &*block_data->background_tokens : nullptr;
+		background_tokens && (background_tokens->start_state == previous_state || previous_state == pending_state) &&
+		background_tokens->text_hash == text_hash) {
+		for (const auto &token : background_tokens->tokens) {
+			set_token_format(token.begin, token.length, rules->rule_tokens[token.rule]);
+		}
+		block_data->is_applied = true;
+		//tokenized ahead of the blocks before it, stays pending until it gets their state
+		state = previous_state == pending_state ? pending_state : background_tokens->end_state;
+	} else if (previous_state != pending_state && synchronous_budget > 0) {
+		use_synchronous_budget();
+		if (block_data) {
+			block_data->background_tokens.reset();
+		}
+		state = token_rules.find_tokens(text, previous_state, [this](const Highlighting_rules::Token &token) {
+			set_token_format(token.begin, token.length, rules->rule_tokens[token.rule]);
+		});
 	}
-	bool operator==(const Json_object_key_value_iterator &other) {
-		return iterator == other.iterator;
+	setCurrentBlockState(state);
+	if (const auto block = currentBlock().blockNumber();
+		state == pending_state && (is_tokenizing_in_background == false || block < background_first_block || block >= background_end_block)) {
+		request_background_tokens(block);
 	}
-	bool operator!=(const Json_object_key_value_iterator &other) {
-		return iterator != other.iterator;
+	if (block_data == nullptr || block_data->semantic_runs.empty()) {
+		return;
 	}
-};
+	if (block_data->semantic_text_hash != text_hash) { //edited, the columns of the runs don't fit anymore
+		block_data->semantic_runs.clear();
+		return;
+	}
+	std::size_t column = 0;
+	for (const auto &run : block_data->semantic_runs) {
+		column += run.gap;
+		if (column >= text.size()) {
+			break;
+		}
+		if (run.type < rules->semantic_tokens.size()) {
+			set_token_format(column, std::min<std::size_t>(run.length, text.size() - column), rules->semantic_tokens[run.type]);
+		}
+		column += run.length;
+	}
+}
+
+void Syntax_highligher::set_viewport(int first_block, int block_count) {
+	viewport_first_block = first_block;
+	background_tokenizer.set_viewport(static_cast<std::size_t>(first_block), static_cast<std::size_t>(block_count));
+}
+
+bool Syntax_highligher::has_pending_blocks() const {
+	return is_tokenizing_in_background || first_pending_block != -1;
+}
 
-struct QJsonObject_reference_with_proper_iterators {
-	const QJsonObject &object;
-	Json_object_key_value_iterator begin() {
-		return {object.begin()};
+bool Syntax_highligher::apply_semantic_tokens(std::uint64_t version, std::size_t first_line,
+											  std::vector<std::vector<Semantic_token_parser::Run>> lines) {
+	if (version < static_cast<std::uint64_t>(text_revision)) {
+		return false;
 	}
-	Json_object_key_value_iterator end() {
-		return {object.end()};
+	if (first_line >= static_cast<std::size_t>(document()->blockCount())) {
+		return true;
 	}
-};
+	const auto is_same_run = [](const Semantic_token_parser::Run &lhs, const Semantic_token_parser::Run &rhs) {
+		return lhs.gap == rhs.gap && lhs.length == rhs.length && lhs.type == rhs.type;
+	};
+	auto block = document()->findBlockByNumber(static_cast<int>(first_line));
+	for (auto line = std::begin(lines); line != std::end(lines) && block.isValid(); ++line, block = block.next()) {
+		const auto old_data = static_cast<Block_data *>(block.userData());
+		if (old_data ? std::equal(std::begin(old_data->semantic_runs), std::end(old_data->semantic_runs), std::begin(*line), std::end(*line), is_same_run)
+					 : line->empty()) {
+			continue;
+		}
+		auto &block_data = get_block_data(block);
+		block_data.semantic_runs = std::move(*line);
+		block_data.semantic_text_hash = Background_tokenizer::get_text_hash(get_text_view(block.text()));
+		rehighlight_block(block);
+	}
+	return true;
+}
 
-void Syntax_highligher::load_rules(QString filename) {
-#define assume(X)                                                                                                                                              \
-	if ((X) == false) {                                                                                                                                        \
-		throw std::runtime_error("Failed loading syntax rules");                                                                                               \
-	}
-	QFile rules_file{filename};
-	if (rules_file.open(QIODevice::ReadOnly) == false) {
-		throw std::runtime_error("Failed opening syntax rules file");
-	}
-	auto rules = QJsonDocument::fromJson(rules_file.readAll());
-	assume(rules.isNull() == false);
-	assume(rules.isObject());
-	auto object = rules.object();
-	auto color_list = object["colors"];
-	assume(color_list.isObject());
-
-	std::map<QString, QColor> color_map;
-	for (const auto &name_color : QJsonObject_reference_with_proper_iterators{color_list.toObject()}) {
-		const auto &color_value = name_color.second;
-		assume(color_value.isArray());
-		const auto &color_array = color_value.toArray();
-		assume(color_array.size() == 3);
-		QColor color;
-		decltype(&QColor::setRed) color_setters[] = {&QColor::setRed, &QColor::setGreen, &QColor::setBlue};
-		for (int i = 0; i < 3; i++) {
-			const auto &color_value = color_array[i];
-			assume(color_value.isDouble());
-			int color_int = color_value.toInt();
-			assume(color_int >= 0 && color_int <= 255);
-			(color.*color_setters[i])(color_int);
+void Syntax_highligher::use_synchronous_budget() {
+	if (synchronous_budget-- == max_synchronous_blocks) {
+		QTimer::singleShot(0, this, [this] { synchronous_budget = max_synchronous_blocks; });
+	}
+}
+
+void Syntax_highligher::request_background_tokens(int block) {
+	if (first_pending_block == -1 || block < first_pending_block) {
+		first_pending_block = block;
+	}
+	end_pending_block = std::max(end_pending_block, block + 1);
+	//a running job starts the next one when it is finished
+	if (is_tokenizing_in_background == false && is_start_scheduled == false) {
+		is_start_scheduled = true;
+		QTimer::singleShot(0, this, [this] {
+			is_start_scheduled = false;
+			start_background_tokens();
+		});
+	}
+}
+
+void Syntax_highligher::start_background_tokens() {
+	const auto end = std::min(end_pending_block, document()->blockCount());
+	auto first = first_pending_block;
+	if (first == -1 || first >= end) {
+		first_pending_block = end_pending_block = -1;
+		return;
+	}
+	//a viewport after the first slice gets a job of its own, its blocks stay pending until the slices before it are done
+	if (viewport_first_block >= first + max_background_blocks && viewport_first_block < end) {
+		const auto viewport_block = document()->findBlockByNumber(viewport_first_block);
+		const auto block_data = static_cast<Block_data *>(viewport_block.userData());
+		if (viewport_block.userState() == pending_state && (block_data == nullptr || block_data->background_tokens.has_value() == false ||
+															 block_data->background_tokens->text_hash !=
+																 Background_tokenizer::get_text_hash(get_text_view(viewport_block.text())))) {
+			first = viewport_first_block;
+		}
+	}
+	const auto slice_end = std::min(end, first + max_background_blocks);
+	if (first == first_pending_block) {
+		if (slice_end == end) {
+			first_pending_block = end_pending_block = -1;
+		} else {
+			first_pending_block = slice_end;
 		}
-		color_map[name_color.first] = color;
-	}
-
-	token_colors.clear();
-	auto tokens = object["tokens"];
-	assume(tokens.isArray());
-	for (const auto &token : tokens.toArray()) {
-		assume(token.isArray());
-		const auto &token_array = token.toArray();
-		assume(token_array[0].isString());
-		const auto &regex = token_array[0].toString();
-		token_colors.push_back({std::regex{regex.toStdString()}, QColor{Qt::black}});
-		auto &token_color = token_colors.back();
-		for (int i = 1; i < token_array.size(); i++) {
-			assume(token_array[i].isString());
-			const auto &color_name = token_array[i].toString();
-			if (color_map.count(color_name)) {
-				token_color.color = color_map[color_name];
-				break;
+	}
+	auto block = document()->findBlockByNumber(first);
+	const auto previous_state = block.previous().userState();
+	background_first_block = first;
+	background_end_block = slice_end;
+	std::vector<std::u16string> lines;
+	lines.reserve(static_cast<std::size_t>(slice_end - first));
+	for (auto block_number = first; block_number < slice_end && block.isValid(); block_number++, block = block.next()) {
+		lines.emplace_back(get_text_view(block.text()));
+	}
+	background_job = background_tokenizer.start(std::move(lines), static_cast<std::size_t>(background_first_block),
+												previous_state == pending_state ? Highlighting_rules::no_region : previous_state);
+	is_tokenizing_in_background = true;
+}
+
+void Syntax_highligher::apply_background_tokens(std::size_t job, std::vector<Background_tokenizer::Line_tokens> batch, bool is_finished) {
+	std::vector<QTextBlock> blocks;
+	for (auto &tokens : batch) {
+		auto block = document()->findBlockByNumber(static_cast<int>(tokens.line));
+		if (block.isValid() == false) {
+			continue;
+		}
+		//the block was edited or lines were inserted or removed before it
+		if (tokens.text_hash != Background_tokenizer::get_text_hash(get_text_view(block.text()))) {
+			if (block.userState() == pending_state) {
+				request_background_tokens(block.blockNumber());
 			}
+			continue;
+		}
+		auto &block_data = get_block_data(block);
+		block_data.background_tokens = std::move(tokens);
+		block_data.is_applied = false;
+		blocks.push_back(block);
+	}
+	//highlighting a block also highlights the blocks after it whose previous state changes, most batches take one call
+	for (const auto &block : blocks) {
+		if (static_cast<Block_data *>(block.userData())->is_applied == false) {
+			rehighlight_block(block);
+		}
+	}
+	if (is_finished && job == background_job && is_tokenizing_in_background) {
+		is_tokenizing_in_background = false;
+		if (first_pending_block != -1) {
+			start_background_tokens();
 		}
 	}
-#undef assume
 }
 
-void Syntax_highligher::highlightBlock(const QString &qtext) {
-	(void)qtext;
-	return;
+void Syntax_highligher::set_token_format(std::size_t begin, std::size_t length, std::uint16_t token) {
+	if (token != Syntax_rules::plain_token) {
+		setFormat(static_cast<int>(begin), static_cast<int>(length), formats[token]);
+	}
+}
+
+void Syntax_highligher::rehighlight_block(const QTextBlock &block) {
+	is_rehighlighting = true;
+	rehighlightBlock(block);
+	is_rehighlighting = false;
 }
@@ -1,22 +1,65 @@
 #ifndef SYNTAX_HIGHLIGHER_H
 #define SYNTAX_HIGHLIGHER_H
 
-#include <QColor>
+#include "background_tokenizer.h"
+#include "highlighting_rules.h"
+#include "semantic_token_parser.h"
+#include "syntax_rules.h"
+
 #include <QSyntaxHighlighter>
-#include <regex>
+#include <QTextCharFormat>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <vector>
 
+/* Blocks are tokenized right away while their previous block state is known, up to max_synchronous_blocks per turn of the event loop. The
+ * remaining blocks get pending_state and are tokenized by a Background_tokenizer in slices of max_background_blocks, the viewport first. Its results are kept in the user data of
+ * the blocks and applied in batches, so a big file can be edited right away and its highlighting fills in progressively.
+ * Semantic tokens of an external tool are kept as runs in the user data of their blocks as well and drawn over the tokens of the rules. A block
+ * drops its runs when its text changes, the tool sends new ones for the next document version. */
 class Syntax_highligher : public QSyntaxHighlighter {
 	public:
+	constexpr static int pending_state = -2;
+	constexpr static int max_synchronous_blocks = 1000;
+	constexpr static int max_background_blocks = 20'000; //copied for one Background_tokenizer job, a bigger range takes several jobs
+
 	Syntax_highligher(QTextDocument *parent);
-	void load_rules(QString filename);
+	void load_rules(QString filename); //shares the rules with other highlighters using the same file
+	void set_rules(std::shared_ptr<const Syntax_rules> syntax_rules);
+	void set_theme(const Syntax_rules::Theme &theme); //instead of the colors of the syntax file, rehighlights the document
 	void highlightBlock(const QString &text) override;
+	void set_viewport(int first_block, int block_count); //blocks to tokenize first
+	bool has_pending_blocks() const;
+	//replaces the semantic tokens of lines, only rehighlights the lines whose tokens changed. Returns false and drops the tokens if the text
+	//was edited after revision version of the document.
+	bool apply_semantic_tokens(std::uint64_t version, std::size_t first_line, std::vector<std::vector<Semantic_token_parser::Run>> lines);
 
 	private:
-	struct Token_color {
-		std::regex regex;
-		QColor color;
-	};
-	std::vector<Token_color> token_colors;
+	void use_synchronous_budget();
+	void request_background_tokens(int block);
+	void start_background_tokens();
+	void apply_background_tokens(std::size_t job, std::vector<Background_tokenizer::Line_tokens> batch, bool is_finished);
+	void set_token_format(std::size_t begin, std::size_t length, std::uint16_t token);
+	void rehighlight_block(const QTextBlock &block);
+
+	std::shared_ptr<const Syntax_rules> rules = std::make_shared<const Syntax_rules>();
+	Highlighting_rules token_rules; //copy of rules->token_rules, its DFA is built as the document is tokenized
+	std::optional<Syntax_rules::Theme> theme;
+	std::vector<QTextCharFormat> formats; //by token id, for theme or the colors of the syntax file
+	Background_tokenizer background_tokenizer;
+	std::size_t background_job{};
+	bool is_tokenizing_in_background{false};
+	int background_first_block{}; //of the running job
+	int background_end_block{};   //of the running job, one past its last block
+	int first_pending_block{-1};  //lowest block that needs another job, -1 if none
+	int end_pending_block{-1};    //one past the highest block that needs another job, -1 if none
+	int viewport_first_block{};
+	bool is_start_scheduled{false};
+	int synchronous_budget{max_synchronous_blocks};
+	int text_revision{}; //of the document at the last edit of its text, rehighlighting increments the revision as well
+	bool is_rehighlighting{false}; //highlightBlock is called by rehighlight_block or set_theme, not for an edit
 };
 
-#endif // SYNTAX_HIGHLIGHER_H
\ No newline at end of file
+#endif // SYNTAX_HIGHLIGHER_H
@@ -0,0 +1,266 @@
+#include "syntax_rules.h"
+#include "utility/binary_io.h"
+
+#include <QDir>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QJsonValue>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <map>
+#include <stdexcept>
+#include <string_view>
+
+constexpr std::string_view cache_magic = "SCE syntax rules";
+constexpr std::uint32_t cache_version = 3; //increase when the format of the cache or of the compiled rules changes
+
+//only the GUI thread loads rules
+static std::map<std::uint64_t, std::weak_ptr<const Syntax_rules>> loaded_rules; //by the hash of the file
+
+static std::uint64_t get_hash(const QByteArray &data) {
+	std::uint64_t hash = 0xcbf29ce484222325;
+	for (const auto c : data) {
+		hash = (hash ^ static_cast<unsigned char>(c)) * 0x100000001b3;
+	}
+	return hash;
+}
+
+std::shared_ptr<const Syntax_rules> Syntax_rules::get(const QString &filename, const QString &cache_directory) {
+	QFile file{filename};
+	if (file.open(QIODevice::ReadOnly) == false) {
+		throw std::runtime_error("Failed opening syntax rules file");
+	}
+	const auto json = file.readAll();
+	const auto hash = get_hash(json);
+	if (auto rules = loaded_rules[hash].lock()) {
+		return rules;
+	}
+	const auto cache_filename = QDir{cache_directory}.filePath(QString::number(hash, 16) + ".rules");
+	std::shared_ptr<Syntax_rules> rules;
+	if (QFile cache_file{cache_filename}; cache_file.open(QIODevice::ReadOnly)) {
+		const auto data = cache_file.readAll();
+		try {
+			rules = std::make_shared<Syntax_rules>(load({data.data(), static_cast<std::size_t>(data.size())}, hash));
+			rules->is_from_cache = true;
+		} catch (const std::runtime_error &) {
+			//written by another version or damaged, replaced below
+		}
+	}
+	if (rules == nullptr) {
+		rules = std::make_shared<Syntax_rules>(parse(json));
+		const auto data = rules->save(hash);
+		QSaveFile cache_file{cache_filename};
+		if (QDir{}.mkpath(cache_directory) && cache_file.open(QIODevice::WriteOnly)) {
+			cache_file.write(data.data(), static_cast<qint64>(data.size()));
+			cache_file.commit();
+		}
+	}
+	loaded_rules[hash] = rules;
+	return rules;
+}
+
+QString Syntax_rules::get_default_cache_directory() {
+	return QDir{QStandardPaths::writableLocation(QStandardPaths::CacheLocation)}.filePath("syntax");
+}
+
+struct Json_object_key_value_iterator {
+	QJsonObject::const_iterator iterator;
+	Json_object_key_value_iterator &operator++() {
+		++iterator;
+		return *this;
+	}
+	auto operator*() {
+		return std::make_pair(iterator.key(), iterator.value());
+	}
+	bool operator==(const Json_object_key_value_iterator &other) {
+		return iterator == other.iterator;
+	}
+	bool operator!=(const Json_object_key_value_iterator &other) {
+		return iterator != other.iterator;
+	}
+};
+
+struct QJsonObject_reference_with_proper_iterators {
+	const QJsonObject &object;
+	Json_object_key_value_iterator begin() {
+		return {object.begin()};
+	}
+	Json_object_key_value_iterator end() {
+		return {object.end()};
+	}
+};
+
+Syntax_rules Syntax_rules::parse(const QByteArray &json) {
+#define assume(X)                                                                                                                                              \
+	if ((X) == false) {                                                                                                                                        \
+		throw std::runtime_error("Failed loading syntax rules");                                                                                               \
+	}
+	auto rules = QJsonDocument::fromJson(json);
+	assume(rules.isNull() == false);
+	assume(rules.isObject());
+	auto object = rules.object();
+	auto color_list = object["colors"];
+	assume(color_list.isObject());
+
+	Syntax_rules syntax_rules;
+	for (const auto &name_color : QJsonObject_reference_with_proper_iterators{color_list.toObject()}) {
+		const auto &color_value = name_color.second;
+		assume(color_value.isArray());
+		const auto &color_array = color_value.toArray();
+		assume(color_array.size() == 3);
+		QColor color;
+		decltype(&QColor::setRed) color_setters[] = {&QColor::setRed, &QColor::setGreen, &QColor::setBlue};
+		for (int i = 0; i < 3; i++) {
+			const auto &color_value = color_array[i];
+			assume(color_value.isDouble());
+			int color_int = color_value.toInt();
+			assume(color_int >= 0 && color_int <= 255);
+			(color.*color_setters[i])(color_int);
+		}
+		syntax_rules.theme[name_color.first] = color;
+	}
+
+	//the first name that has a color wins, the names of tokens come first so they can have their own color
+	std::map<QString, std::uint16_t> token_ids{{QString{}, plain_token}};
+	syntax_rules.token_names.emplace_back();
+	const auto get_token = [&syntax_rules, &token_ids](const QJsonArray &names, int first) {
+		for (int i = first; i < names.size(); i++) {
+			assume(names[i].isString());
+			const auto &color_name = names[i].toString();
+			if (syntax_rules.theme.count(color_name)) {
+				const auto token = token_ids.emplace(color_name, static_cast<std::uint16_t>(syntax_rules.token_names.size()));
+				if (token.second) {
+					syntax_rules.token_names.push_back(color_name);
+				}
+				return token.first->second;
+			}
+		}
+		return plain_token;
+	};
+
+	auto &token_rules = syntax_rules.token_rules;
+	auto &rule_tokens = syntax_rules.rule_tokens;
+	auto tokens = object["tokens"];
+	assume(tokens.isArray());
+	for (const auto &token : tokens.toArray()) {
+		assume(token.isArray());
+		const auto &token_array = token.toArray();
+		assume(token_array[0].isString());
+		const auto &regex = token_array[0].toString();
+		try {
+			token_rules.add_rule(regex.toStdString());
+		} catch (const std::runtime_error &error) {
+			throw std::runtime_error("Failed loading syntax rule " + regex.toStdString() + ": " + error.what());
+		}
+		rule_tokens.push_back(get_token(token_array, 1));
+	}
+
+	//{"name": ..., "begin": regex, "end": regex, "nested begin": regex, "nested end": regex, "colors": [...]}, nesting is optional
+	const auto regions = object.value("regions");
+	assume(regions.isUndefined() || regions.isArray());
+	for (const auto &region : regions.toArray()) {
+		assume(region.isObject());
+		const auto &region_object = region.toObject();
+		const auto get_string = [&region_object](const QString &key) {
+			const auto &value = region_object[key];
+			assume(value.isUndefined() || value.isString());
+			return value.toString().toStdString();
+		};
+		const auto begin = get_string("begin");
+		assume(begin.empty() == false && get_string("end").empty() == false && region_object["name"].isString());
+		try {
+			token_rules.add_region(begin, get_string("end"), get_string("nested begin"), get_string("nested end"));
+		} catch (const std::runtime_error &error) {
+			throw std::runtime_error("Failed loading syntax region " + begin + ": " + error.what());
+		}
+		auto names = region_object["colors"].toArray();
+		names.prepend(region_object["name"]);
+		rule_tokens.push_back(get_token(names, 0));
+	}
+
+	//["name", color names...] per type, the index is the type the tool prints
+	const auto semantic_tokens = object.value("semantic tokens");
+	assume(semantic_tokens.isUndefined() || semantic_tokens.isArray());
+	for (const auto &semantic_token : semantic_tokens.toArray()) {
+		assume(semantic_token.isArray());
+		syntax_rules.semantic_tokens.push_back(get_token(semantic_token.toArray(), 0));
+	}
+#undef assume
+	return syntax_rules;
+}
+
+std::vector<QTextCharFormat> Syntax_rules::get_formats(const Theme &theme) const {
+	std::vector<QTextCharFormat> formats(token_names.size());
+	for (std::size_t token = 0; token < token_names.size(); token++) {
+		if (const auto color = theme.find(token_names[token]); token != plain_token && color != std::end(theme)) {
+			formats[token].setForeground(color->second);
+		}
+	}
+	return formats;
+}
+
+std::string Syntax_rules::save(std::uint64_t hash) const {
+	Utility::Binary_writer writer;
+	writer.write_string(cache_magic);
+	writer.write(cache_version);
+	writer.write(hash);
+	token_rules.save(writer);
+	writer.write<std::uint64_t>(token_names.size());
+	for (const auto &name : token_names) {
+		writer.write_string(name.toStdString());
+	}
+	for (const auto tokens : {&rule_tokens, &semantic_tokens}) {
+		writer.write<std::uint64_t>(tokens->size());
+		for (const auto token : *tokens) {
+			writer.write(token);
+		}
+	}
+	writer.write<std::uint64_t>(theme.size());
+	for (const auto &[name, color] : theme) {
+		writer.write_string(name.toStdString());
+		writer.write<std::uint8_t>(static_cast<std::uint8_t>(color.red()));
+		writer.write<std::uint8_t>(static_cast<std::uint8_t>(color.green()));
+		writer.write<std::uint8_t>(static_cast<std::uint8_t>(color.blue()));
+	}
+	return writer.get_data();
+}
+
+Syntax_rules Syntax_rules::load(std::string_view data, std::uint64_t hash) {
+	Utility::Binary_reader reader{data};
+	if (reader.read_string() != cache_magic) {
+		throw std::runtime_error{"Not a syntax rules cache"};
+	}
+	if (reader.read<std::uint32_t>() != cache_version || reader.read<std::uint64_t>() != hash) {
+		throw std::runtime_error{"Syntax rules cache of another version or file"};
+	}
+	Syntax_rules rules;
+	rules.token_rules = Highlighting_rules::load(reader);
+	const auto name_count = reader.read<std::uint64_t>();
+	for (std::uint64_t i = 0; i < name_count; i++) {
+		rules.token_names.push_back(QString::fromStdString(reader.read_string()));
+	}
+	for (const auto tokens : {&rules.rule_tokens, &rules.semantic_tokens}) {
+		const auto token_count = reader.read<std::uint64_t>();
+		for (std::uint64_t i = 0; i < token_count; i++) {
+			const auto token = reader.read<std::uint16_t>();
+			if (token >= rules.token_names.size()) {
+				throw std::runtime_error{"Invalid syntax rules cache"};
+			}
+			tokens->push_back(token);
+		}
+	}
+	const auto color_count = reader.read<std::uint64_t>();
+	for (std::uint64_t i = 0; i < color_count; i++) {
+		auto name = QString::fromStdString(reader.read_string());
+		const auto red = reader.read<std::uint8_t>();
+		const auto green = reader.read<std::uint8_t>();
+		const auto blue = reader.read<std::uint8_t>();
+		rules.theme[std::move(name)] = QColor{red, green, blue};
+	}
+	if (rules.token_names.empty() || rules.rule_tokens.size() != rules.token_rules.get_rule_count() || reader.is_at_end() == false) {
+		throw std::runtime_error{"Invalid syntax rules cache"};
+	}
+	return rules;
+}
@@ -0,0 +1,45 @@
+#ifndef SYNTAX_RULES_H
+#define SYNTAX_RULES_H
+
+#include "highlighting_rules.h"
+
+#include <QByteArray>
+#include <QColor>
+#include <QString>
+#include <QTextCharFormat>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/* The compiled token rules and colors of a syntax file. Each file is loaded once while any document uses it and shared by all of them. The compiled
+ * rules are also kept in a binary cache named after a hash of the file, so the JSON and the patterns are only parsed again when the file changes.
+ * Highlighting_rules build their DFA while tokenizing, so tokenize with a copy of token_rules, the copies share their region states.
+ * Every rule resolves to the token id of the color name it uses when it is loaded. get_formats turns a theme into one format per token id, so
+ * highlighting with it or switching to another theme doesn't look up any names. */
+class Syntax_rules {
+	public:
+	//throws std::runtime_error if the file can't be read or has errors, a cache that can't be read or written is skipped
+	static std::shared_ptr<const Syntax_rules> get(const QString &filename, const QString &cache_directory = get_default_cache_directory());
+	static QString get_default_cache_directory();
+	static Syntax_rules parse(const QByteArray &json); //throws std::runtime_error
+
+	using Theme = std::map<QString, QColor>;        //colors by name, such as "keyword"
+	constexpr static std::uint16_t plain_token = 0; //of rules without a color, their text keeps its format
+	std::vector<QTextCharFormat> get_formats(const Theme &theme) const; //by token id, names without a color in theme get no format
+
+	Highlighting_rules token_rules;             //the rule id is the index into rule_tokens
+	std::vector<QString> token_names;           //the token id is the index, plain_token has no name
+	std::vector<std::uint16_t> rule_tokens;     //token id by rule id
+	std::vector<std::uint16_t> semantic_tokens; //token id by the type of the runs of a semantic highlighting tool
+	Theme theme;                                //the colors of the syntax file
+	bool is_from_cache{false};
+
+	private:
+	std::string save(std::uint64_t hash) const;
+	static Syntax_rules load(std::string_view data, std::uint64_t hash); //throws std::runtime_error if data isn't the cache for hash
+};
+
+#endif // SYNTAX_RULES_H
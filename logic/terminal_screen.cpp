@@ -0,0 +1,533 @@
+#include "terminal_screen.h"
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <string>
+
+namespace {
+	//numbers of a control sequence such as "?1049" or "5;10", which are 0 if missing
+	struct Parameters {
+		std::array<int, 16> values{};
+		int count{};
+		char marker{}; //private sequences start with one of <=>?
+		bool has_intermediates{};
+
+		int get(int index, int default_value) const {
+			return index < count && values[index] != 0 ? values[index] : default_value;
+		}
+	};
+
+	Parameters parse_parameters(std::string_view text) {
+		Parameters parameters;
+		if (text.empty() == false && text.front() >= '<' && text.front() <= '?') {
+			parameters.marker = text.front();
+			text.remove_prefix(1);
+		}
+		if (text.empty()) {
+			return parameters;
+		}
+		parameters.count = 1;
+		for (const auto c : text) {
+			if (c >= '0' && c <= '9') {
+				auto &value = parameters.values[parameters.count - 1];
+				value = std::min(value * 10 + (c - '0'), 0xffff);
+			} else if (c == ';' || c == ':') {
+				parameters.count = std::min<int>(parameters.count + 1, parameters.values.size());
+			} else if (c >= 0x20 && c <= 0x2F) {
+				parameters.has_intermediates = true;
+			}
+		}
+		return parameters;
+	}
+
+	//the parser only passes on whole characters, invalid ones become U+FFFD
+	template <class Function>
+	void decode_utf8(std::string_view text, Function &&function) {
+		for (std::size_t position = 0; position < text.size();) {
+			const auto lead = static_cast<unsigned char>(text[position]);
+			const std::size_t size = lead < 0x80 ? 1 : lead >= 0xF0 ? 4 : lead >= 0xE0 ? 3 : lead >= 0xC0 ? 2 : 0;
+			if (size == 0 || position + size > text.size()) {
+				function(U'\uFFFD');
+				position++;
+				continue;
+			}
+			char32_t character = size == 1 ? lead : lead & (0x7F >> size);
+			bool valid = true;
+			for (std::size_t i = 1; i < size; i++) {
+				const auto continuation = static_cast<unsigned char>(text[position + i]);
+				valid = valid && (continuation & 0xC0) == 0x80;
+				character = character << 6 | (continuation & 0x3F);
+			}
+			function(valid ? character : U'\uFFFD');
+			position += valid ? size : 1;
+		}
+	}
+} // namespace
+
+struct Terminal_screen::Handler : Ansi_parser::Default_handler {
+	void on_text(std::string_view text) {
+		decode_utf8(text, [this](char32_t character) {
+			if (character < 0x20 || character == 0x7F) {
+				screen.control_character(static_cast<char>(character));
+			} else {
+				screen.print(character);
+			}
+		});
+	}
+	void on_control_sequence(std::string_view parameters, char final_byte) {
+		screen.control_sequence(parameters, final_byte);
+	}
+	void on_escape_sequence(std::string_view intermediates, char final_byte) {
+		screen.escape_sequence(intermediates, final_byte);
+	}
+	Terminal_screen &screen;
+};
+
+Terminal_screen::Terminal_screen(int rows, int columns)
+	: rows{std::max(rows, 1)}
+	, columns{std::max(columns, 1)}
+	, cells(this->rows * this->columns)
+	, inactive_cells(this->rows * this->columns)
+	, damage_by_row(this->rows)
+	, scroll_bottom{this->rows - 1} {
+	damage_all();
+}
+
+void Terminal_screen::feed(std::string_view output) {
+	parser.feed(output, Handler{{}, *this});
+}
+
+void Terminal_screen::resize(int new_rows, int new_columns) {
+	new_rows = std::max(new_rows, 1);
+	new_columns = std::max(new_columns, 1);
+	if (new_rows == rows && new_columns == columns) {
+		return;
+	}
+	for (auto screen : {&cells, &inactive_cells}) {
+		std::vector<Cell> resized(new_rows * new_columns);
+		//keep the bottom of the screen where the cursor usually is
+		const auto row_offset = std::max(0, rows - new_rows);
+		for (int row = 0; row < std::min(rows, new_rows); row++) {
+			const auto source = std::begin(*screen) + (row + row_offset) * columns;
+			std::copy(source, source + std::min(columns, new_columns), std::begin(resized) + row * new_columns);
+		}
+		*screen = std::move(resized);
+	}
+	const auto row_offset = std::max(0, rows - new_rows);
+	rows = new_rows;
+	columns = new_columns;
+	for (auto saved : {&cursor, &saved_cursor}) {
+		saved->row = std::clamp(saved->row - row_offset, 0, rows - 1);
+		saved->column = std::clamp(saved->column, 0, columns - 1);
+	}
+	scroll_top = 0;
+	scroll_bottom = rows - 1;
+	pending_wrap = false;
+	damage_by_row.resize(rows);
+	damage_all();
+}
+
+int Terminal_screen::get_rows() const {
+	return rows;
+}
+
+int Terminal_screen::get_columns() const {
+	return columns;
+}
+
+const Terminal_screen::Cell &Terminal_screen::get_cell(int row, int column) const {
+	assert(row >= 0 && row < rows && column >= 0 && column < columns);
+	return cells[row * columns + column];
+}
+
+int Terminal_screen::get_cursor_row() const {
+	return cursor.row;
+}
+
+int Terminal_screen::get_cursor_column() const {
+	return cursor.column;
+}
+
+bool Terminal_screen::is_cursor_visible() const {
+	return cursor_visible;
+}
+
+bool Terminal_screen::is_alternate_screen() const {
+	return alternate_screen;
+}
+
+bool Terminal_screen::is_application_cursor_keys() const {
+	return application_cursor_keys;
+}
+
+const std::vector<Terminal_screen::Damage> &Terminal_screen::get_damage() const {
+	return damage_by_row;
+}
+
+void Terminal_screen::clear_damage() {
+	std::fill(std::begin(damage_by_row), std::end(damage_by_row), Damage{});
+}
+
+std::string Terminal_screen::take_responses() {
+	return std::move(responses);
+}
+
+void Terminal_screen::print(char32_t character) {
+	if (pending_wrap) {
+		pending_wrap = false;
+		cursor.column = 0;
+		line_feed();
+	}
+	cell(cursor.row, cursor.column) = {character, cursor.attributes};
+	damage(cursor.row, cursor.column, cursor.column + 1);
+	if (cursor.column == columns - 1) {
+		pending_wrap = auto_wrap;
+	} else {
+		cursor.column++;
+		damage(cursor.row, cursor.column, cursor.column + 1); //where the cursor is drawn now
+	}
+}
+
+void Terminal_screen::control_character(char c) {
+	switch (c) {
+		case '\r':
+			move_cursor(cursor.row, 0);
+			break;
+		case '\n':
+		case '\v':
+		case '\f':
+			pending_wrap = false;
+			line_feed();
+			break;
+		case '\b':
+			move_cursor(cursor.row, cursor.column - 1);
+			break;
+		case '\t':
+			move_cursor(cursor.row, std::min(columns - 1, (cursor.column / 8 + 1) * 8));
+			break;
+		default: //bell and friends
+			break;
+	}
+}
+
+void Terminal_screen::control_sequence(std::string_view text, char final_byte) {
+	//source: http://invisible-island.net/xterm/ctlseqs/ctlseqs.html
+	const auto parameters = parse_parameters(text);
+	if (parameters.has_intermediates) { //such as the cursor style, which we don't support
+		return;
+	}
+	if (parameters.marker == '?') {
+		if (final_byte == 'h' || final_byte == 'l') {
+			for (int index = 0; index < std::max(parameters.count, 1); index++) {
+				private_mode(parameters.values[index], final_byte == 'h');
+			}
+		}
+		return;
+	}
+	if (parameters.marker == '>') {
+		if (final_byte == 'c') { //secondary device attributes
+			responses += "\033[>0;10;1c";
+		}
+		return;
+	}
+	if (parameters.marker != 0) {
+		return;
+	}
+	const auto count = parameters.get(0, 1);
+	switch (final_byte) {
+		case '@': { //insert blank characters
+			auto row = std::begin(cells) + cursor.row * columns;
+			const auto inserted = std::min(count, columns - cursor.column);
+			std::copy_backward(row + cursor.column, row + columns - inserted, row + columns);
+			std::fill(row + cursor.column, row + cursor.column + inserted, get_blank_cell());
+			damage(cursor.row, cursor.column, columns);
+			pending_wrap = false;
+		} break;
+		case 'A': //cursor up
+			move_cursor(std::max(cursor.row - count, cursor.row >= scroll_top ? scroll_top : 0), cursor.column);
+			break;
+		case 'B': //cursor down
+			move_cursor(std::min(cursor.row + count, cursor.row <= scroll_bottom ? scroll_bottom : rows - 1), cursor.column);
+			break;
+		case 'C': //cursor forward
+			move_cursor(cursor.row, cursor.column + count);
+			break;
+		case 'D': //cursor backward
+			move_cursor(cursor.row, cursor.column - count);
+			break;
+		case 'E': //cursor next line
+			move_cursor(cursor.row + count, 0);
+			break;
+		case 'F': //cursor previous line
+			move_cursor(cursor.row - count, 0);
+			break;
+		case 'G': //cursor horizontal absolute
+		case '`':
+			move_cursor(cursor.row, count - 1);
+			break;
+		case 'H': //cursor position
+		case 'f':
+			move_cursor(parameters.get(0, 1) - 1, parameters.get(1, 1) - 1);
+			break;
+		case 'J': //erase in display
+			switch (parameters.get(0, 0)) {
+				case 0:
+					erase(cursor.row, cursor.column, columns);
+					for (int row = cursor.row + 1; row < rows; row++) {
+						erase(row, 0, columns);
+					}
+					break;
+				case 1:
+					for (int row = 0; row < cursor.row; row++) {
+						erase(row, 0, columns);
+					}
+					erase(cursor.row, 0, cursor.column + 1);
+					break;
+				case 2:
+				case 3: //also clears the scrollback, which we don't have
+					for (int row = 0; row < rows; row++) {
+						erase(row, 0, columns);
+					}
+					break;
+			}
+			break;
+		case 'K': //erase in line
+			switch (parameters.get(0, 0)) {
+				case 0:
+					erase(cursor.row, cursor.column, columns);
+					break;
+				case 1:
+					erase(cursor.row, 0, cursor.column + 1);
+					break;
+				case 2:
+					erase(cursor.row, 0, columns);
+					break;
+			}
+			break;
+		case 'L': //insert lines
+			if (cursor.row >= scroll_top && cursor.row <= scroll_bottom) {
+				scroll_down(cursor.row, scroll_bottom, count);
+				move_cursor(cursor.row, 0);
+			}
+			break;
+		case 'M': //delete lines
+			if (cursor.row >= scroll_top && cursor.row <= scroll_bottom) {
+				scroll_up(cursor.row, scroll_bottom, count);
+				move_cursor(cursor.row, 0);
+			}
+			break;
+		case 'P': { //delete characters
+			auto row = std::begin(cells) + cursor.row * columns;
+			const auto deleted = std::min(count, columns - cursor.column);
+			std::copy(row + cursor.column + deleted, row + columns, row + cursor.column);
+			std::fill(row + columns - deleted, row + columns, get_blank_cell());
+			damage(cursor.row, cursor.column, columns);
+			pending_wrap = false;
+		} break;
+		case 'S': //scroll up
+			scroll_up(scroll_top, scroll_bottom, count);
+			break;
+		case 'T': //scroll down
+			scroll_down(scroll_top, scroll_bottom, count);
+			break;
+		case 'X': //erase characters
+			erase(cursor.row, cursor.column, std::min(columns, cursor.column + count));
+			break;
+		case 'c': //device attributes, we claim to be a VT100 with advanced video option
+			responses += "\033[?1;2c";
+			break;
+		case 'd': //line position absolute
+			move_cursor(count - 1, cursor.column);
+			break;
+		case 'm':
+			cursor.attributes.apply(text);
+			break;
+		case 'n': //device status report
+			if (parameters.get(0, 0) == 5) {
+				responses += "\033[0n";
+			} else if (parameters.get(0, 0) == 6) {
+				responses += "\033[" + std::to_string(cursor.row + 1) + ';' + std::to_string(cursor.column + 1) + 'R';
+			}
+			break;
+		case 'r': { //set scroll region
+			const auto top = parameters.get(0, 1) - 1;
+			const auto bottom = std::min(parameters.get(1, rows), rows) - 1;
+			if (top < bottom) {
+				scroll_top = top;
+				scroll_bottom = bottom;
+				move_cursor(0, 0);
+			}
+		} break;
+		case 's':
+			saved_cursor = cursor;
+			break;
+		case 'u':
+			cursor = saved_cursor;
+			move_cursor(cursor.row, cursor.column);
+			break;
+	}
+}
+
+void Terminal_screen::private_mode(int mode, bool set) {
+	switch (mode) {
+		case 1:
+			application_cursor_keys = set;
+			break;
+		case 7:
+			auto_wrap = set;
+			pending_wrap = pending_wrap && set;
+			break;
+		case 25:
+			cursor_visible = set;
+			damage(cursor.row, cursor.column, cursor.column + 1);
+			break;
+		case 47:
+		case 1047:
+			switch_screen(set);
+			break;
+		case 1049: //also saves and restores the cursor and starts with a clear screen
+			if (set) {
+				saved_cursor = cursor;
+				switch_screen(true);
+				for (int row = 0; row < rows; row++) {
+					erase(row, 0, columns);
+				}
+			} else {
+				switch_screen(false);
+				cursor = saved_cursor;
+				move_cursor(cursor.row, cursor.column);
+			}
+			break;
+	}
+}
+
+void Terminal_screen::escape_sequence(std::string_view intermediates, char final_byte) {
+	if (intermediates.empty() == false) { //character sets, we only do UTF-8
+		return;
+	}
+	switch (final_byte) {
+		case '7':
+			saved_cursor = cursor;
+			break;
+		case '8':
+			cursor = saved_cursor;
+			move_cursor(cursor.row, cursor.column);
+			break;
+		case 'D': //index
+			line_feed();
+			break;
+		case 'E': //next line
+			move_cursor(cursor.row, 0);
+			line_feed();
+			break;
+		case 'M': //reverse index
+			reverse_line_feed();
+			break;
+		case 'c':
+			reset();
+			break;
+	}
+}
+
+void Terminal_screen::line_feed() {
+	if (cursor.row == scroll_bottom) {
+		scroll_up(scroll_top, scroll_bottom, 1);
+	} else if (cursor.row < rows - 1) {
+		move_cursor(cursor.row + 1, cursor.column);
+	}
+}
+
+void Terminal_screen::reverse_line_feed() {
+	if (cursor.row == scroll_top) {
+		scroll_down(scroll_top, scroll_bottom, 1);
+	} else if (cursor.row > 0) {
+		move_cursor(cursor.row - 1, cursor.column);
+	}
+}
+
+void Terminal_screen::scroll_up(int top, int bottom, int count) {
+	count = std::min(count, bottom - top + 1);
+	const auto begin = std::begin(cells);
+	std::copy(begin + (top + count) * columns, begin + (bottom + 1) * columns, begin + top * columns);
+	std::fill(begin + (bottom + 1 - count) * columns, begin + (bottom + 1) * columns, get_blank_cell());
+	for (int row = top; row <= bottom; row++) {
+		damage(row, 0, columns);
+	}
+}
+
+void Terminal_screen::scroll_down(int top, int bottom, int count) {
+	count = std::min(count, bottom - top + 1);
+	const auto begin = std::begin(cells);
+	std::copy_backward(begin + top * columns, begin + (bottom + 1 - count) * columns, begin + (bottom + 1) * columns);
+	std::fill(begin + top * columns, begin + (top + count) * columns, get_blank_cell());
+	for (int row = top; row <= bottom; row++) {
+		damage(row, 0, columns);
+	}
+}
+
+void Terminal_screen::erase(int row, int first_column, int end_column) {
+	const auto begin = std::begin(cells) + row * columns;
+	std::fill(begin + first_column, begin + end_column, get_blank_cell());
+	damage(row, first_column, end_column);
+	pending_wrap = false;
+}
+
+void Terminal_screen::move_cursor(int row, int column) {
+	damage(cursor.row, cursor.column, cursor.column + 1);
+	cursor.row = std::clamp(row, 0, rows - 1);
+	cursor.column = std::clamp(column, 0, columns - 1);
+	damage(cursor.row, cursor.column, cursor.column + 1);
+	pending_wrap = false;
+}
+
+void Terminal_screen::switch_screen(bool alternate) {
+	if (alternate == alternate_screen) {
+		return;
+	}
+	alternate_screen = alternate;
+	cells.swap(inactive_cells);
+	damage_all();
+}
+
+void Terminal_screen::reset() {
+	switch_screen(false);
+	std::fill(std::begin(cells), std::end(cells), Cell{});
+	std::fill(std::begin(inactive_cells), std::end(inactive_cells), Cell{});
+	cursor = saved_cursor = {};
+	scroll_top = 0;
+	scroll_bottom = rows - 1;
+	pending_wrap = false;
+	auto_wrap = true;
+	cursor_visible = true;
+	application_cursor_keys = false;
+	damage_all();
+}
+
+//erased cells keep the background color, like in xterm
+Terminal_screen::Cell Terminal_screen::get_blank_cell() const {
+	Cell blank;
+	blank.attributes.background = cursor.attributes.background;
+	return blank;
+}
+
+Terminal_screen::Cell &Terminal_screen::cell(int row, int column) {
+	return cells[row * columns + column];
+}
+
+void Terminal_screen::damage(int row, int first_column, int end_column) {
+	if (first_column >= end_column) {
+		return;
+	}
+	auto &row_damage = damage_by_row[row];
+	if (row_damage.first_column == row_damage.end_column) {
+		row_damage = {first_column, end_column};
+	} else {
+		row_damage.first_column = std::min(row_damage.first_column, first_column);
+		row_damage.end_column = std::max(row_damage.end_column, end_column);
+	}
+}
+
+void Terminal_screen::damage_all() {
+	std::fill(std::begin(damage_by_row), std::end(damage_by_row), Damage{0, columns});
+}
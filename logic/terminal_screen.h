@@ -0,0 +1,92 @@
+#ifndef TERMINAL_SCREEN_H
+#define TERMINAL_SCREEN_H
+
+#include "ansi_parser.h"
+#include "sgr_attributes.h"
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+/* The screen of a VT100/xterm style terminal for interactive tools such as vim: a grid of cells, a cursor, a scroll region and an alternate screen.
+ * Output of the tool is fed in as it arrives, the parts of the screen it changed are collected as damage so a view only has to repaint those.
+ * Every character takes up one cell, double width characters are not supported. */
+class Terminal_screen {
+	public:
+	struct Cell {
+		char32_t character{U' '};
+		Sgr_attributes attributes;
+		friend bool operator==(const Cell &lhs, const Cell &rhs) {
+			return lhs.character == rhs.character && lhs.attributes == rhs.attributes;
+		}
+	};
+	//the columns of a row that changed, empty if first_column == end_column
+	struct Damage {
+		int first_column;
+		int end_column;
+	};
+
+	Terminal_screen(int rows = 24, int columns = 80);
+
+	void feed(std::string_view output);
+	void resize(int rows, int columns);
+	int get_rows() const;
+	int get_columns() const;
+	const Cell &get_cell(int row, int column) const;
+	int get_cursor_row() const;
+	int get_cursor_column() const;
+	bool is_cursor_visible() const;
+	bool is_alternate_screen() const;
+	bool is_application_cursor_keys() const; //cursor keys send ESC O A instead of ESC [ A
+
+	//one entry per row, changed by feed and resize until clear_damage is called
+	const std::vector<Damage> &get_damage() const;
+	void clear_damage();
+	//answers to queries such as the cursor position report, they have to be written to the tool
+	std::string take_responses();
+
+	private:
+	struct Handler;
+	struct Cursor {
+		int row{};
+		int column{};
+		Sgr_attributes attributes;
+	};
+
+	void print(char32_t character);
+	void control_character(char c);
+	void control_sequence(std::string_view parameters, char final_byte);
+	void private_mode(int mode, bool set);
+	void escape_sequence(std::string_view intermediates, char final_byte);
+	void line_feed();
+	void reverse_line_feed();
+	void scroll_up(int top, int bottom, int count);   //rows top to bottom inclusive move up and blank lines appear at the bottom
+	void scroll_down(int top, int bottom, int count); //rows top to bottom inclusive move down and blank lines appear at the top
+	void erase(int row, int first_column, int end_column);
+	void move_cursor(int row, int column);
+	void switch_screen(bool alternate);
+	void reset();
+	Cell get_blank_cell() const;
+	Cell &cell(int row, int column);
+	void damage(int row, int first_column, int end_column);
+	void damage_all();
+
+	Ansi_parser parser;
+	int rows;
+	int columns;
+	std::vector<Cell> cells;           //of the visible screen, row by row
+	std::vector<Cell> inactive_cells; //of the normal screen while the alternate one is visible and the other way around
+	std::vector<Damage> damage_by_row;
+	Cursor cursor;
+	Cursor saved_cursor;
+	int scroll_top{};
+	int scroll_bottom{};
+	bool pending_wrap{false}; //the cursor is past the last column, the next character goes into the next line
+	bool auto_wrap{true};
+	bool cursor_visible{true};
+	bool alternate_screen{false};
+	bool application_cursor_keys{false};
+	std::string responses;
+};
+
+#endif // TERMINAL_SCREEN_H
@@ -0,0 +1,551 @@
+#include "token_automaton.h"
+#include "utility/binary_io.h"
+
+#include <algorithm>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+
+//recursive descent over a pattern which builds the NFA fragments as it goes (Thompson's construction)
+class Token_automaton::Parser {
+	public:
+	Parser(Token_automaton &automaton, std::string_view pattern)
+		: automaton{automaton}
+		, pattern{pattern} {}
+
+	Fragment parse() {
+		auto fragment = parse_alternatives();
+		if (position != pattern.size()) {
+			fail("unbalanced )");
+		}
+		return fragment;
+	}
+
+	private:
+	[[noreturn]] void fail(const std::string &reason) const {
+		throw std::runtime_error("Unsupported regular expression \"" + std::string{pattern} + "\": " + reason);
+	}
+	bool at_end() const {
+		return position == pattern.size();
+	}
+	char peek() const {
+		return at_end() ? '\0' : pattern[position];
+	}
+	bool skip(char c) {
+		if (peek() != c || at_end()) {
+			return false;
+		}
+		position++;
+		return true;
+	}
+	int add_epsilon(int next = -1, int alternative = -1) {
+		Node node{Node_type::epsilon};
+		node.next = next;
+		node.alternative = alternative;
+		return automaton.add_node(node);
+	}
+	Fragment add_characters(const std::bitset<symbol_count> &characters) {
+		Node node{Node_type::characters};
+		node.characters = characters;
+		const auto node_id = automaton.add_node(node);
+		return {node_id, {{node_id, false}}};
+	}
+	Fragment add_assertion(Assertion assertion) {
+		Node node{Node_type::assertion};
+		node.assertion = assertion;
+		const auto node_id = automaton.add_node(node);
+		return {node_id, {{node_id, false}}};
+	}
+	Fragment add_empty() {
+		const auto node_id = add_epsilon();
+		return {node_id, {{node_id, false}}};
+	}
+	Fragment concatenate(Fragment first, Fragment second) {
+		automaton.patch(first.outs, second.start);
+		return {first.start, std::move(second.outs)};
+	}
+
+	Fragment parse_alternatives() {
+		auto fragment = parse_sequence();
+		while (skip('|')) {
+			auto alternative = parse_sequence();
+			const auto split = add_epsilon(fragment.start, alternative.start);
+			fragment.outs.insert(std::end(fragment.outs), std::begin(alternative.outs), std::end(alternative.outs));
+			fragment.start = split;
+		}
+		return fragment;
+	}
+	Fragment parse_sequence() {
+		auto fragment = add_empty();
+		while (at_end() == false && peek() != '|' && peek() != ')') {
+			fragment = concatenate(std::move(fragment), parse_repetition());
+		}
+		return fragment;
+	}
+	Fragment parse_repetition() {
+		const auto atom_begin = position;
+		auto fragment = parse_atom();
+		int min = 0;
+		int max = -1;
+		if (skip('*')) { //0 to unlimited
+		} else if (skip('+')) {
+			min = 1;
+		} else if (skip('?')) {
+			max = 1;
+		} else if (peek() == '{') {
+			position++;
+			min = max = parse_number();
+			if (skip(',')) {
+				max = peek() == '}' ? -1 : parse_number();
+			}
+			if (!skip('}') || (max != -1 && max < min) || min > 1000 || max > 1000) {
+				fail("invalid {n,m}");
+			}
+		} else {
+			return fragment;
+		}
+		skip('?'); //lazy and greedy quantifiers are the same for the longest match
+		if (peek() == '*' || peek() == '+' || peek() == '?' || peek() == '{') {
+			fail("nothing to repeat");
+		}
+		return repeat(std::move(fragment), atom_begin, min, max);
+	}
+	int parse_number() {
+		if (peek() < '0' || peek() > '9') {
+			fail("expected a number");
+		}
+		int number = 0;
+		while (peek() >= '0' && peek() <= '9' && number < 10000) {
+			number = number * 10 + (pattern[position++] - '0');
+		}
+		return number;
+	}
+	//the atom is parsed again for each copy, a fragment can only be used once
+	Fragment parse_copy(std::size_t atom_begin) {
+		const auto end = position;
+		position = atom_begin;
+		auto fragment = parse_atom();
+		position = end;
+		return fragment;
+	}
+	//fragment is the first copy of the atom at atom_begin, max is -1 for no limit
+	Fragment repeat(Fragment fragment, std::size_t atom_begin, int min, int max) {
+		if (min > 0) { //a required copy followed by the rest
+			if (min == 1 && max == 1) {
+				return fragment;
+			}
+			return concatenate(std::move(fragment), repeat(parse_copy(atom_begin), atom_begin, min - 1, max == -1 ? -1 : max - 1));
+		}
+		if (max == 0) {
+			return add_empty();
+		}
+		const auto split = add_epsilon(fragment.start);
+		if (max == -1) { //a loop around the atom
+			automaton.patch(fragment.outs, split);
+			return {split, {{split, true}}};
+		}
+		//an optional copy, which may be followed by up to max - 1 more
+		if (max > 1) {
+			auto rest = repeat(parse_copy(atom_begin), atom_begin, 0, max - 1);
+			automaton.patch(fragment.outs, rest.start);
+			fragment.outs = std::move(rest.outs);
+		}
+		fragment.outs.push_back({split, true});
+		return {split, std::move(fragment.outs)};
+	}
+
+	Fragment parse_atom() {
+		if (at_end()) {
+			fail("expected an atom");
+		}
+		const char c = pattern[position++];
+		switch (c) {
+			case '(': {
+				if (skip('?')) {
+					if (!skip(':')) {
+						fail("lookaheads are not supported");
+					}
+				}
+				auto fragment = parse_alternatives();
+				if (!skip(')')) {
+					fail("missing )");
+				}
+				return fragment;
+			}
+			case '[':
+				return add_characters(parse_class());
+			case '.':
+				return add_characters(std::bitset<symbol_count>{}.set());
+			case '^':
+				return add_assertion(Assertion::line_start);
+			case '$':
+				return add_assertion(Assertion::line_end);
+			case '\\':
+				return parse_escape();
+			case '*':
+			case '+':
+			case '?':
+			case '{':
+			case ')':
+			case '|':
+				fail(std::string{"unexpected "} + c);
+		}
+		return add_characters(get_character(c));
+	}
+	Fragment parse_escape() {
+		if (at_end()) {
+			fail("\\ at the end");
+		}
+		const char c = pattern[position++];
+		if (c == 'b') {
+			return add_assertion(Assertion::word_boundary);
+		}
+		if (c == 'B') {
+			return add_assertion(Assertion::not_word_boundary);
+		}
+		if (c >= '1' && c <= '9') {
+			fail("backreferences are not supported");
+		}
+		return add_characters(get_escaped_characters(c));
+	}
+	std::bitset<symbol_count> parse_class() {
+		std::bitset<symbol_count> characters;
+		const bool negated = skip('^');
+		for (bool first = true; first || peek() != ']'; first = false) {
+			if (at_end()) {
+				fail("missing ]");
+			}
+			std::bitset<symbol_count> item;
+			char c = pattern[position++];
+			if (c == '\\') {
+				if (at_end()) {
+					fail("\\ at the end");
+				}
+				c = pattern[position++];
+				item = get_escaped_characters(c);
+				if (item.count() != 1 || c == 'd' || c == 'w' || c == 's') { //classes can't be part of a range
+					characters |= item;
+					continue;
+				}
+				c = get_escaped_literal(c);
+			} else {
+				item = get_character(c);
+			}
+			if (peek() == '-' && position + 1 < pattern.size() && pattern[position + 1] != ']') {
+				position++;
+				char last = pattern[position++];
+				if (last == '\\') {
+					if (at_end()) {
+						fail("\\ at the end");
+					}
+					last = get_escaped_literal(pattern[position++]);
+				}
+				const auto first_symbol = get_symbol(static_cast<unsigned char>(c));
+				const auto last_symbol = get_symbol(static_cast<unsigned char>(last));
+				if (last_symbol < first_symbol) {
+					fail("invalid range");
+				}
+				for (auto symbol = first_symbol; symbol <= last_symbol; symbol++) {
+					characters.set(symbol);
+				}
+				continue;
+			}
+			characters |= item;
+		}
+		position++; //]
+		return negated ? ~characters : characters;
+	}
+	static std::bitset<symbol_count> get_character(char c) {
+		std::bitset<symbol_count> characters;
+		characters.set(get_symbol(static_cast<unsigned char>(c)));
+		return characters;
+	}
+	static char get_escaped_literal(char c) {
+		switch (c) {
+			case 'n':
+				return '\n';
+			case 't':
+				return '\t';
+			case 'r':
+				return '\r';
+			case 'f':
+				return '\f';
+			case 'v':
+				return '\v';
+			case '0':
+				return '\0';
+		}
+		return c;
+	}
+	std::bitset<symbol_count> get_escaped_characters(char c) const {
+		std::bitset<symbol_count> characters;
+		const auto add_range = [&characters](char first, char last) {
+			for (auto symbol = first; symbol <= last; symbol++) {
+				characters.set(static_cast<std::size_t>(symbol));
+			}
+		};
+		switch (c) {
+			case 'd':
+			case 'D':
+				add_range('0', '9');
+				break;
+			case 'w':
+			case 'W':
+				add_range('0', '9');
+				add_range('a', 'z');
+				add_range('A', 'Z');
+				characters.set('_');
+				break;
+			case 's':
+			case 'S':
+				for (const char space : {' ', '\t', '\n', '\r', '\f', '\v'}) {
+					characters.set(static_cast<std::size_t>(space));
+				}
+				break;
+			default:
+				if ((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z')) {
+					if (get_escaped_literal(c) == c) {
+						fail(std::string{"unsupported escape \\"} + c);
+					}
+				}
+				return get_character(get_escaped_literal(c));
+		}
+		return c >= 'A' && c <= 'Z' ? ~characters : characters;
+	}
+
+	Token_automaton &automaton;
+	std::string_view pattern;
+	std::size_t position{};
+};
+
+std::size_t Token_automaton::add_rule(std::string_view pattern) {
+	const auto node_count = nodes.size();
+	try {
+		const auto fragment = Parser{*this, pattern}.parse();
+		Node accept{Node_type::accept};
+		accept.rule = static_cast<int>(rule_starts.size());
+		patch(fragment.outs, add_node(accept));
+		rule_starts.push_back(fragment.start);
+	} catch (...) {
+		nodes.resize(node_count);
+		throw;
+	}
+	//the DFA built so far doesn't know the new rule
+	states.clear();
+	transitions.clear();
+	state_ids.clear();
+	start_states.fill(unknown_state);
+	return rule_starts.size() - 1;
+}
+
+Token_automaton::Token Token_automaton::match(std::u16string_view text, std::size_t position) {
+	Token token{position, 0, 0};
+	if (rule_starts.empty()) {
+		return token;
+	}
+	auto state = get_start_state(position == 0 ? edge : get_context(get_symbol(text[position - 1])));
+	for (auto end = position;; end++) {
+		const auto symbol = end < text.size() ? get_symbol(text[end]) : -1;
+		const auto rule = states[state].accepted_rules[symbol == -1 ? edge : get_context(symbol)];
+		if (rule != no_rule && end > position) {
+			token.length = end - position;
+			token.rule = static_cast<std::size_t>(rule);
+		}
+		if (symbol == -1) {
+			return token;
+		}
+		const auto next_state = transitions[static_cast<std::size_t>(state) * symbol_count + symbol];
+		state = next_state == unknown_state ? compute_transition(state, symbol) : next_state;
+		if (states[state].nodes.empty()) { //dead, no rule can match anymore
+			return token;
+		}
+	}
+}
+
+std::size_t Token_automaton::get_rule_count() const {
+	return rule_starts.size();
+}
+
+std::size_t Token_automaton::get_state_count() const {
+	return states.size();
+}
+
+bool Token_automaton::can_start_inside_words() {
+	const auto start_state = get_start_state(word);
+	for (int symbol = 0; symbol < symbol_count; symbol++) {
+		if (get_context(symbol) == word && states[compute_transition(start_state, symbol)].nodes.empty() == false) {
+			return true;
+		}
+	}
+	return false;
+}
+
+void Token_automaton::save(Utility::Binary_writer &writer) const {
+	writer.write<std::uint64_t>(nodes.size());
+	for (const auto &node : nodes) {
+		writer.write(node.type);
+		writer.write(node.assertion);
+		writer.write<std::int32_t>(node.next);
+		writer.write<std::int32_t>(node.alternative);
+		writer.write<std::int32_t>(node.rule);
+		for (int word = 0; word * 64 < symbol_count; word++) {
+			std::uint64_t bits = 0;
+			for (int bit = 0; bit < 64 && word * 64 + bit < symbol_count; bit++) {
+				bits |= std::uint64_t{node.characters[word * 64 + bit]} << bit;
+			}
+			writer.write(bits);
+		}
+	}
+	writer.write<std::uint64_t>(rule_starts.size());
+	for (const auto start : rule_starts) {
+		writer.write<std::int32_t>(start);
+	}
+}
+
+Token_automaton Token_automaton::load(Utility::Binary_reader &reader) {
+	Token_automaton automaton;
+	const auto node_count = reader.read<std::uint64_t>();
+	const auto is_node = [node_count](std::int32_t node) { return node >= -1 && node < static_cast<std::int64_t>(node_count); };
+	for (std::uint64_t i = 0; i < node_count; i++) {
+		Node node{reader.read<Node_type>()};
+		node.assertion = reader.read<Assertion>();
+		node.next = reader.read<std::int32_t>();
+		node.alternative = reader.read<std::int32_t>();
+		node.rule = reader.read<std::int32_t>();
+		if (node.type > Node_type::accept || node.assertion > Assertion::line_end || is_node(node.next) == false || is_node(node.alternative) == false) {
+			throw std::runtime_error{"Invalid node in saved automaton"};
+		}
+		for (int word = 0; word * 64 < symbol_count; word++) {
+			const auto bits = reader.read<std::uint64_t>();
+			for (int bit = 0; bit < 64 && word * 64 + bit < symbol_count; bit++) {
+				node.characters[word * 64 + bit] = bits >> bit & 1;
+			}
+		}
+		automaton.nodes.push_back(node);
+	}
+	const auto rule_count = reader.read<std::uint64_t>();
+	for (std::uint64_t i = 0; i < rule_count; i++) {
+		const auto start = reader.read<std::int32_t>();
+		if (start < 0 || is_node(start) == false) {
+			throw std::runtime_error{"Invalid rule in saved automaton"};
+		}
+		automaton.rule_starts.push_back(start);
+	}
+	for (const auto &node : automaton.nodes) {
+		if (node.type == Node_type::accept && (node.rule < 0 || static_cast<std::uint64_t>(node.rule) >= rule_count)) {
+			throw std::runtime_error{"Invalid rule in saved automaton"};
+		}
+	}
+	return automaton;
+}
+
+int Token_automaton::get_symbol(char16_t c) {
+	return c < 128 ? c : 128;
+}
+
+Token_automaton::Context Token_automaton::get_context(int symbol) {
+	const bool is_word = (symbol >= '0' && symbol <= '9') || (symbol >= 'a' && symbol <= 'z') || (symbol >= 'A' && symbol <= 'Z') || symbol == '_';
+	return is_word ? word : other;
+}
+
+int Token_automaton::add_node(Node node) {
+	nodes.push_back(node);
+	return static_cast<int>(nodes.size() - 1);
+}
+
+void Token_automaton::patch(const std::vector<std::pair<int, bool>> &outs, int target) {
+	for (const auto &[node, is_alternative] : outs) {
+		(is_alternative ? nodes[node].alternative : nodes[node].next) = target;
+	}
+}
+
+//all nodes reachable from nodes without consuming a character, given what is before and after the current position
+std::vector<int> Token_automaton::get_closure(const std::vector<int> &start_nodes, Context previous, Context next) const {
+	std::vector<bool> visited(nodes.size());
+	std::vector<int> stack = start_nodes;
+	std::vector<int> closure;
+	while (stack.empty() == false) {
+		const auto node_id = stack.back();
+		stack.pop_back();
+		if (node_id == -1 || visited[node_id]) {
+			continue;
+		}
+		visited[node_id] = true;
+		closure.push_back(node_id);
+		const auto &node = nodes[node_id];
+		switch (node.type) {
+			case Node_type::characters:
+			case Node_type::accept:
+				break;
+			case Node_type::epsilon:
+				stack.push_back(node.alternative);
+				stack.push_back(node.next);
+				break;
+			case Node_type::assertion: {
+				bool holds = false;
+				switch (node.assertion) {
+					case Assertion::word_boundary:
+						holds = (previous == word) != (next == word);
+						break;
+					case Assertion::not_word_boundary:
+						holds = (previous == word) == (next == word);
+						break;
+					case Assertion::line_start:
+						holds = previous == edge;
+						break;
+					case Assertion::line_end:
+						holds = next == edge;
+						break;
+				}
+				if (holds) {
+					stack.push_back(node.next);
+				}
+			} break;
+		}
+	}
+	return closure;
+}
+
+int Token_automaton::get_state(std::vector<int> state_nodes, Context previous) {
+	std::sort(std::begin(state_nodes), std::end(state_nodes));
+	state_nodes.erase(std::unique(std::begin(state_nodes), std::end(state_nodes)), std::end(state_nodes));
+	auto key = std::make_pair(previous, std::move(state_nodes));
+	if (const auto state = state_ids.find(key); state != std::end(state_ids)) {
+		return state->second;
+	}
+	State state{key.second, previous, {}};
+	for (int next = 0; next < context_count; next++) {
+		int accepted_rule = no_rule;
+		for (const auto node : get_closure(state.nodes, previous, static_cast<Context>(next))) {
+			if (nodes[node].type == Node_type::accept && (accepted_rule == no_rule || nodes[node].rule < accepted_rule)) {
+				accepted_rule = nodes[node].rule;
+			}
+		}
+		state.accepted_rules[next] = accepted_rule;
+	}
+	const auto id = static_cast<int>(states.size());
+	states.push_back(std::move(state));
+	transitions.resize(transitions.size() + symbol_count, unknown_state);
+	state_ids.emplace(std::move(key), id);
+	return id;
+}
+
+int Token_automaton::get_start_state(Context previous) {
+	if (start_states[previous] == unknown_state) {
+		start_states[previous] = get_state(rule_starts, previous);
+	}
+	return start_states[previous];
+}
+
+int Token_automaton::compute_transition(int state, int symbol) {
+	const auto next = get_context(symbol);
+	std::vector<int> next_nodes;
+	for (const auto node : get_closure(states[state].nodes, states[state].previous, next)) {
+		if (nodes[node].type == Node_type::characters && nodes[node].characters[symbol]) {
+			next_nodes.push_back(nodes[node].next);
+		}
+	}
+	const auto next_state = get_state(std::move(next_nodes), next);
+	transitions[static_cast<std::size_t>(state) * symbol_count + symbol] = next_state;
+	return next_state;
+}
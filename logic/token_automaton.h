@@ -0,0 +1,107 @@
+#ifndef TOKEN_AUTOMATON_H
+#define TOKEN_AUTOMATON_H
+
+#include <array>
+#include <bitset>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace Utility {
+	class Binary_reader;
+	class Binary_writer;
+} // namespace Utility
+
+/* Finds the tokens of many regular expressions at once. All rules are compiled into one NFA, the DFA for it is built lazily while text is scanned,
+ * so every character is looked at by one table lookup no matter how many rules there are.
+ * Tokens are found like a lexer does: at each position the longest match of any rule wins, if several rules match the same length the one added
+ * first wins. Text after a token is scanned from the end of the token, positions without a match are skipped.
+ * The supported syntax is the part of ECMAScript regular expressions a DFA can do: alternatives, groups, character classes, the quantifiers
+ * * + ? {n,m}, the escapes \d \w \s \b \B and their negations, and the anchors ^ $. All non-ASCII characters fall into one class which is no
+ * word character, like for std::regex. */
+class Token_automaton {
+	public:
+	struct Token {
+		std::size_t begin;
+		std::size_t length;
+		std::size_t rule;
+	};
+
+	//returns the id of the rule, throws std::runtime_error for syntax that isn't supported, such as backreferences and lookaheads
+	std::size_t add_rule(std::string_view pattern);
+	std::size_t get_rule_count() const;
+	std::size_t get_state_count() const; //of the DFA built so far
+	bool can_start_inside_words(); //false if no token can start at a word character that follows another one
+	//the rules without the DFA, load throws std::runtime_error for data that save didn't write
+	void save(Utility::Binary_writer &writer) const;
+	static Token_automaton load(Utility::Binary_reader &reader);
+
+	template <class Callback> //void(const Token &)
+	void find_tokens(std::u16string_view text, Callback &&callback);
+	//the longest token starting at position, its length is 0 if no rule matches there
+	Token match(std::u16string_view text, std::size_t position);
+
+	private:
+	constexpr static int symbol_count = 129; //one per ASCII character and one for everything else
+	constexpr static int unknown_state = -1;
+	constexpr static int no_rule = -1;
+	//what is before or after a position, which is all assertions care about
+	enum Context : std::uint8_t { edge, word, other, context_count };
+	enum class Node_type : std::uint8_t { characters, epsilon, assertion, accept };
+	enum class Assertion : std::uint8_t { word_boundary, not_word_boundary, line_start, line_end };
+	struct Node {
+		Node_type type;
+		Assertion assertion{};
+		int next{-1};
+		int alternative{-1}; //second epsilon edge for alternatives and loops
+		int rule{};
+		std::bitset<symbol_count> characters{};
+	};
+	struct Fragment {
+		int start;
+		std::vector<std::pair<int, bool>> outs; //edges to patch, true for the alternative edge
+	};
+	struct State {
+		std::vector<int> nodes; //reached by characters, before following epsilon edges
+		Context previous;
+		std::array<int, context_count> accepted_rules; //by what follows
+	};
+	class Parser;
+
+	static int get_symbol(char16_t c);
+	static Context get_context(int symbol);
+	int add_node(Node node);
+	void patch(const std::vector<std::pair<int, bool>> &outs, int target);
+	std::vector<int> get_closure(const std::vector<int> &nodes, Context previous, Context next) const;
+	int get_state(std::vector<int> nodes, Context previous);
+	int get_start_state(Context previous);
+	int compute_transition(int state, int symbol);
+
+	std::vector<Node> nodes;
+	std::vector<int> rule_starts;
+	std::vector<State> states;
+	std::vector<int> transitions; //symbol_count entries per state
+	std::map<std::pair<Context, std::vector<int>>, int> state_ids;
+	std::array<int, context_count> start_states{unknown_state, unknown_state, unknown_state};
+};
+
+template <class Callback>
+void Token_automaton::find_tokens(std::u16string_view text, Callback &&callback) {
+	if (rule_starts.empty()) {
+		return;
+	}
+	for (std::size_t position = 0; position < text.size();) {
+		const auto token = match(text, position);
+		if (token.length == 0) {
+			position++;
+			continue;
+		}
+		callback(token);
+		position += token.length;
+	}
+}
+
+#endif // TOKEN_AUTOMATON_H
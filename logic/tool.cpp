@@ -63,6 +63,9 @@ Tool Tool::from_string(const QString &data) {
 #define X(Y) read(tool.Y, #Y, json);
 	TOOL_MEMBERS
 #undef X
+	if (tool.error >= Tool_output_target::error_target_count) { //saved before these targets were left out for errors
+		tool.error = Tool_output_target::ignore;
+	}
 	return tool;
 }
 
@@ -70,6 +73,10 @@ QString Tool::get_name() const {
 	return path.split('/').last();
 }
 
+bool Tool::keeps_input_open() const {
+	return output == Tool_output_target::semantic_highlighting && activation == Tool_activation::on_file_edit;
+}
+
 //creates an std::tuple but ignores the first argument
 template <class Ignored, class... Args>
 static constexpr auto first_skipped_make_tuple(Ignored, Args &&... args) {
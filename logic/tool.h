@@ -7,14 +7,21 @@
 #include <array>
 #include <chrono>
 #include <tuple>
+#include <vector>
 
 class QJsonObject;
 
 namespace Tool_output_target { //what to do with the output of a tool
-	enum Type { ignore, paste, console, popup, replace_document };
+	enum Type { ignore, paste, console, popup, replace_document, terminal, semantic_highlighting };
 	inline auto get_texts() {
 		return std::array{QObject::tr("Ignored"), QObject::tr("Paste into editor"), QObject::tr("Display in console"), QObject::tr("Display in popup window"),
-						  QObject::tr("Replace document")};
+						  QObject::tr("Replace document"), QObject::tr("Run interactively in terminal window"), QObject::tr("Semantic highlighting")};
+	}
+	//terminal and the targets after it only take the normal output, the error output of a tool in a terminal goes there as well
+	constexpr int error_target_count = terminal;
+	inline auto get_error_texts() {
+		const auto texts = get_texts();
+		return std::vector(std::begin(texts), std::begin(texts) + error_target_count);
 	}
 } // namespace Tool_output_target
 
@@ -40,6 +47,8 @@ struct Tool { //how to use an external tool such as a compiler. It specifies inp
 	QString to_string() const;
 	static Tool from_string(const QString &data);
 	QString get_name() const;
+	//semantic highlighting on edit keeps one run per document and writes the edits to its standard input, see Tool_scheduler
+	bool keeps_input_open() const;
 };
 
 bool operator==(const Tool &lhs, const Tool &rhs);
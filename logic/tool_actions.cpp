@@ -1,16 +1,40 @@
 #include "tool_actions.h"
 #include "process_reader.h"
+#include "semantic_token_parser.h"
 #include "settings.h"
+#include "ui/console_widget.h"
 #include "ui/edit_window.h"
 #include "ui/mainwindow.h"
+#include "ui/terminal_widget.h"
+#include "utility/thread_call.h"
 
 #include <QAction>
 #include <QPlainTextEdit>
+#include <QPointer>
+#include <algorithm>
 #include <cassert>
+#include <cstdint>
+#include <functional>
 #include <memory>
+#include <utility>
 
 static std::vector<std::unique_ptr<QAction>> actions;
 static std::vector<QWidget *> widgets;
+static std::vector<std::unique_ptr<Process_reader>> running_tools;
+static Output_search output_search;
+static int output_edit_depth; //of Output_edits
+
+//marks the edits of a document that insert the output of a tool
+struct Output_edit {
+	Output_edit() {
+		output_edit_depth++;
+	}
+	~Output_edit() {
+		output_edit_depth--;
+	}
+	Output_edit(const Output_edit &) = delete;
+	Output_edit &operator=(const Output_edit &) = delete;
+};
 
 void Tool_actions::add_widget(QWidget *widget) {
 	widgets.insert(std::lower_bound(std::begin(widgets), std::end(widgets), widget), widget);
@@ -28,52 +52,231 @@ void Tool_actions::remove_widget(QWidget *widget) {
 	widgets.erase(pos);
 }
 
-static void show_output(std::string_view output, Tool_output_target::Type output_target, const QString &title, bool is_error) {
-	if (output.empty()) {
-		return;
-	}
+//returns a function that shows the output of a tool in output_target as it arrives, finish_handlers get what needs to run once the output is complete
+static std::function<void(std::string_view)> create_output_handler(Tool_output_target::Type output_target, const QString &title, bool is_error,
+																   const QString &working_directory, Edit_window *edit_window,
+																   std::vector<std::function<void()>> &finish_handlers) {
 	switch (output_target) {
 		case Tool_output_target::ignore:
 			break;
-		case Tool_output_target::popup: {
-			auto edit = new QPlainTextEdit(MainWindow::get_main_window());
-			/* Note: in theory the mainwindow owns the edit window and cleans up resources when it is closed.
-			 * In practice if you close the mainwindow before the edit window this actually works.
-			 * If you close the edit window first, however, LeakSanitizer reports 64 bytes leaked in 2 objects.
-			 * I don't want to and probably can't fix Qt, so I'll just accept it as the price one has to pay for Qt.
-			 */
-			edit->setWindowFlag(Qt::WindowType::Window);
-			edit->setWindowTitle((is_error ? "Error: " : "Output: ") + title);
-			edit->setReadOnly(true);
-			edit->setLineWrapMode(QPlainTextEdit::LineWrapMode::NoWrap);
-			edit->setFont(Settings::get<Settings::Key::font>("console"));
-			Ansi_code_handling::set_text(edit, output);
-			auto cursor = edit->textCursor();
-			cursor.movePosition(QTextCursor::Start);
-			edit->setTextCursor(cursor);
-			edit->resize(MainWindow::get_current_edit_window()->size()); //TODO: make the edit window exactly as big as it needs to be
-			edit->show();
-			break;
-		} break;
-		case Tool_output_target::paste:
-			MainWindow::get_current_edit_window()->insertPlainText(Ansi_code_handling::strip_control_sequences_text(output));
-			break;
-		case Tool_output_target::replace_document:
-			Ansi_code_handling::set_text(MainWindow::get_current_edit_window(), output);
-			break;
-		case Tool_output_target::console:
-			//TODO: add a console and put text in there
+		case Tool_output_target::popup:
+			return [ edit = QPointer<QPlainTextEdit>{}, created = false, title, is_error, text_state = Ansi_code_handling::Text_state{} ](std::string_view output) mutable {
+				if (created == false) {
+					created = true;
+					edit = new QPlainTextEdit(MainWindow::get_main_window());
+					/* Note: in theory the mainwindow owns the edit window and cleans up resources when it is closed.
+					 * In practice if you close the mainwindow before the edit window this actually works.
+					 * If you close the edit window first, however, LeakSanitizer reports 64 bytes leaked in 2 objects.
+					 * I don't want to and probably can't fix Qt, so I'll just accept it as the price one has to pay for Qt.
+					 */
+					edit->setWindowFlag(Qt::WindowType::Window);
+					edit->setWindowTitle((is_error ? "Error: " : "Output: ") + title);
+					edit->setReadOnly(true);
+					edit->setLineWrapMode(QPlainTextEdit::LineWrapMode::NoWrap);
+					edit->setFont(Settings::get<Settings::Key::font>("console"));
+					if (const auto current_edit_window = MainWindow::get_current_edit_window()) {
+						edit->resize(current_edit_window->size()); //TODO: make the edit window exactly as big as it needs to be
+					}
+					edit->show();
+				}
+				if (edit == nullptr) {
+					return;
+				}
+				auto cursor = edit->textCursor();
+				cursor.movePosition(QTextCursor::End);
+				edit->setTextCursor(cursor);
+				Ansi_code_handling::set_text(edit, output, text_state);
+			};
+		case Tool_output_target::paste: {
+			//keep pasting where the cursor was when the tool started, even if the user moves on
+			if (edit_window == nullptr) {
+				break;
+			}
+			return [ edit_window = QPointer<Edit_window>{edit_window}, cursor = edit_window->textCursor(), parser = Ansi_parser{} ](std::string_view output) mutable {
+				if (edit_window == nullptr) {
+					return;
+				}
+				const Output_edit output_edit;
+				cursor.insertText(Ansi_code_handling::strip_control_sequences_text(output, parser));
+			};
+		}
+		case Tool_output_target::replace_document: {
+			if (edit_window == nullptr) {
+				break;
+			}
+			return [ edit_window = QPointer<Edit_window>{edit_window}, replaced = false, text_state = Ansi_code_handling::Text_state{} ](std::string_view output) mutable {
+				if (edit_window == nullptr) {
+					return;
+				}
+				const Output_edit output_edit;
+				QTextCursor cursor{edit_window->document()};
+				if (replaced == false) { //only replace the document once the tool actually produced something
+					replaced = true;
+					cursor.select(QTextCursor::Document);
+					cursor.removeSelectedText();
+				}
+				cursor.movePosition(QTextCursor::End);
+				edit_window->setTextCursor(cursor);
+				Ansi_code_handling::set_text(edit_window, output, text_state);
+			};
+		}
+		case Tool_output_target::console: {
+			struct Console_output {
+				QPointer<Console_widget> console;
+				bool created;
+				Console_buffer::Stream_state stream_state;
+				Diagnostic_parser diagnostic_parser;
+			};
+			const auto console_output =
+				std::make_shared<Console_output>(Console_output{{}, false, {}, Diagnostic_parser{working_directory.toStdString()}});
+			finish_handlers.push_back([console_output] {
+				if (console_output->console) {
+					console_output->console->finish(console_output->diagnostic_parser);
+				}
+			});
+			return [console_output](std::string_view output) {
+				if (console_output->created == false) {
+					console_output->created = true;
+					console_output->console = MainWindow::show_console();
+				}
+				if (console_output->console == nullptr) {
+					return;
+				}
+				console_output->console->append(output, console_output->stream_state, &console_output->diagnostic_parser);
+			};
+		}
+		case Tool_output_target::terminal: //handled by start_in_terminal, the error output of such tools goes into the terminal as well
 			break;
+		case Tool_output_target::semantic_highlighting: {
+			//deltas without a version line are for the revision the tool was started with, the document may have been edited since
+			//tools that keep running get the versions of later edits on their input and must print them, see Tool_scheduler
+			if (edit_window == nullptr) {
+				break;
+			}
+			struct Semantic_tokens {
+				QPointer<Edit_window> edit_window;
+				std::uint64_t version;
+				Semantic_token_parser parser;
+				void apply(Semantic_token_parser::Delta delta) {
+					if (edit_window) {
+						edit_window->apply_semantic_tokens(delta.version.value_or(version), delta.first_line, std::move(delta.lines));
+					}
+				}
+			};
+			const auto semantic_tokens = std::make_shared<Semantic_tokens>(
+				Semantic_tokens{edit_window, static_cast<std::uint64_t>(edit_window->document()->revision()), Semantic_token_parser{}});
+			finish_handlers.push_back([semantic_tokens] {
+				semantic_tokens->parser.finish([&](Semantic_token_parser::Delta delta) { semantic_tokens->apply(std::move(delta)); });
+			});
+			return [semantic_tokens](std::string_view output) {
+				semantic_tokens->parser.feed(output, [&](Semantic_token_parser::Delta delta) { semantic_tokens->apply(std::move(delta)); });
+			};
+		}
 	}
+	return [](std::string_view) {};
+}
+
+static void remove_finished_tools() {
+	running_tools.erase(std::remove_if(std::begin(running_tools), std::end(running_tools),
+									   [](const auto &process_reader) { return process_reader->get_state() != Process_reader::State::running; }),
+						std::end(running_tools));
+}
+
+void Tool_actions::run(const Tool &tool) {
+	running_tools.push_back(start(tool, MainWindow::get_current_edit_window(), [](Process_reader::State) {
+		//we are being called by the Process_reader, so it must not be destroyed right now
+		Utility::gui_call([] { remove_finished_tools(); });
+	}));
+}
+
+//runs the tool in a pseudo terminal shown in a window of its own which passes keystrokes to the tool and kills it when closed
+static std::unique_ptr<Process_reader> start_in_terminal(const Tool &tool, Edit_window *edit_window,
+														 std::function<void(Process_reader::State)> completion_callback) {
+	QPointer<Terminal_widget> terminal = new Terminal_widget;
+	terminal->setAttribute(Qt::WA_DeleteOnClose);
+	terminal->setWindowTitle("Terminal: " + tool.get_name());
+	if (const auto current_edit_window = MainWindow::get_current_edit_window()) {
+		terminal->resize(current_edit_window->size());
+	}
+	//a Process_reader that is destroyed while its tool runs doesn't call the completion callback, but it destroys its callbacks
+	const auto forget_process_reader = std::shared_ptr<void>{nullptr, [terminal](void *) {
+																 if (terminal) {
+																	 terminal->set_process_reader(nullptr);
+																 }
+															 }};
+	auto process_reader = std::make_unique<Process_reader>(tool,
+														   [terminal, forget_process_reader](std::string_view output) {
+															   if (terminal) {
+																   terminal->feed(output);
+															   }
+														   },
+														   [](std::string_view) {},
+														   [ terminal, completion_callback = std::move(completion_callback) ](Process_reader::State state) {
+															   if (terminal) {
+																   terminal->set_process_reader(nullptr);
+															   }
+															   completion_callback(state);
+														   },
+														   edit_window);
+	if (process_reader->get_state() == Process_reader::State::running) {
+		terminal->set_process_reader(process_reader.get());
+	}
+	terminal->show();
+	return process_reader;
+}
+
+std::unique_ptr<Process_reader> Tool_actions::start(const Tool &tool, Edit_window *edit_window, std::function<void(Process_reader::State)> completion_callback) {
+	if (tool.output == Tool_output_target::terminal) {
+		return start_in_terminal(tool, edit_window, std::move(completion_callback));
+	}
+	//the raw output goes into the search as well, before the handlers render it. Each stream gets a run of its own, so chunks of one don't end up
+	//in the lines or escape sequences of the other.
+	const auto output_run = output_search.start_run(tool.get_name().toStdString());
+	const auto error_run = output_search.start_run(QObject::tr("%1 (errors)").arg(tool.get_name()).toStdString());
+	const auto searchable = [](std::size_t run, std::function<void(std::string_view)> output_handler) {
+		return [ run, output_handler = std::move(output_handler) ](std::string_view output) {
+			output_search.append(run, output);
+			output_handler(output);
+		};
+	};
+	std::vector<std::function<void()>> finish_handlers;
+	auto output_handler = create_output_handler(tool.output, tool.get_name(), false, tool.working_directory, edit_window, finish_handlers);
+	auto error_handler = create_output_handler(tool.error, tool.get_name(), true, tool.working_directory, edit_window, finish_handlers);
+	return std::make_unique<Process_reader>(tool, searchable(output_run, std::move(output_handler)), searchable(error_run, std::move(error_handler)),
+											[ output_run, error_run, finish_handlers = std::move(finish_handlers),
+											  completion_callback = std::move(completion_callback) ](Process_reader::State state) {
+												output_search.finish_run(output_run);
+												output_search.finish_run(error_run);
+												for (const auto &finish_handler : finish_handlers) {
+													finish_handler();
+												}
+												completion_callback(state);
+											},
+											edit_window);
+}
+
+void Tool_actions::cancel_running_tools() {
+	for (auto &process_reader : running_tools) {
+		process_reader->kill();
+	}
+}
+
+void Tool_actions::stop_running_tools() {
+	//destroying a Process_reader kills its tool without waiting for it or calling its callbacks
+	running_tools.clear();
+}
+
+std::size_t Tool_actions::get_running_tools_count() {
+	return std::count_if(std::begin(running_tools), std::end(running_tools),
+						 [](const auto &process_reader) { return process_reader->get_state() == Process_reader::State::running; });
+}
+
+bool Tool_actions::is_editing_document() {
+	return output_edit_depth > 0;
 }
 
-static void run_action(const Tool &tool) {
-	std::string output;
-	std::string error;
-	Process_reader p{tool, [&output](std::string_view sv) { output += sv; }, [&error](std::string_view sv) { error += sv; }};
-	p.join();
-	show_output(output, tool.output, tool.get_name(), false);
-	show_output(error, tool.error, tool.get_name(), true);
+const Output_search &Tool_actions::get_output_search() {
+	return output_search;
 }
 
 void Tool_actions::set_actions(const std::vector<Tool> &tools) {
@@ -81,7 +284,7 @@ void Tool_actions::set_actions(const std::vector<Tool> &tools) {
 	std::transform(std::begin(tools), std::end(tools), std::begin(actions), [](const Tool &tool) {
 		auto action = std::make_unique<QAction>();
 		action->setShortcut(tool.activation);
-		QObject::connect(action.get(), &QAction::triggered, [tool] { run_action(tool); });
+		QObject::connect(action.get(), &QAction::triggered, [tool] { run(tool); });
 		for (auto &widget : widgets) {
 			widget->addAction(action.get());
 		}
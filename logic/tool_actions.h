@@ -1,8 +1,15 @@
 #ifndef TOOL_ACTIONS_H
 #define TOOL_ACTIONS_H
 
+#include "output_search.h"
+#include "process_reader.h"
+
+#include <cstddef>
+#include <functional>
+#include <memory>
 #include <vector>
 
+class Edit_window;
 struct Tool;
 class QWidget;
 
@@ -10,6 +17,17 @@ namespace Tool_actions {
 	void add_widget(QWidget *widget);
 	void remove_widget(QWidget *widget);
 	void set_actions(const std::vector<Tool> &tools);
+	//runs the tool in the background, its output is shown while it runs
+	void run(const Tool &tool);
+	//starts the tool for edit_window, placeholders and pasted output refer to it, completion_callback is called after the output was shown
+	std::unique_ptr<Process_reader> start(const Tool &tool, Edit_window *edit_window, std::function<void(Process_reader::State)> completion_callback);
+	void cancel_running_tools();
+	void stop_running_tools(); //kills all running tools without waiting for them, their output and completions are dropped
+	std::size_t get_running_tools_count();
+	//true while the output of a tool is pasted into or replaces a document, such edits must not activate on_file_edit tools again
+	bool is_editing_document();
+	//output of the tools that ran so far, except for the ones in a terminal
+	const Output_search &get_output_search();
 } // namespace Tool_actions
 
 #endif // TOOL_ACTIONS_H
\ No newline at end of file
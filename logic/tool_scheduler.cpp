@@ -0,0 +1,303 @@
+#include "tool_scheduler.h"
+#include "background_tokenizer.h"
+#include "process_reader.h"
+#include "settings.h"
+#include "tool.h"
+#include "tool_actions.h"
+#include "ui/edit_window.h"
+#include "ui/mainwindow.h"
+#include "utility/thread_call.h"
+
+#include <QTextBlock>
+#include <QTextDocument>
+#include <QTimer>
+#include <algorithm>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <utility>
+
+using Clock = std::chrono::steady_clock;
+using Job_key = std::pair<Edit_window *, Tool>; //edit window the tool runs for, nullptr for project wide tools
+
+struct Queued_job {
+	Job_key key;
+	Clock::time_point queued;
+};
+
+struct Running_job {
+	std::unique_ptr<Process_reader> process_reader;
+	Clock::time_point started;
+	bool superseded;
+	//only for tools that keep their input open
+	std::vector<std::uint64_t> line_hashes; //of the document the tool knows
+	std::size_t unchanged_prefix{};         //lines at the start and the end of the document that weren't edited since the tool got line_hashes
+	std::size_t unchanged_suffix{};
+	QMetaObject::Connection contents_change_connection;
+};
+
+static std::vector<Tool> scheduled_tools;
+static std::map<Job_key, Clock::time_point> debouncing_jobs; //time when the job stops debouncing and gets queued
+static std::vector<Queued_job> queued_jobs;
+static std::map<Job_key, Running_job> running_jobs;
+static std::map<Tool, Tool_scheduler::Statistics> statistics;
+
+static std::chrono::milliseconds to_milliseconds(Clock::duration duration) {
+	return std::chrono::duration_cast<std::chrono::milliseconds>(duration);
+}
+
+static std::size_t get_slot_count() {
+	const int default_slot_count = std::max(1u, std::thread::hardware_concurrency());
+	return std::max(1, Settings::get<Settings::Key::max_concurrent_tools>(default_slot_count));
+}
+
+static void dispatch();
+
+static std::uint64_t get_line_hash(const QString &line) {
+	return Background_tokenizer::get_text_hash({reinterpret_cast<const char16_t *>(line.utf16()), static_cast<std::size_t>(line.size())});
+}
+
+//the lines that changed since the tool got line_hashes, then the current version, see Tool_scheduler
+static std::string get_document_update(const QTextDocument &document, Running_job &job) {
+	auto &line_hashes = job.line_hashes;
+	const auto line_count = static_cast<std::size_t>(document.blockCount());
+	const auto prefix_size = std::min({job.unchanged_prefix, line_count, line_hashes.size()});
+	const auto suffix_size = std::min({job.unchanged_suffix, line_count - prefix_size, line_hashes.size() - prefix_size});
+	job.unchanged_prefix = job.unchanged_suffix = line_count;
+	//only the edited lines are hashed, they may still be unchanged because highlighting a block reports it as edited too
+	std::vector<QString> lines;
+	std::vector<std::uint64_t> hashes;
+	for (auto block = document.findBlockByNumber(static_cast<int>(prefix_size)); lines.size() < line_count - prefix_size - suffix_size;
+		 block = block.next()) {
+		lines.push_back(block.text());
+		hashes.push_back(get_line_hash(lines.back()));
+	}
+	const auto edited_begin = std::begin(line_hashes) + static_cast<std::ptrdiff_t>(prefix_size);
+	const auto edited_end = std::end(line_hashes) - static_cast<std::ptrdiff_t>(suffix_size);
+	const auto common_size = std::min(hashes.size(), static_cast<std::size_t>(edited_end - edited_begin));
+	std::size_t same_prefix_size = 0;
+	while (same_prefix_size < common_size && hashes[same_prefix_size] == edited_begin[same_prefix_size]) {
+		same_prefix_size++;
+	}
+	std::size_t same_suffix_size = 0;
+	while (same_suffix_size < common_size - same_prefix_size && hashes[hashes.size() - 1 - same_suffix_size] == edited_end[-1 - same_suffix_size]) {
+		same_suffix_size++;
+	}
+	std::string update;
+	const auto first_line = prefix_size + same_prefix_size;
+	const auto removed_count = static_cast<std::size_t>(edited_end - edited_begin) - same_prefix_size - same_suffix_size;
+	const auto inserted_count = hashes.size() - same_prefix_size - same_suffix_size;
+	if (removed_count != 0 || inserted_count != 0) {
+		update += "replace " + std::to_string(first_line) + ' ' + std::to_string(removed_count) + ' ' + std::to_string(inserted_count) + '\n';
+		for (std::size_t line = same_prefix_size; line < same_prefix_size + inserted_count; line++) {
+			update += lines[line].toStdString() + '\n';
+		}
+		const auto replaced_begin = edited_begin + static_cast<std::ptrdiff_t>(same_prefix_size);
+		const auto inserted_begin = std::begin(hashes) + static_cast<std::ptrdiff_t>(same_prefix_size);
+		line_hashes.insert(line_hashes.erase(replaced_begin, replaced_begin + static_cast<std::ptrdiff_t>(removed_count)), inserted_begin,
+						   inserted_begin + static_cast<std::ptrdiff_t>(inserted_count));
+	}
+	update += "version " + std::to_string(document.revision()) + '\n';
+	return update;
+}
+
+//narrows down the lines get_document_update has to look at
+static void track_edit(const Job_key &key, int position, int added_size) {
+	const auto running_job = running_jobs.find(key);
+	if (running_job == std::end(running_jobs)) {
+		return;
+	}
+	const auto &document = *key.first->document();
+	const auto get_block_number = [&document](int position) {
+		const auto block = document.findBlock(position);
+		return block.isValid() ? block.blockNumber() : document.blockCount() - 1;
+	};
+	auto &job = running_job->second;
+	job.unchanged_prefix = std::min(job.unchanged_prefix, static_cast<std::size_t>(get_block_number(position)));
+	job.unchanged_suffix =
+		std::min(job.unchanged_suffix, static_cast<std::size_t>(document.blockCount() - 1 - get_block_number(position + added_size)));
+}
+
+static void send_document_update(Edit_window *edit_window, Running_job &job) {
+	if (edit_window == nullptr) {
+		return;
+	}
+	job.process_reader->write_input(get_document_update(*edit_window->document(), job));
+}
+
+static void finish(const Job_key &key) {
+	const auto running_job = running_jobs.find(key);
+	if (running_job == std::end(running_jobs)) { //stopped already
+		return;
+	}
+	auto &tool_statistics = statistics[key.second];
+	if (running_job->second.superseded) {
+		tool_statistics.superseded_runs++;
+	} else {
+		const auto run_time = to_milliseconds(Clock::now() - running_job->second.started);
+		tool_statistics.runs++;
+		tool_statistics.last_run_time = run_time;
+		tool_statistics.max_run_time = std::max(tool_statistics.max_run_time, run_time);
+		tool_statistics.total_run_time += run_time;
+	}
+	QObject::disconnect(running_job->second.contents_change_connection);
+	running_jobs.erase(running_job);
+	dispatch();
+}
+
+static void start(const Queued_job &job) {
+	const auto now = Clock::now();
+	const auto queue_wait = to_milliseconds(now - job.queued);
+	auto &tool_statistics = statistics[job.key.second];
+	tool_statistics.starts++;
+	tool_statistics.last_queue_wait = queue_wait;
+	tool_statistics.max_queue_wait = std::max(tool_statistics.max_queue_wait, queue_wait);
+	tool_statistics.total_queue_wait += queue_wait;
+	auto process_reader = Tool_actions::start(job.key.second, job.key.first, [key = job.key](Process_reader::State) {
+		//we are being called by the Process_reader, so it must not be destroyed right now
+		Utility::gui_call([key] { finish(key); });
+	});
+	auto &running_job = running_jobs.insert_or_assign(job.key, Running_job{std::move(process_reader), now, false, {}, 0, 0, {}}).first->second;
+	if (job.key.second.keeps_input_open() && job.key.first != nullptr) {
+		running_job.contents_change_connection =
+			QObject::connect(job.key.first->document(), &QTextDocument::contentsChange,
+							 [key = job.key](int position, int /*removed_size*/, int added_size) { track_edit(key, position, added_size); });
+		send_document_update(job.key.first, running_job);
+	}
+}
+
+static void dispatch() {
+	//tools that keep their input open run as long as their document is open, so they don't take a slot
+	const auto slot_count = get_slot_count();
+	const auto get_busy_slot_count = [] {
+		return std::count_if(std::begin(running_jobs), std::end(running_jobs),
+							 [](const auto &running_job) { return running_job.first.second.keeps_input_open() == false; });
+	};
+	while (static_cast<std::size_t>(get_busy_slot_count()) < slot_count) {
+		//a tool may only run once per document at a time, a superseded run must exit before the new one starts
+		const auto is_startable = [](const Queued_job &job) { return running_jobs.count(job.key) == 0; };
+		const auto focused_edit_window = MainWindow::get_current_edit_window();
+		auto job = std::find_if(std::begin(queued_jobs), std::end(queued_jobs),
+								[&](const Queued_job &queued_job) { return queued_job.key.first == focused_edit_window && is_startable(queued_job); });
+		if (job == std::end(queued_jobs)) {
+			job = std::find_if(std::begin(queued_jobs), std::end(queued_jobs), is_startable);
+		}
+		if (job == std::end(queued_jobs)) {
+			return;
+		}
+		const auto started_job = std::move(*job);
+		queued_jobs.erase(job);
+		start(started_job);
+	}
+}
+
+static void enqueue(Job_key key) {
+	if (const auto running_job = running_jobs.find(key); running_job != std::end(running_jobs) && running_job->second.superseded == false) {
+		if (key.second.keeps_input_open()) {
+			send_document_update(key.first, running_job->second);
+			return;
+		}
+		running_job->second.superseded = true;
+		running_job->second.process_reader->kill();
+	}
+	const auto is_queued = std::any_of(std::begin(queued_jobs), std::end(queued_jobs), [&key](const Queued_job &job) { return job.key == key; });
+	if (is_queued == false) { //the queued run will see the newest input anyways
+		queued_jobs.push_back({std::move(key), Clock::now()});
+	}
+	dispatch();
+}
+
+static void wait_for_debounce(Job_key key, Clock::duration delay) {
+	QTimer::singleShot(std::chrono::ceil<std::chrono::milliseconds>(delay).count(), [key = std::move(key)] {
+		const auto debouncing_job = debouncing_jobs.find(key);
+		if (debouncing_job == std::end(debouncing_jobs)) { //removed while waiting
+			return;
+		}
+		const auto time_left = debouncing_job->second - Clock::now();
+		if (time_left > Clock::duration::zero()) { //edited again while waiting
+			wait_for_debounce(key, time_left);
+			return;
+		}
+		debouncing_jobs.erase(debouncing_job);
+		enqueue(key);
+	});
+}
+
+void Tool_scheduler::set_tools(const std::vector<Tool> &tools) {
+	scheduled_tools.clear();
+	std::copy_if(std::begin(tools), std::end(tools), std::back_inserter(scheduled_tools), [](const Tool &tool) {
+		return tool.activation == Tool_activation::on_file_edit || tool.activation == Tool_activation::on_save_file ||
+			   tool.activation == Tool_activation::on_build;
+	});
+}
+
+void Tool_scheduler::file_edited(Edit_window *edit_window) {
+	if (Tool_actions::is_editing_document()) { //a tool that pastes its output would otherwise activate itself forever
+		return;
+	}
+	const auto due = Clock::now() + debounce_delay;
+	for (const auto &tool : scheduled_tools) {
+		if (tool.activation != Tool_activation::on_file_edit) {
+			continue;
+		}
+		//only the first edit starts a timer, later edits just push back the deadline
+		if (debouncing_jobs.insert_or_assign({edit_window, tool}, due).second) {
+			wait_for_debounce({edit_window, tool}, debounce_delay);
+		}
+	}
+}
+
+void Tool_scheduler::file_saved(Edit_window *edit_window) {
+	for (const auto &tool : scheduled_tools) {
+		if (tool.activation == Tool_activation::on_save_file) {
+			enqueue({edit_window, tool});
+		}
+	}
+}
+
+void Tool_scheduler::project_built() {
+	for (const auto &tool : scheduled_tools) {
+		if (tool.activation == Tool_activation::on_build) {
+			enqueue({nullptr, tool});
+		}
+	}
+}
+
+void Tool_scheduler::remove_edit_window(Edit_window *edit_window) {
+	for (auto debouncing_job = std::begin(debouncing_jobs); debouncing_job != std::end(debouncing_jobs);) {
+		debouncing_job = debouncing_job->first.first == edit_window ? debouncing_jobs.erase(debouncing_job) : std::next(debouncing_job);
+	}
+	queued_jobs.erase(std::remove_if(std::begin(queued_jobs), std::end(queued_jobs), [edit_window](const Queued_job &job) { return job.key.first == edit_window; }),
+					  std::end(queued_jobs));
+	for (auto &running_job : running_jobs) {
+		if (running_job.first.first == edit_window) {
+			running_job.second.superseded = true;
+			running_job.second.process_reader->kill();
+		}
+	}
+}
+
+void Tool_scheduler::stop() {
+	debouncing_jobs.clear();
+	queued_jobs.clear();
+	for (auto &running_job : running_jobs) {
+		QObject::disconnect(running_job.second.contents_change_connection);
+	}
+	running_jobs.clear(); //destroying a Process_reader kills its tool without waiting for it, so finish is not called for these jobs
+}
+
+std::size_t Tool_scheduler::get_queued_count() {
+	return debouncing_jobs.size() + queued_jobs.size();
+}
+
+std::size_t Tool_scheduler::get_running_count() {
+	return running_jobs.size();
+}
+
+Tool_scheduler::Statistics Tool_scheduler::get_statistics(const Tool &tool) {
+	const auto tool_statistics = statistics.find(tool);
+	return tool_statistics == std::end(statistics) ? Statistics{} : tool_statistics->second;
+}
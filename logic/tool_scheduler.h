@@ -0,0 +1,47 @@
+#ifndef TOOL_SCHEDULER_H
+#define TOOL_SCHEDULER_H
+
+#include <chrono>
+#include <cstddef>
+#include <vector>
+
+class Edit_window;
+struct Tool;
+
+/* Runs the tools that are activated by editing, saving or building instead of a keyboard shortcut.
+ * Edits are debounced per document and tool, so typing only runs a tool once the user pauses. A run that is superseded by newer input is killed.
+ * At most Settings::Key::max_concurrent_tools tools run at once, queued tools for the focused tab go first.
+ * Semantic highlighting tools activated by editing are not restarted. They keep running and get the edits on their standard input instead:
+ *   replace 10 1 2        line 10 (0 based) was removed and the 2 lines that follow were inserted in its place
+ *   int x;                the inserted lines without line breaks, as UTF-8
+ *   int y;
+ *   version 42            the $DocumentVersion the document has with all edits so far, the tool prints it with the deltas that are for it
+ * The first update replaces the empty document with all lines. A tool that exits is started again on the next edit.
+ * All functions must be called from the GUI thread. */
+namespace Tool_scheduler {
+	constexpr std::chrono::milliseconds debounce_delay{300};
+
+	struct Statistics {
+		std::size_t starts{}; //runs that left the queue, the queue wait is measured for each
+		std::size_t runs{};
+		std::size_t superseded_runs{};
+		std::chrono::milliseconds last_queue_wait{};
+		std::chrono::milliseconds max_queue_wait{};
+		std::chrono::milliseconds total_queue_wait{};
+		std::chrono::milliseconds last_run_time{};
+		std::chrono::milliseconds max_run_time{};
+		std::chrono::milliseconds total_run_time{};
+	};
+
+	void set_tools(const std::vector<Tool> &tools);
+	void file_edited(Edit_window *edit_window); //ignores edits that insert the output of a tool
+	void file_saved(Edit_window *edit_window);
+	void project_built();
+	void remove_edit_window(Edit_window *edit_window); //drops queued runs for edit_window and kills its running tools
+	void stop(); //drops queued runs and kills running tools without waiting for them
+	std::size_t get_queued_count(); //debouncing and waiting for a free slot
+	std::size_t get_running_count();
+	Statistics get_statistics(const Tool &tool);
+} // namespace Tool_scheduler
+
+#endif // TOOL_SCHEDULER_H
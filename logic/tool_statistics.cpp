@@ -0,0 +1,140 @@
+#include "tool_statistics.h"
+#include "tool.h"
+#include "tool_scheduler.h"
+
+#include <QObject>
+#include <algorithm>
+#include <cmath>
+#include <deque>
+#include <map>
+
+static std::map<Tool, std::deque<Process_reader::Run_statistics>> histories;
+
+template <class T>
+static Tool_statistics::Percentiles<T> get_percentiles(std::vector<T> values) {
+	if (values.empty()) {
+		return {};
+	}
+	std::sort(std::begin(values), std::end(values));
+	const auto get_percentile = [&values](double percentile) { //nearest rank
+		const auto rank = static_cast<std::size_t>(std::ceil(percentile * values.size()));
+		return values[std::max<std::size_t>(rank, 1) - 1];
+	};
+	return {get_percentile(.5), get_percentile(.9), get_percentile(.99), values.back()};
+}
+
+template <class T, class Function>
+static Tool_statistics::Percentiles<T> get_percentiles(const std::deque<Process_reader::Run_statistics> &history, Function &&get_value) {
+	std::vector<T> values;
+	values.reserve(history.size());
+	for (const auto &statistics : history) {
+		if (const auto value = get_value(statistics)) {
+			values.push_back(*value);
+		}
+	}
+	return get_percentiles(std::move(values));
+}
+
+void Tool_statistics::add(const Tool &tool, const Process_reader::Run_statistics &statistics) {
+	auto &history = histories[tool];
+	if (history.size() == history_size) {
+		history.pop_front();
+	}
+	history.push_back(statistics);
+}
+
+std::vector<Process_reader::Run_statistics> Tool_statistics::get_history(const Tool &tool) {
+	const auto history = histories.find(tool);
+	if (history == std::end(histories)) {
+		return {};
+	}
+	return {std::begin(history->second), std::end(history->second)};
+}
+
+Tool_statistics::Summary Tool_statistics::get_summary(const Tool &tool) {
+	const auto history_entry = histories.find(tool);
+	if (history_entry == std::end(histories)) {
+		return {};
+	}
+	const auto &history = history_entry->second;
+	using Run_statistics = Process_reader::Run_statistics;
+	using std::chrono::microseconds;
+	Summary summary;
+	summary.runs = history.size();
+	summary.wall_time = get_percentiles<microseconds>(history, [](const Run_statistics &run) { return std::optional{run.wall_time}; });
+	summary.cpu_time =
+		get_percentiles<microseconds>(history, [](const Run_statistics &run) { return std::optional{run.user_cpu_time + run.system_cpu_time}; });
+	summary.time_to_first_output = get_percentiles<microseconds>(history, [](const Run_statistics &run) { return run.time_to_first_output; });
+	summary.max_rss_kib = get_percentiles<long>(history, [](const Run_statistics &run) { return std::optional{run.max_rss_kib}; });
+	summary.bytes_written = get_percentiles<std::size_t>(history, [](const Run_statistics &run) { return std::optional{run.bytes_written}; });
+	summary.bytes_read =
+		get_percentiles<std::size_t>(history, [](const Run_statistics &run) { return std::optional{run.output_bytes_read + run.error_bytes_read}; });
+	return summary;
+}
+
+std::vector<Tool> Tool_statistics::get_tools() {
+	std::vector<Tool> tools;
+	tools.reserve(histories.size());
+	for (const auto &history : histories) {
+		tools.push_back(history.first);
+	}
+	return tools;
+}
+
+static QString to_string(std::chrono::microseconds duration) {
+	return QObject::tr("%1ms").arg(duration.count() / 1000., 0, 'f', 1);
+}
+
+static QString to_string(std::chrono::milliseconds duration) {
+	return QObject::tr("%1ms").arg(duration.count());
+}
+
+static QString to_string(std::size_t size) {
+	return QString::number(size);
+}
+
+static QString to_string(long size) {
+	return QObject::tr("%1KiB").arg(size);
+}
+
+template <class T>
+static QString to_string(const QString &name, const Tool_statistics::Percentiles<T> &percentiles) {
+	return QObject::tr("  %1 median %2, p90 %3, p99 %4, max %5\n")
+		.arg(name.leftJustified(16), to_string(percentiles.median), to_string(percentiles.p90), to_string(percentiles.p99))
+		.arg(to_string(percentiles.max));
+}
+
+QString Tool_statistics::get_report() {
+	if (histories.empty()) {
+		return QObject::tr("No tools have run yet.");
+	}
+	QString report;
+	for (const auto &tool : get_tools()) {
+		const auto summary = get_summary(tool);
+		report += QObject::tr("%1 (last %2 runs)\n").arg(tool.get_name()).arg(summary.runs);
+		report += to_string(QObject::tr("Wall time"), summary.wall_time);
+		report += to_string(QObject::tr("CPU time"), summary.cpu_time);
+		report += to_string(QObject::tr("First output"), summary.time_to_first_output);
+		report += to_string(QObject::tr("Max RSS"), summary.max_rss_kib);
+		report += to_string(QObject::tr("Bytes written"), summary.bytes_written);
+		report += to_string(QObject::tr("Bytes read"), summary.bytes_read);
+		if (const auto scheduler_statistics = Tool_scheduler::get_statistics(tool); scheduler_statistics.starts > 0) {
+			const auto average = [](std::chrono::milliseconds total, std::size_t count) { return count == 0 ? total : total / static_cast<long>(count); };
+			report += QObject::tr("  %1 last %2, average %3, max %4\n")
+						  .arg(QObject::tr("Queue wait").leftJustified(16), to_string(scheduler_statistics.last_queue_wait),
+							   to_string(average(scheduler_statistics.total_queue_wait, scheduler_statistics.starts)),
+							   to_string(scheduler_statistics.max_queue_wait));
+			report += QObject::tr("  %1 last %2, average %3, max %4 (%5 runs, %6 superseded)\n")
+						  .arg(QObject::tr("Scheduled run").leftJustified(16), to_string(scheduler_statistics.last_run_time),
+							   to_string(average(scheduler_statistics.total_run_time, scheduler_statistics.runs)), to_string(scheduler_statistics.max_run_time))
+						  .arg(scheduler_statistics.runs)
+						  .arg(scheduler_statistics.superseded_runs);
+		}
+		report += '\n';
+	}
+	return report;
+}
+
+void Tool_statistics::clear() {
+	histories.clear();
+}
@@ -0,0 +1,43 @@
+#ifndef TOOL_STATISTICS_H
+#define TOOL_STATISTICS_H
+
+#include "process_reader.h"
+
+#include <QString>
+#include <chrono>
+#include <cstddef>
+#include <vector>
+
+struct Tool;
+
+//keeps the resource usage of the last runs of each tool so slow tools can be found, must only be used from the GUI thread
+namespace Tool_statistics {
+	constexpr std::size_t history_size = 100; //runs kept per tool, older ones are dropped
+
+	template <class T>
+	struct Percentiles {
+		T median{};
+		T p90{};
+		T p99{};
+		T max{};
+	};
+
+	struct Summary {
+		std::size_t runs{}; //runs in the history
+		Percentiles<std::chrono::microseconds> wall_time;
+		Percentiles<std::chrono::microseconds> cpu_time; //user + system
+		Percentiles<std::chrono::microseconds> time_to_first_output; //of the runs that printed something
+		Percentiles<long> max_rss_kib;
+		Percentiles<std::size_t> bytes_written;
+		Percentiles<std::size_t> bytes_read; //output + error
+	};
+
+	void add(const Tool &tool, const Process_reader::Run_statistics &statistics);
+	std::vector<Process_reader::Run_statistics> get_history(const Tool &tool); //oldest first
+	Summary get_summary(const Tool &tool);
+	std::vector<Tool> get_tools(); //tools that have a history
+	QString get_report();          //summary of all tools in human readable form, with the queue wait and run time of the Tool_scheduler for scheduled tools
+	void clear();
+} // namespace Tool_statistics
+
+#endif // TOOL_STATISTICS_H
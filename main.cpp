@@ -7,6 +7,10 @@
 
 int main(int argc, char *argv[]) {
 	QApplication a{argc, argv};
+	if (argc == 2 && std::strcmp(argv[1], "benchmark") == 0) { //meant for release mode, takes a while
+		benchmark();
+		return 0;
+	}
 	assert((test(), true)); //don't run tests in release mode
 	if (argc == 2 && std::strcmp(argv[1], "test") == 0) {
 		return 0;
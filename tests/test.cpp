@@ -1,16 +1,56 @@
 #include "test.h"
+#include "test_ansi_parser.h"
+#include "test_background_tokenizer.h"
+#include "test_console_buffer.h"
+#include "test_diagnostic_parser.h"
+#include "test_highlighting_rules.h"
 #include "test_mainwindow.h"
+#include "test_output_search.h"
 #include "test_plugin.h"
 #include "test_process_reader.h"
+#include "test_semantic_token_parser.h"
 #include "test_settings.h"
+#include "test_sgr_attributes.h"
+#include "test_syntax_highligher.h"
+#include "test_syntax_rules.h"
+#include "test_terminal_screen.h"
+#include "test_token_automaton.h"
 #include "test_tool.h"
 #include "test_tool_editor_widget.h"
+#include "test_tool_scheduler.h"
+#include "test_utf8_decoder.h"
 
 void test() {
+	test_ansi_parser();
+	test_background_tokenizer();
+	test_console_buffer();
+	test_diagnostic_parser();
+	test_highlighting_rules();
+	test_output_search();
 	test_plugin();
 	test_process_reader();
+	test_semantic_token_parser();
 	test_settings();
+	test_sgr_attributes();
+	test_syntax_highligher();
+	test_syntax_rules();
+	test_terminal_screen();
+	test_token_automaton();
 	test_tool();
 	test_tool_editor_widget();
+	test_tool_scheduler();
+	test_utf8_decoder();
 	test_mainwindow();
+}
+
+void benchmark() {
+	benchmark_ansi_parser();
+	benchmark_console_buffer();
+	benchmark_highlighting_rules();
+	benchmark_output_search();
+	benchmark_process_reader();
+	benchmark_syntax_rules();
+	benchmark_terminal_screen();
+	benchmark_token_automaton();
+	benchmark_utf8_decoder();
 }
\ No newline at end of file
@@ -10,6 +10,8 @@
 
 //run all tests
 void test();
+//run all benchmarks and print their results, they are too slow to run with the tests
+void benchmark();
 
 namespace detail {
 	extern std::stringstream ss;
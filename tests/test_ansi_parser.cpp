@@ -0,0 +1,141 @@
+#include "test_ansi_parser.h"
+#include "logic/ansi_parser.h"
+#include "test.h"
+
+#include <QProcess>
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace {
+	struct Recorder : Ansi_parser::Default_handler { //records everything so we can compare parsing in one piece with parsing in chunks
+		void on_text(std::string_view text) {
+			if (events.empty() || events.back().front() != 'T') {
+				events.push_back("T");
+			}
+			events.back() += text;
+		}
+		void on_control_sequence(std::string_view parameters, char final_byte) {
+			events.push_back("C" + std::string{parameters} + final_byte);
+		}
+		void on_escape_sequence(std::string_view intermediates, char final_byte) {
+			events.push_back("E" + std::string{intermediates} + final_byte);
+		}
+		void on_operating_system_command(std::string_view command) {
+			events.push_back("O" + std::string{command});
+		}
+		std::vector<std::string> events;
+	};
+} // namespace
+
+static void test_sequences() {
+	const std::string_view input = "plain \033[1;31mred\033[0m\033c\033(B\033]0;title\a\033]2;t2\033\\x\033Pignored\033\\y\033[?25h end";
+	Recorder recorder;
+	Ansi_parser parser;
+	parser.feed(input, recorder);
+	const std::vector<std::string> expected = {
+		"Tplain ", "C1;31m", "Tred", "C0m", "Ec", "E(B", "O0;title", "O2;t2", "Txy", "C?25h", "T end",
+	};
+	assert_true(recorder.events == expected);
+	assert_true(parser.is_in_sequence() == false);
+}
+
+static void test_chunk_boundaries() { //splitting the input anywhere must not change the result, including in the middle of UTF-8 characters
+	const std::string_view input = "a\033[01;31m\033[Kerror: \033[m\033[K h\xc3\xa4 \xe2\x82\xac \xf0\x9d\x84\x9e\033]0;title\033\\\033c";
+	Recorder whole;
+	Ansi_parser{}.feed(input, whole);
+	for (std::size_t split = 0; split <= input.size(); split++) {
+		for (std::size_t second_split = split; second_split <= input.size(); second_split++) {
+			Recorder recorder;
+			Ansi_parser parser;
+			parser.feed(input.substr(0, split), recorder);
+			parser.feed(input.substr(split, second_split - split), recorder);
+			parser.feed(input.substr(second_split), recorder);
+			assert_true(recorder.events == whole.events);
+		}
+	}
+	Recorder recorder;
+	Ansi_parser parser;
+	parser.feed("\033[1;3", recorder);
+	assert_true(parser.is_in_sequence());
+	assert_true(recorder.events.empty());
+}
+
+static void benchmark_parser_throughput() {
+	//real compiler output with colors is mostly short escape sequences between short pieces of text
+	QProcess compiler;
+	compiler.start("g++", {"-x", "c++", "-fsyntax-only", "-fdiagnostics-color=always", "-fdiagnostics-urls=never", "-"});
+	compiler.write("#include <vector>\nint main() { std::vector<int> v; v.push_back(\"a\"); int x = \"b\"; undefined(x); for (;;) }\n");
+	compiler.closeWriteChannel();
+	if (compiler.waitForFinished() == false) {
+		std::cout << "Ansi parser throughput: skipped, no compiler\n";
+		return;
+	}
+	const auto diagnostics = compiler.readAllStandardError().toStdString();
+	if (diagnostics.empty()) {
+		return;
+	}
+	std::string output;
+	while (output.size() < std::size_t{32} << 20) {
+		output += diagnostics;
+	}
+
+	const auto per_character = [](std::string_view text, std::size_t &plaintext_size) { //how Ansi_code_handling used to parse
+		constexpr auto esc = '\033';
+		while (text.empty() == false) {
+			std::size_t size = 0;
+			while (size < text.size() && text[size] != esc) {
+				size++;
+			}
+			plaintext_size += size;
+			text.remove_prefix(size);
+			if (text.size() < 2) {
+				break;
+			}
+			std::size_t control_sequence_size = 2;
+			while (control_sequence_size < text.size() && text[control_sequence_size] < '\100') {
+				control_sequence_size++;
+			}
+			text.remove_prefix(std::min(text.size(), control_sequence_size + 1));
+		}
+	};
+	const auto measure = [&output](auto &&parse) {
+		const auto start = std::chrono::steady_clock::now();
+		parse();
+		return output.size() / std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() / 1e6;
+	};
+	constexpr std::size_t chunk_size = 4096;
+	std::size_t old_plaintext_size = 0;
+	const auto old_throughput = measure([&] {
+		for (std::size_t position = 0; position < output.size(); position += chunk_size) {
+			per_character(std::string_view{output}.substr(position, chunk_size), old_plaintext_size);
+		}
+	});
+	struct : Ansi_parser::Default_handler {
+		void on_text(std::string_view text) {
+			size += text.size();
+		}
+		std::size_t size{};
+	} counter;
+	const auto new_throughput = measure([&] {
+		Ansi_parser parser;
+		for (std::size_t position = 0; position < output.size(); position += chunk_size) {
+			parser.feed(std::string_view{output}.substr(position, chunk_size), counter);
+		}
+	});
+	assert_true(old_plaintext_size > 0); //the old parser mangles sequences split between chunks, so the sizes differ
+	std::cout << "Ansi parser throughput on colored compiler output: per character " << old_throughput << " MB/s, Ansi_parser " << new_throughput
+			  << " MB/s\n";
+}
+
+void test_ansi_parser() {
+	test_sequences();
+	test_chunk_boundaries();
+}
+
+void benchmark_ansi_parser() {
+	benchmark_parser_throughput();
+}
@@ -0,0 +1,7 @@
+#ifndef TEST_ANSI_PARSER_H
+#define TEST_ANSI_PARSER_H
+
+void test_ansi_parser();
+void benchmark_ansi_parser();
+
+#endif // TEST_ANSI_PARSER_H
@@ -0,0 +1,117 @@
+#include "test_background_tokenizer.h"
+#include "logic/background_tokenizer.h"
+#include "test.h"
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+#include <string>
+#include <vector>
+
+struct Collected_batches {
+	void receive(std::size_t job, std::vector<Background_tokenizer::Line_tokens> batch, bool is_finished) {
+		std::lock_guard lock{mutex};
+		batches.push_back(std::move(batch));
+		if (is_finished) {
+			finished_jobs.push_back(job);
+			finished.notify_all();
+		}
+	}
+	void wait_for(std::size_t job) {
+		std::unique_lock lock{mutex};
+		finished.wait(lock, [&] { return std::find(std::begin(finished_jobs), std::end(finished_jobs), job) != std::end(finished_jobs); });
+	}
+	std::mutex mutex;
+	std::condition_variable finished;
+	std::vector<std::vector<Background_tokenizer::Line_tokens>> batches;
+	std::vector<std::size_t> finished_jobs;
+};
+
+static Highlighting_rules make_rules() {
+	Highlighting_rules rules;
+	rules.add_rule(R"(\bint\b)");
+	rules.add_rule(R"([A-Za-z_]\w*)");
+	rules.add_region(R"(/\*)", R"(\*/)");
+	return rules;
+}
+
+static std::vector<std::u16string> make_lines(std::size_t line_count) {
+	std::vector<std::u16string> lines;
+	for (std::size_t line = 0; line < line_count; line++) {
+		const auto number = std::to_string(line);
+		lines.push_back(u"int x" + std::u16string(std::begin(number), std::end(number)) + u" = 1;");
+	}
+	lines[100] = u"/* the comment ends far below";
+	lines[line_count - 100] = u"*/ int y;";
+	return lines;
+}
+
+static void test_viewport_first() {
+	const std::size_t line_count = 20'000;
+	const std::size_t first_line = 5;
+	const auto lines = make_lines(line_count);
+	Collected_batches collected;
+	Background_tokenizer tokenizer{make_rules(), [&collected](std::size_t job, std::vector<Background_tokenizer::Line_tokens> batch, bool is_finished) {
+									   collected.receive(job, std::move(batch), is_finished);
+								   }};
+	tokenizer.set_viewport(first_line + 10'000, 50);
+	const auto job = tokenizer.start(lines, first_line, Highlighting_rules::no_region);
+	collected.wait_for(job);
+
+	//the viewport comes first, without knowing that it is inside of the comment
+	assert_true(collected.batches.size() > line_count / Background_tokenizer::batch_size);
+	const auto &viewport = collected.batches.front();
+	assert_equal(viewport.size(), 50u);
+	assert_equal(viewport.front().line, first_line + 10'000);
+	assert_equal(viewport.front().start_state, Highlighting_rules::no_region);
+	assert_equal(viewport.back().end_state, Highlighting_rules::no_region);
+
+	//the last result for every line is what tokenizing the lines in order gives
+	auto rules = make_rules();
+	std::vector<const Background_tokenizer::Line_tokens *> last_results(line_count);
+	std::size_t result_count = 0;
+	for (const auto &batch : collected.batches) {
+		for (const auto &tokens : batch) {
+			last_results[tokens.line - first_line] = &tokens;
+			result_count++;
+		}
+	}
+	assert_equal(result_count, line_count + 50); //the viewport was sent again with the state of the comment
+	int state = Highlighting_rules::no_region;
+	for (std::size_t line = 0; line < line_count; line++) {
+		const auto &result = *last_results[line];
+		std::vector<Highlighting_rules::Token> tokens;
+		assert_equal(result.start_state, state);
+		state = rules.find_tokens(lines[line], state, [&tokens](const Highlighting_rules::Token &token) { tokens.push_back(token); });
+		assert_equal(result.end_state, state);
+		assert_equal(result.text_hash, Background_tokenizer::get_text_hash(lines[line]));
+		assert_equal(result.tokens.size(), tokens.size());
+		for (std::size_t i = 0; i < tokens.size(); i++) {
+			assert_equal(result.tokens[i].begin, tokens[i].begin);
+			assert_equal(result.tokens[i].length, tokens[i].length);
+			assert_equal(result.tokens[i].rule, tokens[i].rule);
+		}
+	}
+	assert_true(state == Highlighting_rules::no_region);
+}
+
+static void test_restart() {
+	Collected_batches collected;
+	Background_tokenizer tokenizer{make_rules(), [&collected](std::size_t job, std::vector<Background_tokenizer::Line_tokens> batch, bool is_finished) {
+									   collected.receive(job, std::move(batch), is_finished);
+								   }};
+	const auto first_job = tokenizer.start(make_lines(200'000), 0, Highlighting_rules::no_region);
+	const auto second_job = tokenizer.start(make_lines(1000), 0, Highlighting_rules::no_region);
+	assert_true(first_job != second_job);
+	collected.wait_for(second_job);
+	assert_equal(collected.finished_jobs.back(), second_job);
+	//an empty job still finishes
+	collected.wait_for(tokenizer.start({}, 0, Highlighting_rules::no_region));
+	assert_equal(collected.batches.back().size(), 0u);
+}
+
+void test_background_tokenizer() {
+	test_viewport_first();
+	test_restart();
+}
@@ -0,0 +1,6 @@
+#ifndef TEST_BACKGROUND_TOKENIZER_H
+#define TEST_BACKGROUND_TOKENIZER_H
+
+void test_background_tokenizer();
+
+#endif // TEST_BACKGROUND_TOKENIZER_H
@@ -0,0 +1,96 @@
+#include "test_console_buffer.h"
+#include "logic/console_buffer.h"
+#include "test.h"
+
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <vector>
+
+static std::vector<std::string> get_lines(const Console_buffer &buffer) {
+	std::vector<std::string> lines;
+	for (std::size_t line = 0; line < buffer.get_line_count(); line++) {
+		lines.emplace_back(buffer.get_line(line));
+	}
+	return lines;
+}
+
+static void test_lines() {
+	Console_buffer buffer;
+	Console_buffer::Stream_state state;
+	assert_equal(buffer.get_line_count(), 1u);
+	buffer.append("first\r\nsec", state);
+	buffer.append("ond\r", state);
+	buffer.append("\nprogress 10%\rprogress 100%\n\ttab\a", state);
+	assert_true(get_lines(buffer) == std::vector<std::string>{"first", "second", "progress 100%", "\ttab"});
+	assert_equal(buffer.get_max_line_length(), 13u);
+	buffer.clear();
+	assert_true(get_lines(buffer) == std::vector<std::string>{""});
+}
+
+static void test_attributes() {
+	Console_buffer buffer;
+	Console_buffer::Stream_state output;
+	Console_buffer::Stream_state error;
+	buffer.append("plain \033[1;3", output);
+	buffer.append("1mred\n", output);
+	buffer.append("still red \033[0m", output);
+	buffer.append("error", error);
+	buffer.append("plain", output);
+	const auto first_line = buffer.get_runs(0);
+	assert_equal(first_line.size(), 2u);
+	assert_equal(first_line[0].text, "plain ");
+	assert_true(first_line[0].attributes == Sgr_attributes{});
+	assert_equal(first_line[1].text, "red");
+	assert_true(first_line[1].attributes.has(Sgr_attributes::bold));
+	assert_true(first_line[1].attributes.foreground == Sgr_color::from_index(1));
+	const auto second_line = buffer.get_runs(1);
+	assert_equal(second_line.size(), 2u); //the streams have separate attributes, but both are default after the reset
+	assert_equal(second_line[0].text, "still red ");
+	assert_equal(second_line[1].text, "errorplain");
+	assert_true(second_line[1].attributes == Sgr_attributes{});
+}
+
+static void test_scrollback_cap() {
+	Console_buffer buffer{3};
+	Console_buffer::Stream_state state;
+	buffer.append("\033[32m", state);
+	for (int line = 0; line < 1000; line++) {
+		buffer.append(std::to_string(line) + '\n', state);
+	}
+	assert_true(get_lines(buffer) == std::vector<std::string>{"998", "999", ""});
+	assert_equal(buffer.get_dropped_line_count(), 998u);
+	assert_true(buffer.get_size() < 100);
+	assert_true(buffer.get_runs(0).at(0).attributes.foreground == Sgr_color::from_index(2)); //attributes of dropped lines carry over
+	buffer.set_max_line_count(1);
+	assert_true(get_lines(buffer) == std::vector<std::string>{""});
+}
+
+static void benchmark_append_throughput() { //the console has to keep up with tools printing tens of MB/s
+	std::string chunk;
+	for (int line = 0; line < 1000; line++) {
+		chunk += "\033[1msrc/file.cpp:" + std::to_string(line) + ":5: \033[31merror: \033[0mexpected ';' after expression\r\n";
+	}
+	Console_buffer buffer{500'000};
+	Console_buffer::Stream_state state;
+	constexpr int chunk_count = 1000; //a million lines
+	const auto start = std::chrono::steady_clock::now();
+	for (int i = 0; i < chunk_count; i++) {
+		buffer.append(chunk, state);
+	}
+	const auto seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	assert_equal(buffer.get_line_count(), 500'000u);
+	assert_equal(buffer.get_dropped_line_count(), 500'001u);
+	std::cout << "Console buffer: " << chunk.size() * chunk_count / seconds / 1e6 << " MB/s, " << buffer.get_size() / 1e6 << " MB for "
+			  << buffer.get_line_count() << " lines\n";
+}
+
+void test_console_buffer() {
+	test_lines();
+	test_attributes();
+	test_scrollback_cap();
+}
+
+void benchmark_console_buffer() {
+	benchmark_append_throughput();
+}
@@ -0,0 +1,7 @@
+#ifndef TEST_CONSOLE_BUFFER_H
+#define TEST_CONSOLE_BUFFER_H
+
+void test_console_buffer();
+void benchmark_console_buffer();
+
+#endif // TEST_CONSOLE_BUFFER_H
@@ -0,0 +1,116 @@
+#include "test_diagnostic_parser.h"
+#include "logic/diagnostic_parser.h"
+#include "test.h"
+
+#include <string>
+
+static void test_parse_line() {
+	const auto gcc = Diagnostic_parser::parse_line("main.cpp:3:14: error: expected ';' before '}' token");
+	assert_true(gcc.has_value());
+	assert_equal(gcc->file, "main.cpp");
+	assert_equal(gcc->line, 3);
+	assert_equal(gcc->column, 14);
+	assert_true(gcc->severity == Diagnostic::Severity::error);
+	assert_equal(gcc->message, "expected ';' before '}' token");
+	const auto without_column = Diagnostic_parser::parse_line("C:/src/lib.h:120: warning: unused variable 'x' [-Wunused-variable]\r");
+	assert_true(without_column.has_value());
+	assert_equal(without_column->file, "C:/src/lib.h");
+	assert_equal(without_column->line, 120);
+	assert_equal(without_column->column, 0);
+	assert_equal(without_column->message, "unused variable 'x' [-Wunused-variable]");
+	const auto fatal = Diagnostic_parser::parse_line("/tmp/a b.c:1:10: fatal error: 'missing.h' file not found");
+	assert_true(fatal.has_value());
+	assert_true(fatal->severity == Diagnostic::Severity::fatal_error);
+	assert_equal(fatal->file, "/tmp/a b.c");
+	assert_true(!Diagnostic_parser::parse_line("In file included from main.cpp:1:"));
+	assert_true(!Diagnostic_parser::parse_line("make: *** [Makefile:12: all] Error 1"));
+	assert_true(!Diagnostic_parser::parse_line("/usr/bin/ld: main.o: in function `main':"));
+	assert_true(!Diagnostic_parser::parse_line("    3 |     return 0"));
+}
+
+static void test_fix_its() {
+	const auto fix_it = Diagnostic_parser::parse_fix_it(R"(fix-it:"dir/main.cpp":{3:14-3:14}:";\n\"x\"\101")");
+	assert_true(fix_it.has_value());
+	assert_equal(fix_it->file, "dir/main.cpp");
+	assert_equal(fix_it->first_line, 3);
+	assert_equal(fix_it->first_column, 14);
+	assert_equal(fix_it->end_line, 3);
+	assert_equal(fix_it->end_column, 14);
+	assert_equal(fix_it->replacement, ";\n\"x\"A");
+	assert_true(!Diagnostic_parser::parse_fix_it(R"(fix-it:"main.cpp":{3:14}:";")"));
+}
+
+static void test_streaming() {
+	const std::string output = "\033[01m\033[Kmain.cpp:3:14:\033[m\033[K \033[01;31m\033[Kerror: \033[m\033[Kexpected ';'\n"
+							   "    3 |     return 0\n"
+							   "fix-it:\"main.cpp\":{3:14-3:14}:\";\"\n"
+							   "/abs/other.h:7:1: note: declared here\n"
+							   "main.cpp:1:2: warning: last line without newline";
+	Diagnostic_parser parser{"/project/build"};
+	Diagnostic_index index;
+	for (std::size_t position = 0; position < output.size(); position++) { //one byte at a time to split every line and color code
+		parser.feed(output.substr(position, 1), index);
+		if (position == output.find('\n')) {
+			assert_equal(index.get_size(), 1u); //available as soon as its line is complete
+		}
+	}
+	assert_equal(index.get_size(), 2u);
+	parser.finish(index);
+	assert_equal(index.get_size(), 3u);
+	const auto &error = index.get(0);
+	assert_equal(error.file, "/project/build/main.cpp");
+	assert_equal(error.message, "expected ';'");
+	assert_equal(error.fix_its.size(), 1u);
+	assert_equal(error.fix_its[0].replacement, ";");
+	assert_equal(index.get(1).file, "/abs/other.h");
+	assert_true(index.get(1).fix_its.empty());
+}
+
+static void test_index() {
+	Diagnostic_index index;
+	const auto add = [&index](std::string file, int line, int column) {
+		Diagnostic diagnostic;
+		diagnostic.file = std::move(file);
+		diagnostic.line = line;
+		diagnostic.column = column;
+		index.add(std::move(diagnostic));
+	};
+	for (int line = 1000; line > 0; line--) { //out of order like diagnostics of templates instantiated later
+		add("a.cpp", line, line % 7);
+	}
+	add("b.cpp", 5, 1);
+	assert_equal(index.get_size(), 1001u);
+	assert_true(index.find("a.cpp", 500, 500 % 7) == &index.get(500));
+	assert_true(index.find("a.cpp", 500, 0) == nullptr);
+	assert_true(index.find("c.cpp", 1, 1) == nullptr);
+	assert_true(index.find_next("a.cpp", 500, 500 % 7) == &index.get(499));
+	assert_true(index.find_next("a.cpp", 1000, 6) == nullptr);
+	assert_true(index.find_next("b.cpp", 0, 0) == &index.get(1000));
+
+	//dropped diagnostics can't be found anymore, the others keep their ids
+	index.drop_before(999);
+	assert_equal(index.get_size(), 2u);
+	assert_equal(index.get(999).line, 1);
+	assert_true(index.find("a.cpp", 500, 500 % 7) == nullptr);
+	assert_true(index.find("a.cpp", 1, 1) == &index.get(999));
+	assert_true(index.find_next("a.cpp", 0, 0) == &index.get(999));
+	index.add_fix_it(0, {}); //for a dropped diagnostic
+	add("a.cpp", 1, 1);
+	assert_true(index.find_next("a.cpp", 0, 0) == &index.get(999));
+	assert_equal(index.get_end_id(), 1002u);
+	index.drop_before(1001);
+	assert_true(index.find("a.cpp", 1, 1) == &index.get(1001));
+	assert_true(index.find("b.cpp", 5, 1) == nullptr);
+
+	index.clear();
+	assert_equal(index.get_size(), 0u);
+	assert_equal(index.get_end_id(), 1002u);
+	assert_true(index.find("a.cpp", 1, 1) == nullptr);
+}
+
+void test_diagnostic_parser() {
+	test_parse_line();
+	test_fix_its();
+	test_streaming();
+	test_index();
+}
@@ -0,0 +1,6 @@
+#ifndef TEST_DIAGNOSTIC_PARSER_H
+#define TEST_DIAGNOSTIC_PARSER_H
+
+void test_diagnostic_parser();
+
+#endif // TEST_DIAGNOSTIC_PARSER_H
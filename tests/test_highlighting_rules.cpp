@@ -0,0 +1,287 @@
+#include "test_highlighting_rules.h"
+#include "logic/highlighting_rules.h"
+#include "logic/keyword_table.h"
+#include "test.h"
+#include "utility/binary_io.h"
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <regex>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+static void test_keyword_table() {
+	std::vector<std::pair<std::string, std::size_t>> keywords;
+	for (std::size_t i = 0; i < 1000; i++) {
+		keywords.emplace_back("word" + std::to_string(i * 7919), i);
+	}
+	keywords.emplace_back("word0", 1000); //duplicate, the first one is kept
+	const Keyword_table table{keywords};
+	assert_equal(table.get_size(), 1000u);
+	for (std::size_t i = 0; i < 1000; i++) {
+		const auto keyword = keywords[i].first;
+		assert_equal(table.find(std::u16string(std::begin(keyword), std::end(keyword))).value_or(-1), i);
+	}
+	assert_true(!table.find(u"word1"));
+	assert_true(!table.find(u"word"));
+	assert_true(!table.find(u""));
+	assert_true(!table.find(u"wörd0"));
+	assert_true(!Keyword_table{}.find(u"word0"));
+}
+
+static std::string get_tokens(Highlighting_rules &rules, std::u16string_view text) {
+	std::string tokens;
+	rules.find_tokens(text, [&](const Highlighting_rules::Token &token) {
+		tokens += std::to_string(token.rule) + ':' + std::string(std::begin(text) + token.begin, std::begin(text) + token.begin + token.length) + ' ';
+	});
+	return tokens;
+}
+
+static void test_priorities() {
+	Highlighting_rules rules;
+	rules.add_rule(R"(\bfor\b)");
+	rules.add_rule(R"(\w+_t\b)");
+	rules.add_rule(R"(\bsize_t\b)");
+	rules.add_rule(R"([a-z]+)");
+	rules.add_rule(R"(\bwhile\b)");
+	rules.add_rule(R"(\bfor\b)");
+	rules.add_rule(R"(\bfor_each\b)");
+	assert_equal(rules.get_rule_count(), 7u);
+	assert_equal(rules.get_keyword_count(), 5u);
+	assert_equal(get_tokens(rules, u"for(size_t i; while)"), "0:for 1:size_t 3:i 3:while ");
+	assert_equal(get_tokens(rules, u"for_each format xfor"), "6:for_each 3:format 3:xfor ");
+	assert_equal(get_tokens(rules, u"FOR 4for"), "3:for ");
+}
+
+//tokenizes lines one after the other, each line's tokens end with |
+static std::string get_line_tokens(Highlighting_rules &rules, const std::vector<std::u16string_view> &lines) {
+	std::string tokens;
+	int state = Highlighting_rules::no_region;
+	for (const auto line : lines) {
+		state = rules.find_tokens(line, state, [&](const Highlighting_rules::Token &token) {
+			tokens += std::to_string(token.rule) + ':' + std::string(std::begin(line) + token.begin, std::begin(line) + token.begin + token.length) + ' ';
+		});
+		tokens += '|';
+	}
+	return tokens;
+}
+
+static void test_regions() {
+	Highlighting_rules rules;
+	rules.add_rule(R"(\bint\b)");
+	rules.add_rule(R"(//.*)");
+	const auto comment = rules.add_region(R"(/\*)", R"(\*/)");
+	const auto raw_string = rules.add_region(R"~(R"([^()\\\s]{0,16})\()~", R"~(\)\1")~");
+	const auto if_0 = rules.add_region(R"(^\s*#\s*if\s+0\b)", R"(^\s*#\s*(endif|else|elif)\b)", R"(^\s*#\s*if)", R"(^\s*#\s*endif\b)");
+	assert_equal(rules.get_rule_count(), 5u);
+	assert_equal(comment, 2u);
+	assert_equal(raw_string, 3u);
+	assert_equal(if_0, 4u);
+
+	assert_equal(get_line_tokens(rules, {u"int /* int */ int // int /* int"}), "0:int 2:/* int */ 0:int 1:// int /* int |");
+	assert_equal(get_line_tokens(rules, {u"int /* a", u"int", u"b */ int"}), "0:int 2:/* a |2:int |2:b */ 0:int |");
+	assert_equal(get_line_tokens(rules, {u"/*", u"", u"*/"}), "2:/* ||2:*/ |");
+	assert_equal(get_line_tokens(rules, {u"R\"x(a)\" )\" int", u")x\" int"}), "3:R\"x(a)\" )\" int |3:)x\" 0:int |");
+	assert_equal(get_line_tokens(rules, {u"R\"(a)\" int"}), "3:R\"(a)\" 0:int |");
+	assert_equal(get_line_tokens(rules, {u"R\"*.(a)*x\")*.\""}), "3:R\"*.(a)*x\")*.\" |"); //the delimiter is matched literally
+	assert_equal(get_line_tokens(rules, {u"#if 0", u"int", u"#ifdef X", u"#else", u"#endif", u"int", u"#else", u"int"}),
+				 "4:#if 0 |4:int |4:#ifdef X |4:#else |4:#endif |4:int |4:#else |0:int |");
+	assert_equal(get_line_tokens(rules, {u"int #if 0", u"int"}), "0:int |0:int |"); //only at the start of a line
+
+	//the state after a line only depends on the region the line ends in
+	const auto first_state = rules.find_tokens(u"/* a", Highlighting_rules::no_region, [](const Highlighting_rules::Token &) {});
+	const auto second_state = rules.find_tokens(u"int /* b", Highlighting_rules::no_region, [](const Highlighting_rules::Token &) {});
+	assert_true(first_state != Highlighting_rules::no_region);
+	assert_equal(first_state, second_state);
+	assert_equal(rules.find_tokens(u"c", first_state, [](const Highlighting_rules::Token &) {}), first_state);
+	assert_equal(rules.find_tokens(u"*/", first_state, [](const Highlighting_rules::Token &) {}), Highlighting_rules::no_region);
+	assert_true(rules.find_tokens(u"R\"a(", Highlighting_rules::no_region, [](const Highlighting_rules::Token &) {}) !=
+				rules.find_tokens(u"R\"b(", Highlighting_rules::no_region, [](const Highlighting_rules::Token &) {}));
+	//copies agree on states no matter which of them found a region first
+	auto copy = rules;
+	const auto copy_state = copy.find_tokens(u"R\"c(", Highlighting_rules::no_region, [](const Highlighting_rules::Token &) {});
+	assert_equal(copy.find_tokens(u"R\"c(", Highlighting_rules::no_region, [](const Highlighting_rules::Token &) {}), copy_state);
+	assert_equal(rules.find_tokens(u"R\"c(", Highlighting_rules::no_region, [](const Highlighting_rules::Token &) {}), copy_state);
+	assert_equal(rules.find_tokens(u")c\" int", copy_state, [](const Highlighting_rules::Token &) {}), Highlighting_rules::no_region);
+	assert_equal(rules.find_tokens(u"/* a", Highlighting_rules::no_region, [](const Highlighting_rules::Token &) {}), first_state);
+
+	bool threw = false;
+	try {
+		rules.add_region("/\\*", "\\*/", "/\\*");
+	} catch (const std::runtime_error &) {
+		threw = true;
+	}
+	assert_true(threw);
+	assert_equal(rules.get_rule_count(), 5u);
+}
+
+static std::vector<std::string> load_patterns() {
+	std::ifstream file{TEST_DATA_PATH "c++-syntax.json"};
+	std::string json{std::istreambuf_iterator<char>{file}, std::istreambuf_iterator<char>{}};
+	json.erase(std::min(json.find("\"regions\""), json.size())); //only the token rules
+	std::vector<std::string> patterns;
+	const std::regex token{R"~(\[\s*"((?:[^"\\]|\\.)*)")~"};
+	for (auto match = std::sregex_iterator{std::begin(json), std::end(json), token}; match != std::sregex_iterator{}; ++match) {
+		patterns.push_back(std::regex_replace((*match)[1].str(), std::regex{R"(\\(.))"}, "$1"));
+	}
+	return patterns;
+}
+
+static std::vector<std::u16string_view> get_lines(const std::u16string &source) {
+	std::vector<std::u16string_view> lines;
+	for (std::size_t begin = 0, end = source.find(u'\n'); end != std::u16string::npos; begin = end + 1, end = source.find(u'\n', begin)) {
+		lines.push_back(std::u16string_view{source}.substr(begin, end - begin));
+	}
+	return lines;
+}
+
+static const std::u16string source_line = u"template <class T>\nstatic constexpr auto get_value(const T &value) noexcept {\n"
+										  u"\tif (value.size() > MAX_SIZE && value.is_valid() == false) { //unusual\n"
+										  u"\t\treturn static_cast<unsigned int>(value.size() + sizeof(T));\n\t}\n"
+										  u"\tfor (auto &&element : value) {\n\t\tthrow std::runtime_error{\"bad element\"};\n\t}\n\treturn 0u;\n}\n";
+
+static void test_mixed_rules() {
+	auto patterns = load_patterns();
+	assert_true(patterns.size() > 50u);
+	//rules a keyword table can't do, between the keywords so priorities matter
+	patterns.insert(std::begin(patterns) + 10, R"(\b[A-Z_][A-Z0-9_]+\b)");
+	patterns.insert(std::begin(patterns) + 20, R"(//.*)");
+	patterns.insert(std::begin(patterns) + 30, R"(\b\d+u?\b)");
+	patterns.push_back(R"("([^"\\]|\\.)*")");
+	Token_automaton automaton;
+	Highlighting_rules rules;
+	for (const auto &pattern : patterns) {
+		automaton.add_rule(pattern);
+		rules.add_rule(pattern);
+	}
+	assert_equal(rules.get_keyword_count(), patterns.size() - 4);
+	for (const auto line : get_lines(source_line)) {
+		std::string automaton_tokens;
+		automaton.find_tokens(line, [&](const Token_automaton::Token &token) {
+			automaton_tokens += std::to_string(token.rule) + ':' + std::to_string(token.begin) + ':' + std::to_string(token.length) + ' ';
+		});
+		std::string tokens;
+		rules.find_tokens(line, [&](const Highlighting_rules::Token &token) {
+			tokens += std::to_string(token.rule) + ':' + std::to_string(token.begin) + ':' + std::to_string(token.length) + ' ';
+		});
+		assert_equal(tokens, automaton_tokens);
+	}
+}
+
+static void benchmark_keyword_speed() {
+	const auto patterns = load_patterns();
+	std::u16string source;
+	while (source.size() < 4 * 1024 * 1024) {
+		source += source_line;
+	}
+	const auto lines = get_lines(source);
+	std::size_t automaton_token_count = 0;
+	std::size_t token_count = 0;
+	using seconds = std::chrono::duration<double>;
+
+	//loading includes tokenizing one line, the automaton builds its first states there
+	const auto automaton_start = std::chrono::steady_clock::now();
+	Token_automaton automaton;
+	for (const auto &pattern : patterns) {
+		automaton.add_rule(pattern);
+	}
+	automaton.find_tokens(lines.front(), [](const Token_automaton::Token &) {});
+	const auto automaton_loaded = std::chrono::steady_clock::now();
+	for (const auto line : lines) {
+		automaton.find_tokens(line, [&automaton_token_count](const Token_automaton::Token &) { automaton_token_count++; });
+	}
+	const auto automaton_done = std::chrono::steady_clock::now();
+
+	const auto rules_start = std::chrono::steady_clock::now();
+	Highlighting_rules rules;
+	for (const auto &pattern : patterns) {
+		rules.add_rule(pattern);
+	}
+	rules.find_tokens(lines.front(), [](const Highlighting_rules::Token &) {});
+	const auto rules_loaded = std::chrono::steady_clock::now();
+	for (const auto line : lines) {
+		rules.find_tokens(line, [&token_count](const Highlighting_rules::Token &) { token_count++; });
+	}
+	const auto rules_done = std::chrono::steady_clock::now();
+
+	assert_equal(token_count, automaton_token_count);
+	const auto size = source.size() * sizeof(char16_t);
+	std::cout << "Highlighting with " << rules.get_keyword_count() << " of " << rules.get_rule_count() << " rules as keywords: loading "
+			  << seconds{rules_loaded - rules_start}.count() * 1e3 << " ms, " << size / seconds{rules_done - rules_loaded}.count() / 1e6
+			  << " MB/s, all rules in the automaton: loading " << seconds{automaton_loaded - automaton_start}.count() * 1e3 << " ms, "
+			  << size / seconds{automaton_done - automaton_loaded}.count() / 1e6 << " MB/s\n";
+}
+
+static Highlighting_rules make_rules_to_save() { //all kinds of rules and regions
+	auto patterns = load_patterns();
+	patterns.push_back(R"(\b[A-Z_][A-Z0-9_]+\b)");
+	Highlighting_rules rules;
+	for (const auto &pattern : patterns) {
+		rules.add_rule(pattern);
+	}
+	rules.add_region(R"(/\*)", R"(\*/)");
+	rules.add_region(R"~(R"([^()\\\s]{0,16})\()~", R"~(\)\1")~");
+	rules.add_region(R"(^\s*#\s*if\s+0\b)", R"(^\s*#\s*(endif|else|elif)\b)", R"(^\s*#\s*if)", R"(^\s*#\s*endif\b)");
+	return rules;
+}
+
+static void test_saving() {
+	auto rules = make_rules_to_save();
+	Utility::Binary_writer writer;
+	rules.save(writer);
+	Utility::Binary_reader reader{writer.get_data()};
+	auto loaded_rules = Highlighting_rules::load(reader);
+	assert_true(reader.is_at_end());
+	assert_equal(loaded_rules.get_rule_count(), rules.get_rule_count());
+	assert_equal(loaded_rules.get_keyword_count(), rules.get_keyword_count());
+
+	std::u16string source = source_line + u"int /* a\nb */ R\"x(\n)\"\n)x\" MAX_SIZE\n#if 0\n#if X\n#endif\nint\n#endif\nint\n";
+	const auto lines = get_lines(source);
+	assert_equal(get_line_tokens(loaded_rules, lines), get_line_tokens(rules, lines));
+
+	//cut off data is an error, not rules that silently miss something
+	for (const auto size : {std::size_t{0}, writer.get_data().size() / 2, writer.get_data().size() - 1}) {
+		bool threw = false;
+		try {
+			Utility::Binary_reader cut_reader{std::string_view{writer.get_data()}.substr(0, size)};
+			Highlighting_rules::load(cut_reader);
+		} catch (const std::runtime_error &) {
+			threw = true;
+		}
+		assert_true(threw);
+	}
+}
+
+static void benchmark_saving() {
+	const auto start = std::chrono::steady_clock::now();
+	const auto rules = make_rules_to_save();
+	const auto compiled = std::chrono::steady_clock::now();
+	Utility::Binary_writer writer;
+	rules.save(writer);
+	const auto saved = std::chrono::steady_clock::now();
+	Utility::Binary_reader reader{writer.get_data()};
+	const auto loaded_rules = Highlighting_rules::load(reader);
+	const auto loaded = std::chrono::steady_clock::now();
+	assert_equal(loaded_rules.get_rule_count(), rules.get_rule_count());
+	using milliseconds = std::chrono::duration<double, std::milli>;
+	std::cout << "Compiling " << rules.get_rule_count() << " rules: " << milliseconds{compiled - start}.count() << " ms, saving "
+			  << milliseconds{saved - compiled}.count() << " ms, loading " << writer.get_data().size() << " bytes " << milliseconds{loaded - saved}.count()
+			  << " ms\n";
+}
+
+void test_highlighting_rules() {
+	test_keyword_table();
+	test_priorities();
+	test_regions();
+	test_mixed_rules();
+	test_saving();
+}
+
+void benchmark_highlighting_rules() {
+	benchmark_keyword_speed();
+	benchmark_saving();
+}
@@ -0,0 +1,7 @@
+#ifndef TEST_HIGHLIGHTING_RULES_H
+#define TEST_HIGHLIGHTING_RULES_H
+
+void test_highlighting_rules();
+void benchmark_highlighting_rules();
+
+#endif // TEST_HIGHLIGHTING_RULES_H
@@ -0,0 +1,141 @@
+#include "test_output_search.h"
+#include "logic/output_search.h"
+#include "test.h"
+
+#include <chrono>
+#include <iostream>
+#include <regex>
+#include <string>
+
+static void test_substrings() {
+	Output_search search;
+	const auto build = search.start_run("build");
+	const auto tests = search.start_run("tests");
+	search.append(build, "[ 10%] Building CXX object main.cpp.o\r\nmain.cpp:3:14: \033[31mer");
+	search.append(tests, "all tests passed\n");
+	search.append(build, "ror\033[0m: expected ';'\nunfinished");
+	assert_equal(search.get_line_count(), 3u);
+	const auto error = search.find("error: expected");
+	assert_equal(error.size(), 1u);
+	assert_equal(error[0].run, build);
+	assert_equal(error[0].line, 2u);
+	assert_equal(error[0].column, 15u);
+	assert_equal(error[0].text, "main.cpp:3:14: error: expected ';'");
+	assert_equal(search.find("main.cpp").size(), 2u);
+	assert_equal(search.find("cxx object").size(), 0u);
+	assert_equal(search.find("cxx object", Output_search::Case::insensitive).size(), 1u);
+	assert_equal(search.find("%]").size(), 1u); //too short for trigrams
+	assert_equal(search.find("unfinished").size(), 0u);
+	search.finish_run(build);
+	assert_equal(search.find("unfinished").size(), 1u);
+	assert_equal(search.get_run_name(search.find("passed")[0].run), "tests");
+}
+
+static void test_regex() {
+	Output_search search;
+	const auto run = search.start_run("build");
+	search.append(run, "a.cpp:1:2: warning: unused variable 'x'\nb.cpp:10:1: error: 'y' was not declared\nwarning: 3 warnings generated\n");
+	const auto warnings = search.find_regex(R"(\w+\.cpp:\d+:\d+: warning)");
+	assert_equal(warnings.size(), 1u);
+	assert_equal(warnings[0].line, 0u);
+	assert_equal(search.find_regex("(warning|error): '").size(), 1u);
+	assert_equal(search.find_regex("(warning|error): ").size(), 3u);
+	assert_equal(search.find_regex("ERROR", Output_search::Case::insensitive).size(), 1u);
+	assert_equal(search.find_regex("war(ning)?s? gen").size(), 1u);
+	assert_equal(search.find_regex("[0-9]{2}:1").size(), 1u);
+	bool threw = false;
+	try {
+		search.find_regex("(unbalanced");
+	} catch (const std::regex_error &) {
+		threw = true;
+	}
+	assert_true(threw);
+}
+
+static void test_dropping() {
+	Output_search search{Output_search::block_size * 4};
+	const auto run = search.start_run("spam");
+	for (int line = 0; line < 100'000; line++) {
+		search.append(run, "line " + std::to_string(line) + " of spam\n");
+	}
+	assert_true(search.get_size() <= Output_search::block_size * 4);
+	assert_equal(search.find("line 1234 of").size(), 0u);
+	const auto last = search.find("line 99999 of");
+	assert_equal(last.size(), 1u);
+	assert_equal(last[0].line, 99'999u);
+	assert_equal(search.find("of spam", Output_search::Case::sensitive, 10).size(), 10u);
+}
+
+static void test_long_lines() { //progress bars only print carriage returns
+	Output_search search;
+	const auto run = search.start_run("progress");
+	for (int percent = 0; percent < 100'000; percent++) {
+		search.append(run, "\rprogress " + std::to_string(percent));
+	}
+	search.append(run, " done\n" + std::string(Output_search::max_line_size * 2, 'x') + "\nlast\n");
+	assert_equal(search.get_line_count(), 3u);
+	assert_true(search.get_size() <= 3 * (Output_search::max_line_size + 1));
+	assert_equal(search.find("progress 0").size(), 1u);
+	assert_equal(search.find("done").size(), 0u); //cut off
+	assert_equal(search.find("xxx")[0].text.size(), Output_search::max_line_size);
+	assert_equal(search.find("last").size(), 1u);
+}
+
+static void test_dropping_runs() {
+	Output_search search{Output_search::block_size * 4};
+	const auto first = search.start_run("first");
+	search.append(first, "first run\n");
+	search.finish_run(first);
+	const auto empty = search.start_run("empty");
+	search.finish_run(empty);
+	assert_equal(search.get_run_count(), 2u);
+	const auto spam = search.start_run("spam");
+	for (int line = 0; line < 100'000; line++) {
+		search.append(spam, "line " + std::to_string(line) + " of spam\n");
+	}
+	//the lines of the finished runs are gone, so are they
+	assert_equal(search.get_run_count(), 1u);
+	assert_equal(search.get_run_name(search.find("line 99999 of")[0].run), "spam");
+	const auto next = search.start_run("next");
+	search.append(next, "next run\n");
+	assert_equal(search.get_run_name(search.find("next run")[0].run), "next");
+	search.finish_run(spam);
+	assert_equal(search.get_run_count(), 2u);
+}
+
+static void benchmark_query_speed() {
+	Output_search search;
+	const auto run = search.start_run("build");
+	const auto start = std::chrono::steady_clock::now();
+	constexpr int line_count = 200'000;
+	for (int line = 0; line < line_count; line++) {
+		auto text = "[" + std::to_string(line * 100 / line_count) + "%] Building CXX object src/module" + std::to_string(line % 997) + "/file" +
+					std::to_string(line) + ".cpp.o\n";
+		if (line % 50'000 == 12'345) {
+			text += "src/file" + std::to_string(line) + ".cpp:42:7: error: use of undeclared identifier 'frobnicate'\n";
+		}
+		search.append(run, text);
+	}
+	const auto indexed = std::chrono::steady_clock::now();
+	const auto matches = search.find("undeclared identifier 'frobnicate'");
+	const auto found = std::chrono::steady_clock::now();
+	const auto regex_matches = search.find_regex(R"(file\d+\.cpp:\d+:\d+: error)");
+	const auto found_regex = std::chrono::steady_clock::now();
+	assert_equal(matches.size(), 4u);
+	assert_equal(regex_matches.size(), 4u);
+	using ms = std::chrono::duration<double, std::milli>;
+	std::cout << "Output search: indexed " << line_count << " lines (" << search.get_size() / 1024 / 1024 << " MiB) in " << ms{indexed - start}.count()
+			  << " ms, substring query " << ms{found - indexed}.count() << " ms, regex query " << ms{found_regex - found}.count() << " ms\n";
+}
+
+void test_output_search() {
+	test_substrings();
+	test_regex();
+	test_dropping();
+	test_long_lines();
+	test_dropping_runs();
+}
+
+void benchmark_output_search() {
+	benchmark_query_speed();
+}
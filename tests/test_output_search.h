@@ -0,0 +1,7 @@
+#ifndef TEST_OUTPUT_SEARCH_H
+#define TEST_OUTPUT_SEARCH_H
+
+void test_output_search();
+void benchmark_output_search();
+
+#endif // TEST_OUTPUT_SEARCH_H
@@ -1,13 +1,31 @@
 #include "test_process_reader.h"
 #include "logic/process_reader.h"
 #include "logic/settings.h"
+#include "logic/spill_file.h"
+#include "logic/tool_statistics.h"
 #include "test.h"
 #include "ui/mainwindow.h"
 
+#include <QApplication>
+#include <QPlainTextEdit>
 #include <QProcess>
 #include <QString>
 #include <QStringList>
+#include <algorithm>
+#include <chrono>
 #include <fstream>
+#include <memory>
+#include <numeric>
+#include <string>
+#include <thread>
+#include <vector>
+
+#if __linux
+#include "logic/pipe.h"
+#include "logic/spawn.h"
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
 
 static void test_args_construction() {
 	struct Test_cases {
@@ -139,11 +157,386 @@ int main() {
 	assert_executed_correctly(code, expected_output);
 }
 
+static void test_kill() {
+	Tool tool{};
+	tool.path = "sleep";
+	tool.arguments = "60";
+	Process_reader p{tool};
+	const auto start = std::chrono::steady_clock::now();
+	p.kill();
+	p.join();
+	assert_equal(p.get_state(), Process_reader::State::killed);
+	assert_true(std::chrono::steady_clock::now() - start < std::chrono::seconds{10});
+}
+
+#if __linux
+static bool is_alive(pid_t pid) { //zombies do not count
+	std::ifstream stat{"/proc/" + std::to_string(pid) + "/stat"};
+	std::string line;
+	if (!std::getline(stat, line)) {
+		return false;
+	}
+	const auto state_position = line.rfind(')') + 2;
+	return state_position < line.size() && line[state_position] != 'Z';
+}
+
+static void test_timeout() { //a tool ignoring SIGTERM and its children must be killed after the grace period
+	if constexpr (using_tty == false) {
+		return;
+	}
+	Tool tool{};
+	tool.path = "sh";
+	tool.arguments = R"(-c "trap '' TERM; sleep 60 & echo $!; wait")";
+	tool.timeout = std::chrono::milliseconds{100};
+	std::string output;
+	std::string error;
+	Process_reader p{tool, [&output](std::string_view sv) { output += sv; }, [&error](std::string_view sv) { error += sv; }};
+	const auto start = std::chrono::steady_clock::now();
+	p.join();
+	const auto duration = std::chrono::steady_clock::now() - start;
+	assert_equal(p.get_state(), Process_reader::State::killed);
+	assert_true(duration >= Process_reader::kill_grace_period);
+	assert_true(duration < 2 * Process_reader::kill_grace_period);
+	assert_true(error.find("timed out") != std::string::npos);
+	const auto grandchild = std::stoi(output);
+	assert_true(grandchild > 0);
+	for (int i = 0; i < 100 && is_alive(grandchild); i++) { //it is reaped by init, which may take a moment
+		std::this_thread::sleep_for(std::chrono::milliseconds{10});
+	}
+	assert_true(is_alive(grandchild) == false);
+	assert_equal(waitpid(-1, nullptr, WNOHANG), -1); //no zombies left
+	assert_equal(errno, ECHILD);
+}
+
+static void test_destroy_while_running() { //shutting down kills the tools without waiting for them or calling back into the GUI
+	Tool tool{};
+	tool.path = "sh";
+	tool.arguments = R"(-c "echo $$; exec sleep 60")";
+	std::string output;
+	bool completed = false;
+	auto p = std::make_unique<Process_reader>(tool, [&output](std::string_view sv) { output += sv; }, [](std::string_view) {},
+											  [&completed](Process_reader::State) { completed = true; });
+	const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds{10};
+	while (output.find('\n') == std::string::npos && std::chrono::steady_clock::now() < deadline) {
+		QApplication::processEvents(QEventLoop::WaitForMoreEvents, 10);
+	}
+	const auto pid = std::stoi(output);
+	assert_true(pid > 0);
+	const auto start = std::chrono::steady_clock::now();
+	p.reset();
+	assert_true(std::chrono::steady_clock::now() - start < Process_reader::kill_grace_period);
+	for (int i = 0; i < 100 && is_alive(pid); i++) {
+		QApplication::processEvents();
+		std::this_thread::sleep_for(std::chrono::milliseconds{10});
+	}
+	assert_true(is_alive(pid) == false);
+	QApplication::processEvents();
+	assert_true(completed == false);
+}
+#endif
+
+static void test_run_statistics() {
+	Tool_statistics::clear();
+	Tool tool{};
+	tool.path = "cat";
+	tool.input = "12345";
+	Process_reader p{tool};
+	p.join();
+	const auto &statistics = p.get_run_statistics();
+	assert_equal(statistics.bytes_written, 5u);
+	assert_true(statistics.output_bytes_read >= 5u);
+	assert_true(statistics.time_to_first_output.has_value());
+	assert_true(statistics.wall_time >= *statistics.time_to_first_output);
+	if constexpr (using_tty) {
+		assert_true(statistics.max_rss_kib > 0);
+	}
+	assert_equal(Tool_statistics::get_history(tool).size(), 1u);
+
+	//percentiles of the rolling history use the nearest rank
+	Tool_statistics::clear();
+	for (int i = 1; i <= 200; i++) {
+		Process_reader::Run_statistics run{};
+		run.wall_time = std::chrono::microseconds{i};
+		Tool_statistics::add(tool, run);
+	}
+	const auto summary = Tool_statistics::get_summary(tool);
+	assert_equal(summary.runs, Tool_statistics::history_size);
+	assert_equal(summary.wall_time.median.count(), 150);
+	assert_equal(summary.wall_time.p90.count(), 190);
+	assert_equal(summary.wall_time.p99.count(), 199);
+	assert_equal(summary.wall_time.max.count(), 200);
+	assert_equal(summary.time_to_first_output.max.count(), 0); //no run printed anything
+	Tool_statistics::clear();
+}
+
+static void test_spill_file() { //output spilled while the GUI is behind must come back in order, including the interleaving of output and error
+	Spill_file spill_file;
+	assert_true(spill_file.is_empty());
+	const std::pair<Output_channel::Stream, std::string> records[] = {
+		{Output_channel::Stream::output, "out1"},
+		{Output_channel::Stream::error, "err1"},
+		{Output_channel::Stream::output, std::string(1 << 20, 'o')},
+	};
+	for (int round = 0; round < 2; round++) { //the file is reused after it was read empty
+		for (const auto &record : records) {
+			spill_file.write(record.first, record.second);
+		}
+		Output_channel::Stream stream;
+		std::string data;
+		for (const auto &record : records) {
+			assert_true(spill_file.read(stream, data));
+			assert_true(stream == record.first);
+			assert_equal(data, record.second);
+		}
+		assert_true(spill_file.is_empty());
+		assert_true(spill_file.read(stream, data) == false);
+	}
+}
+
+static void test_input_producer() {
+	const std::vector<QString> segments = {"plain ", QString::fromUtf8("h\u00e4 \u20ac \U0001D11E"), "", QString::fromUtf8("\U0001D11E\U0001D11E")};
+	const auto expected = std::accumulate(std::begin(segments), std::end(segments), QString{}).toStdString();
+	for (std::size_t chunk_size = 1; chunk_size < 8; chunk_size++) { //chunks must not split surrogate pairs
+		Input_producer input{segments, chunk_size};
+		std::string produced;
+		for (auto chunk = input.next_chunk(); chunk.empty() == false; chunk = input.next_chunk()) {
+			produced += chunk;
+		}
+		assert_equal(produced, expected);
+	}
+	assert_true(Input_producer{{QString{}, QString{}}}.is_empty());
+}
+
+static void test_streaming_input() { //input larger than any pipe buffer is written as the tool reads it
+	Tool tool{};
+	tool.path = "wc";
+	tool.arguments = "-c";
+	tool.input = QString(8 << 20, 'x');
+	std::string output;
+	Process_reader p{tool, [&output](std::string_view sv) { output += sv; }};
+	p.join();
+	assert_equal(strip_carriage_return(output), std::to_string(8 << 20) + "\n");
+}
+
+static int get_thread_count() {
+	std::ifstream status{"/proc/self/status"};
+	std::string line;
+	while (std::getline(status, line)) {
+		if (line.compare(0, 8, "Threads:") == 0) {
+			return std::stoi(line.substr(8));
+		}
+	}
+	return 0;
+}
+
+static void test_concurrent_processes() { //all tools share one reactor thread, so running many of them at once must not start more threads
+	if constexpr (using_tty == false) {
+		return;
+	}
+	constexpr auto process_count = 64;
+	const auto thread_count = get_thread_count();
+	std::vector<std::string> outputs(process_count);
+	std::vector<std::unique_ptr<Process_reader>> process_readers;
+	for (int i = 0; i < process_count; i++) {
+		Tool tool{};
+		tool.path = "echo";
+		tool.arguments = QString::number(i);
+		process_readers.push_back(std::make_unique<Process_reader>(tool, [&output = outputs[i]](std::string_view sv) { output += sv; }));
+	}
+	assert_true(get_thread_count() <= thread_count);
+	for (int i = 0; i < process_count; i++) {
+		process_readers[i]->join();
+		assert_equal(strip_carriage_return(outputs[i]), std::to_string(i) + "\n");
+	}
+}
+
+#if __linux
+static Output_channel::Statistics read_lines(int line_count) { //a tool printing a line at a time must not cause an event per line or unbounded buffering
+	Tool tool{};
+	tool.path = "seq";
+	tool.arguments = QString::number(line_count);
+	std::string output;
+	Process_reader p{tool, [&output](std::string_view sv) { output += sv; }};
+	p.join();
+	std::string expected_output;
+	for (int i = 1; i <= line_count; i++) {
+		expected_output += std::to_string(i) + '\n';
+	}
+	assert_equal(strip_carriage_return(output), expected_output);
+	const auto statistics = p.get_output_statistics();
+	assert_equal(statistics.queued_bytes, 0u);
+	assert_true(statistics.wakeups < static_cast<std::size_t>(line_count / 10));
+	assert_true(statistics.max_queued_bytes <= Output_channel::default_byte_budget + Pipe::default_chunk_size * Pipe::bulk_chunks);
+	return statistics;
+}
+
+static void test_output_coalescing() {
+	read_lines(20'000);
+}
+
+static void benchmark_output_coalescing() {
+	const auto statistics = read_lines(200'000);
+	std::cout << "Output channel: " << statistics.pushes << " pushes, " << statistics.wakeups << " wakeups, " << statistics.pauses << " pauses, max "
+			  << statistics.max_queued_bytes << " bytes queued, max latency " << statistics.max_latency.count() << "us\n";
+}
+
+template <class Read_function>
+static double measure_pipe_throughput(Read_function &&read_function) { //returns MB/s of reading a fast writer with read_function
+	constexpr std::size_t total_size = std::size_t{32} << 20;
+	const std::string block(64 * 1024, 'x');
+	Pipe pipe;
+	std::thread writer{[&pipe, &block] {
+		for (std::size_t written = 0; written < total_size; written += block.size()) {
+			pipe.write_all(block);
+		}
+		pipe.close_write_channel();
+	}};
+	std::size_t bytes_read = 0;
+	const auto start = std::chrono::steady_clock::now();
+	read_function(pipe, [&bytes_read](std::string_view data) { bytes_read += data.size(); });
+	const auto end = std::chrono::steady_clock::now();
+	writer.join();
+	assert_equal(bytes_read, total_size);
+	return total_size / std::chrono::duration<double>(end - start).count() / 1e6;
+}
+
+static void benchmark_pipe_read_throughput() {
+	const auto allocating_read = [](Pipe &pipe, auto &&callback) { //how Pipe::read used to work
+		for (;;) {
+			char buffer[1024];
+			const auto bytes_read = ::read(pipe.get_read_channel(), buffer, sizeof buffer);
+			if (bytes_read <= 0) {
+				return;
+			}
+			const std::string chunk{buffer, buffer + bytes_read};
+			callback(chunk);
+		}
+	};
+	const auto ring_buffer_read = [](Pipe::Read_mode mode) {
+		return [mode](Pipe &pipe, auto &&callback) {
+			pipe.set_read_mode(mode);
+			while (pipe.get_read_channel() != -1) { //the writer thread owns the write channel
+				pipe.read(callback);
+			}
+		};
+	};
+	const auto allocating = measure_pipe_throughput(allocating_read);
+	const auto chunked = measure_pipe_throughput(ring_buffer_read(Pipe::Read_mode::chunked));
+	const auto adaptive = measure_pipe_throughput(ring_buffer_read(Pipe::Read_mode::adaptive));
+	std::cout << "Pipe read throughput: allocating " << allocating << " MB/s, chunked " << chunked << " MB/s, adaptive " << adaptive << " MB/s\n";
+}
+
+static double measure_rendering(const std::string &output, bool per_segment) { //returns lines per second of rendering colored output
+	QPlainTextEdit edit;
+	Ansi_code_handling::Text_state state;
+	struct : Ansi_parser::Default_handler { //how Ansi_code_handling::set_text used to insert text, one layout per segment
+		void on_text(std::string_view text) {
+			edit->textCursor().insertText(QString::fromUtf8(text.data(), text.size()));
+		}
+		void on_control_sequence(std::string_view parameters, char) {
+			attributes.apply(parameters);
+			auto cursor = edit->textCursor();
+			QTextCharFormat format = cursor.charFormat();
+			format.setFontWeight(attributes.has(Sgr_attributes::bold) ? QFont::Bold : QFont::Normal);
+			format.setForeground(QColor::fromRgb(attributes.foreground.get_rgb().value_or(0)));
+			cursor.setCharFormat(format);
+			edit->setTextCursor(cursor);
+		}
+		QPlainTextEdit *edit;
+		Sgr_attributes attributes;
+	} old_handler;
+	old_handler.edit = &edit;
+	const auto start = std::chrono::steady_clock::now();
+	for (std::size_t position = 0; position < output.size(); position += 4096) { //arrives in chunks like tool output does
+		const auto chunk = std::string_view{output}.substr(position, 4096);
+		if (per_segment) {
+			state.parser.feed(chunk, old_handler);
+		} else {
+			Ansi_code_handling::set_text(&edit, chunk, state);
+		}
+	}
+	const auto line_count = std::count(std::begin(output), std::end(output), '\n');
+	assert_equal(edit.document()->blockCount(), line_count + 1);
+	return line_count / std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+static void benchmark_rendering_throughput() { //colored output of a big build took seconds to show up
+	std::string output;
+	for (int line = 0; line < 100'000; line++) {
+		output += "\033[1msrc/file" + std::to_string(line % 100) + ".cpp:" + std::to_string(line) +
+				  ":5: \033[31merror: \033[0mexpected ';' after expression \033[1m[-Wsomething]\033[0m\n";
+	}
+	const auto old_output = output.substr(0, output.find('\n', output.size() / 10) + 1); //the old way is too slow to wait for all lines
+	const auto per_segment = measure_rendering(old_output, true);
+	const auto batched = measure_rendering(output, false);
+	std::cout << "Rendering colored output: per segment " << per_segment << " lines/s, batched " << batched << " lines/s\n";
+}
+
+template <class Launch_function>
+static double measure_spawn_latency(Launch_function &&launch_function) { //returns microseconds per start and exit of a trivial program
+	constexpr int launch_count = 50;
+	const auto start = std::chrono::steady_clock::now();
+	for (int i = 0; i < launch_count; i++) {
+		const pid_t pid = launch_function();
+		assert_true(pid > 0);
+		int status;
+		assert_equal(waitpid(pid, &status, 0), pid);
+		assert_true(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+	}
+	return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count() / launch_count;
+}
+
+static void benchmark_spawn_latency() { //fork copies the page tables of the parent, so starting a tool got slower the more memory the editor used
+	std::vector<char> resident_memory(std::size_t{256} << 20);
+	for (std::size_t i = 0; i < resident_memory.size(); i += 4096) { //make the memory resident
+		resident_memory[i] = 1;
+	}
+	const auto fork_exec = [] { //how Process_reader used to start tools
+		const pid_t pid = fork();
+		if (pid == 0) {
+			char *arguments[] = {const_cast<char *>("true"), nullptr};
+			execvp(arguments[0], arguments);
+			_exit(-1);
+		}
+		return pid;
+	};
+	const Spawn_request spawn_request{"true", {"true"}};
+	const auto spawn = [&spawn_request] { return spawn_request.spawn(STDIN_FILENO, STDOUT_FILENO, STDERR_FILENO); };
+	const auto fork_latency = measure_spawn_latency(fork_exec);
+	const auto spawn_latency = measure_spawn_latency(spawn);
+	std::cout << "Spawn latency with " << (resident_memory.size() >> 20) << " MiB resident: fork " << fork_latency << "us, posix_spawn " << spawn_latency
+			  << "us\n";
+}
+#endif
+
 void test_process_reader() {
 	MainWindow mw; //required for MainWindow::get_main_window which is required for Utility::gui_call
 	test_args_construction();
 	test_process_reading();
 	test_is_tty();
 	test_is_character_device();
+	test_kill();
+#if __linux
+	test_timeout();
+	test_destroy_while_running();
+#endif
+	test_run_statistics();
+	test_spill_file();
+	test_input_producer();
+	test_streaming_input();
+	test_concurrent_processes();
+#if __linux
+	test_output_coalescing();
+#endif
 	std::cout << "Using tty: " << (using_tty ? "true" : "false") << '\n';
 }
+
+void benchmark_process_reader() {
+	MainWindow mw; //required for Utility::gui_call
+	benchmark_rendering_throughput();
+#if __linux
+	benchmark_output_coalescing();
+	benchmark_pipe_read_throughput();
+	benchmark_spawn_latency();
+#endif
+}
@@ -2,5 +2,6 @@
 #define TEST_PROCESS_READER_H
 
 void test_process_reader();
+void benchmark_process_reader();
 
 #endif // TEST_PROCESS_READER_H
\ No newline at end of file
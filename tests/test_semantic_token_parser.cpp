@@ -0,0 +1,47 @@
+#include "test_semantic_token_parser.h"
+#include "logic/semantic_token_parser.h"
+#include "test.h"
+
+#include <string>
+#include <vector>
+
+static std::string to_string(const Semantic_token_parser::Delta &delta) {
+	std::string text = (delta.version ? 'v' + std::to_string(*delta.version) + ' ' : std::string{}) + '@' + std::to_string(delta.first_line);
+	for (const auto &line : delta.lines) {
+		text += " |";
+		for (const auto &run : line) {
+			text += ' ' + std::to_string(run.gap) + ',' + std::to_string(run.length) + ',' + std::to_string(run.type);
+		}
+	}
+	return text;
+}
+
+static std::vector<std::string> parse(const std::vector<std::string_view> &chunks) {
+	std::vector<std::string> deltas;
+	Semantic_token_parser parser;
+	const auto collect = [&deltas](Semantic_token_parser::Delta delta) { deltas.push_back(to_string(delta)); };
+	for (const auto chunk : chunks) {
+		parser.feed(chunk, collect);
+	}
+	parser.finish(collect);
+	return deltas;
+}
+
+static void test_deltas() {
+	assert_equal(parse({"lines 3 2\n4 3 1 2 5 0\n\n"}), std::vector<std::string>{"@3 | 4,3,1 2,5,0 |"});
+	//chunks can end anywhere
+	assert_equal(parse({"vers", "ion 7\nlines 0 1\r\n0 3", " 2\r", "\nlines 5 1\n1 1 1"}), std::vector<std::string>{"v7 @0 | 0,3,2", "v7 @5 | 1,1,1"});
+	//clearing lines
+	assert_equal(parse({"lines 4 0\nlines 1 2\n\n\n"}), std::vector<std::string>{"@4", "@1 | |"});
+	//messages of the tool are ignored, malformed deltas are dropped as a whole
+	assert_equal(parse({"indexing...\nlines 0 2\n1 2\n0 1 0\nlines 9 1\n0 1 1\n"}), std::vector<std::string>{"@9 | 0,1,1"});
+	assert_equal(parse({"lines 0 1\n1 x 2\nversion 99999999999999999999\nlines 2 1\n1 2 3\n"}), std::vector<std::string>{"@2 | 1,2,3"});
+	assert_equal(parse({"lines 0 1\n1 2 3"}), std::vector<std::string>{"@0 | 1,2,3"});
+	assert_equal(parse({"lines 0 2\n1 2 3\n"}), std::vector<std::string>{}); //incomplete
+	assert_equal(parse({"lines 0 1\n", std::string(Semantic_token_parser::max_line_size + 1, '1'), "\nlines 1 1\n0 1 2\n"}),
+				 std::vector<std::string>{"@1 | 0,1,2"});
+}
+
+void test_semantic_token_parser() {
+	test_deltas();
+}
@@ -0,0 +1,6 @@
+#ifndef TEST_SEMANTIC_TOKEN_PARSER_H
+#define TEST_SEMANTIC_TOKEN_PARSER_H
+
+void test_semantic_token_parser();
+
+#endif // TEST_SEMANTIC_TOKEN_PARSER_H
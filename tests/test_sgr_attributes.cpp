@@ -0,0 +1,57 @@
+#include "test_sgr_attributes.h"
+#include "logic/sgr_attributes.h"
+#include "test.h"
+
+static Sgr_attributes apply(std::string_view parameters, Sgr_attributes attributes = {}) {
+	attributes.apply(parameters);
+	return attributes;
+}
+
+static void test_flags() {
+	const auto attributes = apply("1;3;4;9;53");
+	assert_true(attributes.has(Sgr_attributes::bold));
+	assert_true(attributes.has(Sgr_attributes::italic));
+	assert_true(attributes.has(Sgr_attributes::underline));
+	assert_true(attributes.has(Sgr_attributes::crossed_out));
+	assert_true(attributes.has(Sgr_attributes::overline));
+	assert_equal(apply("22;23;24;29;55", attributes).flags, 0);
+	assert_equal(apply("2", attributes).flags & (Sgr_attributes::bold | Sgr_attributes::faint), Sgr_attributes::faint);
+	assert_true(apply("0", attributes) == Sgr_attributes{});
+	assert_true(apply("", attributes) == Sgr_attributes{}); //CSI m is the same as CSI 0 m
+	assert_true(apply("?1", attributes) == attributes);     //private sequences are not SGR
+}
+
+static void test_colors() {
+	assert_true(apply("31").foreground == Sgr_color::from_index(1));
+	assert_true(apply("42").background == Sgr_color::from_index(2));
+	assert_true(apply("97").foreground == Sgr_color::from_index(15));
+	assert_true(apply("100").background == Sgr_color::from_index(8));
+	assert_true(apply("38;5;196").foreground == Sgr_color::from_index(196));
+	assert_true(apply("48;2;1;2;3").background == Sgr_color::from_rgb(1, 2, 3));
+	assert_true(apply("31;39").foreground == Sgr_color{});
+	assert_true(apply("41;49").background == Sgr_color{});
+	const auto attributes = apply("38;2;10;20;30;1;48;5;21");
+	assert_true(attributes.foreground == Sgr_color::from_rgb(10, 20, 30));
+	assert_true(attributes.background == Sgr_color::from_index(21));
+	assert_true(attributes.has(Sgr_attributes::bold));
+	//broken extended colors keep the previous color
+	assert_true(apply("38;5;256", attributes).foreground == attributes.foreground);
+	assert_true(apply("38;2;1;2", attributes).foreground == attributes.foreground);
+}
+
+static void test_palette() {
+	assert_equal(Sgr_color::from_index(1).get_rgb().value(), 0xcd0000u);
+	assert_equal(Sgr_color::from_index(16).get_rgb().value(), 0x000000u);
+	assert_equal(Sgr_color::from_index(196).get_rgb().value(), 0xff0000u);
+	assert_equal(Sgr_color::from_index(231).get_rgb().value(), 0xffffffu);
+	assert_equal(Sgr_color::from_index(232).get_rgb().value(), 0x080808u);
+	assert_equal(Sgr_color::from_index(255).get_rgb().value(), 0xeeeeeeu);
+	assert_equal(Sgr_color::from_rgb(0x12, 0x34, 0x56).get_rgb().value(), 0x123456u);
+	assert_true(Sgr_color{}.get_rgb().has_value() == false);
+}
+
+void test_sgr_attributes() {
+	test_flags();
+	test_colors();
+	test_palette();
+}
@@ -0,0 +1,6 @@
+#ifndef TEST_SGR_ATTRIBUTES_H
+#define TEST_SGR_ATTRIBUTES_H
+
+void test_sgr_attributes();
+
+#endif // TEST_SGR_ATTRIBUTES_H
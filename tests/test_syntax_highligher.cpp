@@ -0,0 +1,190 @@
+#include "test_syntax_highligher.h"
+#include "logic/syntax_highligher.h"
+#include "test.h"
+
+#include <QColor>
+#include <QCoreApplication>
+#include <QEventLoop>
+#include <QPlainTextDocumentLayout>
+#include <QTextBlock>
+#include <QTextCursor>
+#include <QTextDocument>
+#include <QTextLayout>
+#include <cstdint>
+#include <string>
+
+struct Counting_highlighter : Syntax_highligher {
+	using Syntax_highligher::Syntax_highligher;
+	void highlightBlock(const QString &text) override {
+		highlighted_blocks++;
+		Syntax_highligher::highlightBlock(text);
+	}
+	int highlighted_blocks = 0;
+};
+
+//a document without a layout doesn't emit contentsChange and its edits aren't highlighted, so it gets the layout of a QPlainTextEdit
+struct Laid_out_document : QTextDocument {
+	Laid_out_document() {
+		setDocumentLayout(new QPlainTextDocumentLayout{this});
+	}
+};
+
+static void wait_for_background(Syntax_highligher &highlighter) {
+	while (highlighter.has_pending_blocks()) {
+		QCoreApplication::processEvents(QEventLoop::WaitForMoreEvents);
+	}
+}
+
+static std::string get_foreground(const QTextDocument &document, int line, int column) {
+	for (const auto &range : document.findBlockByNumber(line).layout()->formats()) {
+		if (range.start <= column && column < range.start + range.length) {
+			return range.format.foreground().color().name().toStdString();
+		}
+	}
+	return {};
+}
+
+static void test_incremental_highlighting() {
+	constexpr int line_count = 50'000;
+	QString text;
+	for (int line = 0; line < line_count; line++) {
+		text += QString{"int x%1 = %1; //line %1\n"}.arg(line);
+	}
+	Laid_out_document document;
+	document.setPlainText(text);
+	Counting_highlighter highlighter{&document};
+	highlighter.load_rules(TEST_DATA_PATH "c++-syntax.json");
+	QCoreApplication::processEvents(); //the first highlighting of the whole document is delayed
+	highlighter.rehighlight();
+	wait_for_background(highlighter);
+	assert_true(highlighter.highlighted_blocks >= document.blockCount());
+
+	const auto edit = [&](int line, int column, const QString &inserted, int removed_size) {
+		QCoreApplication::processEvents(); //a new turn of the event loop, as for every key press
+		highlighter.highlighted_blocks = 0;
+		QTextCursor cursor{document.findBlockByNumber(line)};
+		cursor.movePosition(QTextCursor::Right, QTextCursor::MoveAnchor, column);
+		cursor.movePosition(QTextCursor::Right, QTextCursor::KeepAnchor, removed_size);
+		cursor.insertText(inserted);
+		return highlighter.highlighted_blocks;
+	};
+	//typing only highlights the edited line
+	assert_equal(edit(10, 3, "x", 0), 1);
+	assert_equal(edit(10, 3, "", 1), 1);
+	assert_equal(edit(line_count - 1, 0, "y", 0), 1);
+	//a comment that is closed a few lines later highlights the lines up to the one where it ends
+	assert_equal(edit(20, 0, "*/", 0), 1);
+	assert_equal(edit(10, 0, "/*", 0), 11);
+	assert_equal(document.findBlockByNumber(15).userState(), document.findBlockByNumber(19).userState());
+	assert_equal(document.findBlockByNumber(20).userState(), Highlighting_rules::no_region);
+	//typing inside of the comment keeps the state of the lines after it
+	assert_equal(edit(15, 0, "int", 0), 1);
+	assert_equal(edit(10, 0, "", 2), 11);
+	assert_equal(document.findBlockByNumber(15).userState(), Highlighting_rules::no_region);
+	//splitting and joining lines highlights both halves
+	assert_equal(edit(30, 4, "\n", 0), 2);
+	assert_equal(edit(30, 4, "", 1), 1);
+}
+
+static void test_background_highlighting() {
+	constexpr int line_count = 200'000;
+	QString text = "/*\n";
+	for (int line = 1; line < line_count; line++) {
+		text += QString{"int x%1 = %1;\n"}.arg(line);
+	}
+	text += "*/";
+	Laid_out_document document;
+	document.setPlainText(text);
+	Syntax_highligher highlighter{&document};
+	highlighter.load_rules(TEST_DATA_PATH "c++-syntax.json");
+	highlighter.set_viewport(150'000, 50);
+	highlighter.rehighlight(); //only tokenizes the first blocks
+	assert_equal(document.firstBlock().userState(), document.findBlockByNumber(Syntax_highligher::max_synchronous_blocks - 1).userState());
+	assert_equal(document.findBlockByNumber(Syntax_highligher::max_synchronous_blocks).userState(), Syntax_highligher::pending_state);
+	assert_true(highlighter.has_pending_blocks());
+
+	//the document can be edited while the rest is tokenized
+	QTextCursor cursor{document.findBlockByNumber(10)};
+	cursor.insertText("x");
+	//the viewport gets a job of its own before the slices in front of it are tokenized
+	while (document.findBlockByNumber(150'000).layout()->formats().empty() && highlighter.has_pending_blocks()) {
+		QCoreApplication::processEvents(QEventLoop::WaitForMoreEvents);
+	}
+	assert_equal(document.findBlockByNumber(100'000).userState(), Syntax_highligher::pending_state);
+	wait_for_background(highlighter);
+	const auto comment_state = document.firstBlock().userState();
+	assert_true(comment_state >= 0);
+	for (auto block = document.firstBlock(); block != document.lastBlock(); block = block.next()) {
+		assert_equal(block.userState(), comment_state);
+	}
+	assert_equal(document.lastBlock().userState(), Highlighting_rules::no_region);
+	//a block that was only tokenized in the background has its formats
+	const auto formats = document.findBlockByNumber(150'000).layout()->formats();
+	assert_equal(formats.size(), 1);
+	assert_equal(formats.front().length, document.findBlockByNumber(150'000).length() - 1);
+}
+
+static void test_semantic_tokens() {
+	Laid_out_document document;
+	document.setPlainText("std::string name;\nint x = name.size();\nint y;");
+	Counting_highlighter highlighter{&document};
+	highlighter.load_rules(TEST_DATA_PATH "c++-syntax.json");
+	QCoreApplication::processEvents();
+	const auto get_color = [&document](int line, int column) { return get_foreground(document, line, column); };
+	assert_equal(get_color(1, 0), "#7f7f00"); //int is a keyword
+	assert_equal(get_color(1, 8), "");
+
+	//std is a namespace, string a type and name a variable
+	auto version = static_cast<std::uint64_t>(document.revision());
+	highlighter.highlighted_blocks = 0;
+	assert_true(highlighter.apply_semantic_tokens(version, 0, {{{0, 3, 0}, {2, 6, 1}}, {{8, 4, 7}}}));
+	assert_equal(highlighter.highlighted_blocks, 2);
+	assert_equal(get_color(0, 0), "#00007f");
+	assert_equal(get_color(0, 5), "#00007f");
+	assert_equal(get_color(0, 12), "");
+	assert_equal(get_color(1, 0), "#7f7f00");
+	assert_equal(get_color(1, 8), "#5f005f");
+	//only lines whose tokens changed are highlighted again
+	highlighter.highlighted_blocks = 0;
+	assert_true(highlighter.apply_semantic_tokens(version, 0, {{{0, 3, 0}, {2, 6, 1}}, {}, {}}));
+	assert_equal(highlighter.highlighted_blocks, 1);
+	assert_equal(get_color(1, 8), "");
+
+	//tokens for an older version of the document are dropped, an edited line drops its tokens
+	QTextCursor cursor{document.firstBlock()};
+	cursor.insertText(" ");
+	highlighter.highlighted_blocks = 0;
+	assert_equal(highlighter.apply_semantic_tokens(version, 2, {{{4, 1, 7}}}), false);
+	assert_equal(highlighter.highlighted_blocks, 0);
+	assert_equal(get_color(0, 1), "");
+	assert_equal(get_color(2, 4), "");
+	version = static_cast<std::uint64_t>(document.revision());
+	assert_true(highlighter.apply_semantic_tokens(version, 2, {{{4, 1, 7}}}));
+	assert_equal(get_color(2, 4), "#5f005f");
+}
+
+static void test_themes() {
+	Laid_out_document document;
+	document.setPlainText("int x; /*comment*/");
+	Counting_highlighter highlighter{&document};
+	highlighter.load_rules(TEST_DATA_PATH "c++-syntax.json");
+	QCoreApplication::processEvents();
+	assert_equal(get_foreground(document, 0, 0), "#7f7f00");
+	assert_equal(get_foreground(document, 0, 8), "#007f00");
+
+	highlighter.highlighted_blocks = 0;
+	highlighter.set_theme({{"keyword", QColor{0, 0, 255}}, {"comment", QColor{128, 128, 128}}});
+	assert_equal(highlighter.highlighted_blocks, 1);
+	assert_equal(get_foreground(document, 0, 0), "#0000ff");
+	assert_equal(get_foreground(document, 0, 8), "#808080");
+	//names the theme has no color for are left as they are
+	highlighter.set_theme({{"keyword", QColor{0, 0, 255}}});
+	assert_equal(get_foreground(document, 0, 8), "");
+}
+
+void test_syntax_highligher() {
+	test_incremental_highlighting();
+	test_background_highlighting();
+	test_semantic_tokens();
+	test_themes();
+}
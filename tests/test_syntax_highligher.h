@@ -0,0 +1,6 @@
+#ifndef TEST_SYNTAX_HIGHLIGHER_H
+#define TEST_SYNTAX_HIGHLIGHER_H
+
+void test_syntax_highligher();
+
+#endif // TEST_SYNTAX_HIGHLIGHER_H
@@ -0,0 +1,128 @@
+#include "test_syntax_rules.h"
+#include "logic/syntax_rules.h"
+#include "test.h"
+
+#include <QDir>
+#include <QFile>
+#include <QTemporaryDir>
+#include <QTextCharFormat>
+#include <chrono>
+#include <iostream>
+#include <string>
+
+static std::string get_tokens(const Syntax_rules &syntax_rules) {
+	auto rules = syntax_rules.token_rules;
+	std::string tokens;
+	int state = Highlighting_rules::no_region;
+	for (const auto line : {u"int main() { //comment", u"/* a", u"b */ return R\"x(", u")x\" 0; }"}) {
+		state = rules.find_tokens(line, state, [&](const Highlighting_rules::Token &token) {
+			tokens += std::to_string(token.rule) + ':' + std::to_string(token.begin) + ':' + std::to_string(token.length) + ':' +
+					  syntax_rules.token_names[syntax_rules.rule_tokens[token.rule]].toStdString() + ' ';
+		});
+	}
+	return tokens;
+}
+
+//a file of its own, so rules that other tests or windows still use aren't shared with the caller, only the whitespace differs
+static QString copy_syntax_file(const QTemporaryDir &directory) {
+	const auto filename = directory.filePath("syntax.json");
+	QFile original{TEST_DATA_PATH "c++-syntax.json"};
+	QFile copy{filename};
+	assert_true(original.open(QIODevice::ReadOnly) && copy.open(QIODevice::WriteOnly));
+	copy.write(original.readAll());
+	copy.write("\n", 1);
+	return filename;
+}
+
+static void test_sharing_and_caching() {
+	QTemporaryDir directory;
+	assert_true(directory.isValid());
+	const auto cache_path = directory.filePath("syntax");
+	const auto filename = copy_syntax_file(directory);
+
+	auto parsed = Syntax_rules::get(filename, cache_path);
+	assert_equal(parsed->is_from_cache, false);
+	assert_equal(QDir{cache_path}.entryList(QDir::Files).size(), 1);
+	//every document of the same file shares the rules
+	assert_true(Syntax_rules::get(filename, cache_path) == parsed);
+	const auto tokens = get_tokens(*parsed);
+	assert_true(tokens.empty() == false);
+	const auto semantic_tokens = parsed->semantic_tokens;
+	assert_equal(semantic_tokens.size(), 9u);
+	const auto parsed_theme = parsed->theme;
+
+	//once no document uses them the rules are loaded again, from the cache
+	parsed.reset();
+	auto cached = Syntax_rules::get(filename, cache_path);
+	assert_true(cached->is_from_cache);
+	assert_equal(get_tokens(*cached), tokens);
+	assert_true(cached->semantic_tokens == semantic_tokens);
+	assert_true(cached->theme == parsed_theme);
+
+	//a damaged cache is replaced
+	cached.reset();
+	const auto cache_filename = QDir{cache_path}.filePath(QDir{cache_path}.entryList(QDir::Files).front());
+	{
+		QFile cache_file{cache_filename};
+		assert_true(cache_file.open(QIODevice::ReadWrite));
+		const auto data = cache_file.readAll();
+		cache_file.seek(0);
+		cache_file.write(data.left(data.size() / 2));
+		cache_file.resize(data.size() / 2);
+	}
+	auto reparsed = Syntax_rules::get(filename, cache_path);
+	assert_equal(reparsed->is_from_cache, false);
+	assert_equal(get_tokens(*reparsed), tokens);
+	reparsed.reset();
+	assert_true(Syntax_rules::get(filename, cache_path)->is_from_cache);
+}
+
+static void test_token_formats() {
+	QFile file{TEST_DATA_PATH "c++-syntax.json"};
+	assert_true(file.open(QIODevice::ReadOnly));
+	const auto rules = Syntax_rules::parse(file.readAll());
+	//rules with the same color name share their token id
+	assert_equal(rules.token_names.size(), rules.theme.size() + 1);
+	assert_true(rules.token_names[Syntax_rules::plain_token].isEmpty());
+	assert_equal(rules.rule_tokens.size(), rules.token_rules.get_rule_count());
+	assert_equal(rules.token_names[rules.semantic_tokens[2]].toStdString(), "type"); //class has no color of its own
+	const auto formats = rules.get_formats(rules.theme);
+	assert_equal(formats.size(), rules.token_names.size());
+	for (std::size_t token = 1; token < formats.size(); token++) {
+		assert_true(formats[token].foreground().color() == rules.theme.at(rules.token_names[token]));
+	}
+	//another theme only changes the formats
+	auto theme = rules.theme;
+	theme["keyword"] = QColor{0, 0, 255};
+	theme.erase("comment");
+	const auto themed_formats = rules.get_formats(theme);
+	for (std::size_t token = 1; token < formats.size(); token++) {
+		const auto &name = rules.token_names[token];
+		if (name == "keyword") {
+			assert_equal(themed_formats[token].foreground().color().name().toStdString(), "#0000ff");
+		} else if (name == "comment") {
+			assert_equal(themed_formats[token].hasProperty(QTextFormat::ForegroundBrush), false);
+		} else {
+			assert_true(themed_formats[token] == formats[token]);
+		}
+	}
+}
+
+void test_syntax_rules() {
+	test_sharing_and_caching();
+	test_token_formats();
+}
+
+void benchmark_syntax_rules() {
+	QTemporaryDir directory;
+	const auto cache_path = directory.filePath("syntax");
+	const auto filename = copy_syntax_file(directory);
+	const auto start = std::chrono::steady_clock::now();
+	Syntax_rules::get(filename, cache_path);
+	const auto parsed = std::chrono::steady_clock::now();
+	assert_true(Syntax_rules::get(filename, cache_path)->is_from_cache);
+	const auto cached = std::chrono::steady_clock::now();
+	using milliseconds = std::chrono::duration<double, std::milli>;
+	std::cout << "Loading syntax rules: parsing " << milliseconds{parsed - start}.count() << " ms, from the cache " << milliseconds{cached - parsed}.count()
+			  << " ms\n";
+}
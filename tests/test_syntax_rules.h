@@ -0,0 +1,7 @@
+#ifndef TEST_SYNTAX_RULES_H
+#define TEST_SYNTAX_RULES_H
+
+void test_syntax_rules();
+void benchmark_syntax_rules();
+
+#endif // TEST_SYNTAX_RULES_H
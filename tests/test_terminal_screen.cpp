@@ -0,0 +1,130 @@
+#include "test_terminal_screen.h"
+#include "logic/terminal_screen.h"
+#include "test.h"
+
+#include <chrono>
+#include <iostream>
+#include <string>
+
+static std::string get_row(const Terminal_screen &screen, int row) { //without trailing spaces, only ASCII
+	std::string text;
+	for (int column = 0; column < screen.get_columns(); column++) {
+		text += static_cast<char>(screen.get_cell(row, column).character);
+	}
+	return text.substr(0, text.find_last_not_of(' ') + 1);
+}
+
+static int count_damaged_rows(const Terminal_screen &screen) {
+	const auto &damage = screen.get_damage();
+	return static_cast<int>(std::count_if(std::begin(damage), std::end(damage), [](const Terminal_screen::Damage &row_damage) {
+		return row_damage.first_column != row_damage.end_column;
+	}));
+}
+
+static void test_printing() {
+	Terminal_screen screen{3, 5};
+	screen.feed("hello world");
+	assert_equal(get_row(screen, 0), "hello");
+	assert_equal(get_row(screen, 1), " worl");
+	assert_equal(get_row(screen, 2), "d");
+	screen.feed("\r\nx\tq\r\n\033[31mab\033[0m");
+	assert_equal(get_row(screen, 0), "d"); //scrolled
+	assert_equal(get_row(screen, 1), "x   q");
+	assert_equal(get_row(screen, 2), "ab");
+	assert_true(screen.get_cell(2, 0).attributes.foreground == Sgr_color::from_index(1));
+	assert_equal(screen.get_cursor_row(), 2);
+	assert_equal(screen.get_cursor_column(), 2);
+	screen.feed("\xc3");
+	screen.feed("\xa4");
+	assert_true(screen.get_cell(2, 2).character == U'ä');
+}
+
+static void test_cursor_and_erasing() {
+	Terminal_screen screen{4, 10};
+	screen.feed("0123456789\033[2;3Habc\033[1;5H\033[K\033[3;1Hline\033[2D\033[1P");
+	assert_equal(get_row(screen, 0), "0123");
+	assert_equal(get_row(screen, 1), "  abc");
+	assert_equal(get_row(screen, 2), "lie");
+	screen.feed("\033[4;1Hbottom\033[3D\033[1J");
+	assert_equal(get_row(screen, 0), "");
+	assert_equal(get_row(screen, 2), "");
+	assert_equal(get_row(screen, 3), "    om");
+	screen.feed("\033[2J\033[6n");
+	for (int row = 0; row < screen.get_rows(); row++) {
+		assert_equal(get_row(screen, row), "");
+	}
+	assert_equal(screen.take_responses(), "\033[4;4R");
+	assert_equal(screen.take_responses(), "");
+}
+
+static void test_scroll_region() {
+	Terminal_screen screen{5, 4};
+	screen.feed("a\r\nb\r\nc\r\nd\r\ne\033[2;4r\033[4;1H\n\nx\033[2;1H\033[L\033M");
+	assert_equal(get_row(screen, 0), "a"); //outside of the region
+	assert_equal(get_row(screen, 1), "");
+	assert_equal(get_row(screen, 2), "");
+	assert_equal(get_row(screen, 3), "d");
+	assert_equal(get_row(screen, 4), "e");
+}
+
+static void test_alternate_screen() {
+	Terminal_screen screen{3, 10};
+	screen.feed("shell$ vim\r\n");
+	screen.feed("\033[?1049h\033[Hvim stuff\033[?25l");
+	assert_true(screen.is_alternate_screen());
+	assert_true(screen.is_cursor_visible() == false);
+	assert_equal(get_row(screen, 0), "vim stuff");
+	screen.feed("\033[?1049l\033[?25h");
+	assert_true(screen.is_alternate_screen() == false);
+	assert_equal(get_row(screen, 0), "shell$ vim");
+	assert_equal(screen.get_cursor_row(), 1);
+	assert_equal(screen.get_cursor_column(), 0);
+	screen.resize(2, 4);
+	assert_equal(get_row(screen, 0), "");
+	assert_equal(get_row(screen, 1), "");
+	assert_equal(screen.get_cursor_row(), 0);
+}
+
+static void test_damage() {
+	Terminal_screen screen{24, 80};
+	assert_equal(count_damaged_rows(screen), 24);
+	screen.clear_damage();
+	assert_equal(count_damaged_rows(screen), 0);
+	screen.feed("\033[10;20Hx");
+	assert_equal(count_damaged_rows(screen), 2); //the old and the new cursor position
+	const auto damage = screen.get_damage()[9];
+	assert_equal(damage.first_column, 19);
+	assert_equal(damage.end_column, 21);
+	screen.clear_damage();
+	screen.feed("\033[S");
+	assert_equal(count_damaged_rows(screen), 24);
+}
+
+static void benchmark_full_screen_redraw_throughput() { //full screen tools redraw a lot, we need to keep up with a frame rate of a terminal emulator
+	std::string frame = "\033[H";
+	for (int row = 0; row < 50; row++) {
+		frame += "\033[" + std::to_string(row + 1) + ";1H\033[38;5;" + std::to_string(row) + "m" + std::string(100, 'a' + row % 26) + "\033[0m";
+	}
+	Terminal_screen screen{50, 200};
+	constexpr int frame_count = 1000;
+	const auto start = std::chrono::steady_clock::now();
+	for (int i = 0; i < frame_count; i++) {
+		screen.feed(frame);
+		screen.clear_damage();
+	}
+	const auto seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	assert_equal(get_row(screen, 49), std::string(100, 'a' + 49 % 26));
+	std::cout << "Terminal screen: " << frame_count / seconds << " full screen frames/s, " << frame.size() * frame_count / seconds / 1e6 << " MB/s\n";
+}
+
+void test_terminal_screen() {
+	test_printing();
+	test_cursor_and_erasing();
+	test_scroll_region();
+	test_alternate_screen();
+	test_damage();
+}
+
+void benchmark_terminal_screen() {
+	benchmark_full_screen_redraw_throughput();
+}
@@ -0,0 +1,7 @@
+#ifndef TEST_TERMINAL_SCREEN_H
+#define TEST_TERMINAL_SCREEN_H
+
+void test_terminal_screen();
+void benchmark_terminal_screen();
+
+#endif // TEST_TERMINAL_SCREEN_H
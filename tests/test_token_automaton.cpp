@@ -0,0 +1,195 @@
+#include "test_token_automaton.h"
+#include "logic/token_automaton.h"
+#include "test.h"
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <regex>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+static std::string get_tokens(Token_automaton &automaton, std::u16string_view text) {
+	std::string tokens;
+	automaton.find_tokens(text, [&](const Token_automaton::Token &token) {
+		tokens += std::to_string(token.rule) + ':' + std::string(std::begin(text) + token.begin, std::begin(text) + token.begin + token.length) + ' ';
+	});
+	return tokens;
+}
+
+static void test_syntax() {
+	Token_automaton automaton;
+	automaton.add_rule(R"(\b(if|else|while)\b)");
+	automaton.add_rule(R"([A-Za-z_]\w*)");
+	automaton.add_rule(R"(0x[0-9a-fA-F]+|\d+(\.\d*)?([eE][+-]?\d+)?)");
+	automaton.add_rule(R"("([^"\\]|\\.)*")");
+	automaton.add_rule(R"(//.*$)");
+	automaton.add_rule(R"(^\s*#\s*[a-z]{2,7}\b)");
+	automaton.add_rule(R"(a{3}|b{1,2}?)");
+	automaton.add_rule(R"([\[\].-])");
+	assert_equal(automaton.get_rule_count(), 8u);
+	assert_equal(get_tokens(automaton, u"if iffy else"), "0:if 1:iffy 0:else ");
+	assert_equal(get_tokens(automaton, u"x = 0x1F + 3.5e-2;"), "1:x 2:0x1F 2:3.5e-2 ");
+	assert_equal(get_tokens(automaton, uR"(s = "a \" b"; // done)"), R"(1:s 3:"a \" b" 4:// done )");
+	assert_equal(get_tokens(automaton, u"  # include x #define"), "5:  # include 1:x 1:define "); //# only starts a directive at the start of the line
+	assert_equal(get_tokens(automaton, u"# ="), ""); //too short for the directive, the # isn't matched by anything
+	assert_equal(get_tokens(automaton, u"[.-]"), "7:[ 7:. 7:- 7:] ");
+	//only ASCII characters can be word characters, like for std::regex
+	assert_equal(get_tokens(automaton, u"äifä"), "0:if ");
+}
+
+static void test_priorities() {
+	Token_automaton automaton;
+	automaton.add_rule("for");
+	automaton.add_rule("[a-z]+");
+	automaton.add_rule("format");
+	assert_equal(get_tokens(automaton, u"for"), "0:for ");       //same length, the first rule wins
+	assert_equal(get_tokens(automaton, u"format"), "1:format "); //the longest match wins
+	assert_equal(get_tokens(automaton, u"for("), "0:for ");
+	assert_true(automaton.get_state_count() > 0u);
+}
+
+static void test_errors() {
+	for (const auto pattern : {"(a", "a)", "[a-", "a{2", "\\1", "(?=a)", "a**", "\\", "*"}) {
+		Token_automaton automaton;
+		bool threw = false;
+		try {
+			automaton.add_rule(pattern);
+		} catch (const std::runtime_error &) {
+			threw = true;
+		}
+		assert_true(threw);
+		assert_equal(automaton.get_rule_count(), 0u);
+	}
+}
+
+static std::vector<std::string> load_patterns() {
+	std::ifstream file{TEST_DATA_PATH "c++-syntax.json"};
+	std::string json{std::istreambuf_iterator<char>{file}, std::istreambuf_iterator<char>{}};
+	json.erase(std::min(json.find("\"regions\""), json.size())); //only the token rules
+	std::vector<std::string> patterns;
+	const std::regex token{R"~(\[\s*"((?:[^"\\]|\\.)*)")~"};
+	for (auto match = std::sregex_iterator{std::begin(json), std::end(json), token}; match != std::sregex_iterator{}; ++match) {
+		patterns.push_back(std::regex_replace((*match)[1].str(), std::regex{R"(\\(.))"}, "$1"));
+	}
+	return patterns;
+}
+
+static const std::string source_snippet = "template <class T>\nstatic constexpr auto get_value(const T &value) noexcept {\n"
+										  "\tif (value.size() > 42 && value.is_valid() == false) { //unusual\n"
+										  "\t\treturn static_cast<unsigned int>(value.size() + sizeof(T));\n\t}\n"
+										  "\tfor (auto &&element : value) {\n\t\tthrow std::runtime_error{\"bad element\"};\n\t}\n\treturn 0u;\n}\n";
+
+static std::string make_source() {
+	std::string source;
+	while (source.size() < 4 * 1024 * 1024) {
+		source += source_snippet;
+	}
+	return source;
+}
+
+static std::vector<std::size_t> get_line_starts(const std::string &source) { //with one past the end of the last line at the end
+	std::vector<std::size_t> line_starts{0};
+	for (std::size_t i = 0; i < source.size(); i++) {
+		if (source[i] == '\n') {
+			line_starts.push_back(i + 1);
+		}
+	}
+	line_starts.push_back(source.size() + 1);
+	return line_starts;
+}
+
+//what a highlighter has to do without the automaton: run every rule over the text and keep the first rule's token where they overlap
+static std::string get_regex_tokens(const std::vector<std::regex> &regexes, const std::string &text) {
+	std::vector<int> rules(text.size(), -1);
+	std::vector<std::size_t> lengths(text.size());
+	for (std::size_t rule = 0; rule < regexes.size(); rule++) {
+		for (auto match = std::sregex_iterator{std::begin(text), std::end(text), regexes[rule]}; match != std::sregex_iterator{}; ++match) {
+			const auto position = static_cast<std::size_t>(match->position());
+			if (match->length() > 0 && rules[position] == -1) {
+				rules[position] = static_cast<int>(rule);
+				lengths[position] = static_cast<std::size_t>(match->length());
+			}
+		}
+	}
+	std::string tokens;
+	for (std::size_t position = 0; position < text.size(); position++) {
+		if (rules[position] != -1) {
+			tokens += std::to_string(rules[position]) + ':' + text.substr(position, lengths[position]) + ' ';
+			position += lengths[position] - 1;
+		}
+	}
+	return tokens;
+}
+
+static void test_keyword_rules() { //the automaton finds the same tokens as running every rule by itself
+	const auto patterns = load_patterns();
+	assert_true(patterns.size() > 50u);
+	Token_automaton automaton;
+	std::vector<std::regex> regexes;
+	for (const auto &pattern : patterns) {
+		automaton.add_rule(pattern);
+		regexes.emplace_back(pattern);
+	}
+	const auto line_starts = get_line_starts(source_snippet);
+	std::string tokens;
+	std::string regex_tokens;
+	for (std::size_t line = 0; line + 2 < line_starts.size(); line++) {
+		const auto text = source_snippet.substr(line_starts[line], line_starts[line + 1] - line_starts[line] - 1);
+		tokens += get_tokens(automaton, std::u16string{std::begin(text), std::end(text)});
+		regex_tokens += get_regex_tokens(regexes, text);
+	}
+	assert_equal(tokens, regex_tokens);
+}
+
+static void benchmark_keyword_rules() {
+	const auto patterns = load_patterns();
+	Token_automaton automaton;
+	std::vector<std::regex> regexes;
+	for (const auto &pattern : patterns) {
+		automaton.add_rule(pattern);
+		regexes.emplace_back(pattern);
+	}
+	const auto source = make_source();
+	const std::u16string utf16_source{std::begin(source), std::end(source)};
+	const auto line_starts = get_line_starts(source);
+	const auto get_line = [&](std::size_t line) {
+		return std::u16string_view{utf16_source}.substr(line_starts[line], line_starts[line + 1] - line_starts[line] - 1);
+	};
+
+	//lines are tokenized one by one like the blocks of a document
+	std::size_t token_count = 0;
+	const auto start = std::chrono::steady_clock::now();
+	for (std::size_t line = 0; line + 1 < line_starts.size(); line++) {
+		automaton.find_tokens(get_line(line), [&token_count](const Token_automaton::Token &) { token_count++; });
+	}
+	const auto automaton_done = std::chrono::steady_clock::now();
+	const std::size_t regex_lines = 300;
+	for (std::size_t line = 0; line < regex_lines; line++) {
+		for (const auto &regex : regexes) {
+			const auto text = source.substr(line_starts[line], line_starts[line + 1] - line_starts[line] - 1);
+			token_count += std::distance(std::sregex_iterator{std::begin(text), std::end(text), regex}, std::sregex_iterator{});
+		}
+	}
+	const auto regex_done = std::chrono::steady_clock::now();
+	assert_true(token_count > 0u);
+	const auto regex_size = line_starts[regex_lines];
+	using seconds = std::chrono::duration<double>;
+	std::cout << "Tokenizing with " << patterns.size() << " rules: automaton " << source.size() / seconds{automaton_done - start}.count() / 1e6
+			  << " MB/s with " << automaton.get_state_count() << " states, std::regex per rule "
+			  << regex_size / seconds{regex_done - automaton_done}.count() / 1e6 << " MB/s\n";
+}
+
+void test_token_automaton() {
+	test_syntax();
+	test_priorities();
+	test_errors();
+	test_keyword_rules();
+}
+
+void benchmark_token_automaton() {
+	benchmark_keyword_rules();
+}
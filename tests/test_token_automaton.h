@@ -0,0 +1,7 @@
+#ifndef TEST_TOKEN_AUTOMATON_H
+#define TEST_TOKEN_AUTOMATON_H
+
+void test_token_automaton();
+void benchmark_token_automaton();
+
+#endif // TEST_TOKEN_AUTOMATON_H
@@ -11,4 +11,13 @@ void test_tool() {
 	assert_not_equal(t1, t2);
 	assert_not_equal(t1.to_string(), t2.to_string());
 	assert_equal(Tool::from_string(t1.to_string()), t1);
+	//the error output can't go into a terminal or the highlighting
+	for (const auto target : {Tool_output_target::terminal, Tool_output_target::semantic_highlighting}) {
+		t1.output = target;
+		t1.error = target;
+		const auto loaded = Tool::from_string(t1.to_string());
+		assert_equal(loaded.output, target);
+		assert_equal(loaded.error, Tool_output_target::ignore);
+	}
+	assert_equal(Tool_output_target::get_error_texts().size(), static_cast<std::size_t>(Tool_output_target::error_target_count));
 }
@@ -0,0 +1,139 @@
+#include "test_tool_scheduler.h"
+#include "logic/process_reader.h"
+#include "logic/settings.h"
+#include "logic/tool.h"
+#include "logic/tool_scheduler.h"
+#include "logic/tool_statistics.h"
+#include "test.h"
+#include "ui/edit_window.h"
+
+#include <QApplication>
+#include <QTextBlock>
+#include <QTextCursor>
+#include <QTextDocument>
+#include <chrono>
+#include <vector>
+
+static void wait_for_scheduled_tools() {
+	const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds{10};
+	while ((Tool_scheduler::get_queued_count() != 0 || Tool_scheduler::get_running_count() != 0) && std::chrono::steady_clock::now() < deadline) {
+		QApplication::processEvents(QEventLoop::WaitForMoreEvents, 10);
+	}
+}
+
+static Tool create_tool(Tool_activation::Type activation, const QString &arguments) {
+	Tool tool{};
+	tool.path = "sleep";
+	tool.arguments = arguments;
+	tool.activation = activation;
+	tool.output = Tool_output_target::ignore;
+	tool.error = Tool_output_target::ignore;
+	return tool;
+}
+
+static void test_debounce() { //typing must only run an on_file_edit tool once
+	const auto tool = create_tool(Tool_activation::on_file_edit, "0");
+	Tool_scheduler::set_tools({tool});
+	Edit_window edit_window;
+	for (int i = 0; i < 50; i++) {
+		Tool_scheduler::file_edited(&edit_window);
+		QApplication::processEvents();
+	}
+	wait_for_scheduled_tools();
+	const auto statistics = Tool_scheduler::get_statistics(tool);
+	assert_equal(statistics.starts, 1u);
+	assert_equal(statistics.runs, 1u);
+	assert_equal(statistics.superseded_runs, 0u);
+	assert_true(Tool_statistics::get_report().contains(QObject::tr("Queue wait"))); //the scheduler's figures are part of the report
+	Tool_scheduler::set_tools({});
+}
+
+static void test_pasting_output() { //pasting the output is an edit too, it must not run the tool again
+	auto tool = create_tool(Tool_activation::on_file_edit, "x");
+	tool.path = "echo";
+	tool.output = Tool_output_target::paste;
+	Tool_scheduler::set_tools({tool});
+	Edit_window edit_window;
+	QObject::connect(&edit_window, &Edit_window::textChanged, [&edit_window] { Tool_scheduler::file_edited(&edit_window); });
+	edit_window.setPlainText("a");
+	wait_for_scheduled_tools();
+	assert_equal(Tool_scheduler::get_statistics(tool).runs, 1u);
+	assert_equal(Tool_scheduler::get_queued_count(), 0u);
+	assert_equal(edit_window.toPlainText().toStdString(), "x\na");
+	Tool_scheduler::set_tools({});
+}
+
+static void test_stop() { //stopping kills every running tool without waiting for it, no completion arrives afterwards
+	std::vector<Tool> tools;
+	for (int i = 0; i < 3; i++) {
+		tools.push_back(create_tool(Tool_activation::on_save_file, QString::number(10 + i)));
+	}
+	Tool_scheduler::set_tools(tools);
+	Edit_window edit_window;
+	Tool_scheduler::file_saved(&edit_window);
+	assert_true(Tool_scheduler::get_running_count() > 0u);
+	const auto start = std::chrono::steady_clock::now();
+	Tool_scheduler::stop();
+	assert_true(std::chrono::steady_clock::now() - start < Process_reader::kill_grace_period);
+	assert_equal(Tool_scheduler::get_running_count(), 0u);
+	assert_equal(Tool_scheduler::get_queued_count(), 0u);
+	QApplication::processEvents();
+	for (const auto &tool : tools) {
+		assert_equal(Tool_scheduler::get_statistics(tool).runs, 0u);
+	}
+	Tool_scheduler::set_tools({});
+}
+
+static void test_kept_input() { //a semantic highlighting tool keeps running and gets the edits instead of being restarted
+	//the tool exits when it gets the edited middle line alone
+	auto tool = create_tool(Tool_activation::on_file_edit, "-n /^replace.1.1.1$/q");
+	tool.path = "sed";
+	tool.output = Tool_output_target::semantic_highlighting;
+	Tool_scheduler::set_tools({tool});
+	Edit_window edit_window;
+	edit_window.setPlainText("a\nx\nc");
+	Tool_scheduler::file_edited(&edit_window);
+	const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds{10};
+	while (Tool_scheduler::get_queued_count() != 0 && std::chrono::steady_clock::now() < deadline) {
+		QApplication::processEvents(QEventLoop::WaitForMoreEvents, 10);
+	}
+	assert_equal(Tool_scheduler::get_running_count(), 1u);
+	QTextCursor cursor{edit_window.document()->findBlockByNumber(1)};
+	cursor.select(QTextCursor::LineUnderCursor);
+	cursor.insertText("b");
+	Tool_scheduler::file_edited(&edit_window);
+	wait_for_scheduled_tools();
+	const auto statistics = Tool_scheduler::get_statistics(tool);
+	assert_equal(statistics.runs, 1u);
+	assert_equal(statistics.superseded_runs, 0u);
+	Tool_scheduler::set_tools({});
+}
+
+static void test_concurrency_limit() {
+	Settings::Keeper keeper;
+	Settings::set<Settings::Key::max_concurrent_tools>(2);
+	std::vector<Tool> tools;
+	for (int i = 0; i < 6; i++) {
+		tools.push_back(create_tool(Tool_activation::on_save_file, "0.0" + QString::number(i + 1)));
+	}
+	Tool_scheduler::set_tools(tools);
+	Edit_window edit_window;
+	Tool_scheduler::file_saved(&edit_window);
+	const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds{10};
+	while ((Tool_scheduler::get_queued_count() != 0 || Tool_scheduler::get_running_count() != 0) && std::chrono::steady_clock::now() < deadline) {
+		assert_true(Tool_scheduler::get_running_count() <= 2u);
+		QApplication::processEvents(QEventLoop::WaitForMoreEvents, 10);
+	}
+	for (const auto &tool : tools) {
+		assert_equal(Tool_scheduler::get_statistics(tool).runs, 1u);
+	}
+	Tool_scheduler::set_tools({});
+}
+
+void test_tool_scheduler() {
+	test_debounce();
+	test_pasting_output();
+	test_stop();
+	test_kept_input();
+	test_concurrency_limit();
+}
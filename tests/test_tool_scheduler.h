@@ -0,0 +1,6 @@
+#ifndef TEST_TOOL_SCHEDULER_H
+#define TEST_TOOL_SCHEDULER_H
+
+void test_tool_scheduler();
+
+#endif // TEST_TOOL_SCHEDULER_H
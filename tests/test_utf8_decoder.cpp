@@ -0,0 +1,106 @@
+#include "test_utf8_decoder.h"
+#include "test.h"
+#include "utility/utf8_decoder.h"
+
+#include <QString>
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <string>
+
+static std::u16string decode(std::string_view utf8) {
+	std::u16string utf16(utf8.size(), u'\0');
+	utf16.resize(Utility::decode_utf8(utf8, utf16.data()));
+	return utf16;
+}
+
+static void append_utf8(std::string &utf8, char32_t code_point) {
+	if (code_point < 0x80) {
+		utf8 += static_cast<char>(code_point);
+	} else if (code_point < 0x800) {
+		utf8 += static_cast<char>(0xC0 | code_point >> 6);
+		utf8 += static_cast<char>(0x80 | (code_point & 0x3F));
+	} else if (code_point < 0x10000) {
+		utf8 += static_cast<char>(0xE0 | code_point >> 12);
+		utf8 += static_cast<char>(0x80 | (code_point >> 6 & 0x3F));
+		utf8 += static_cast<char>(0x80 | (code_point & 0x3F));
+	} else {
+		utf8 += static_cast<char>(0xF0 | code_point >> 18);
+		utf8 += static_cast<char>(0x80 | (code_point >> 12 & 0x3F));
+		utf8 += static_cast<char>(0x80 | (code_point >> 6 & 0x3F));
+		utf8 += static_cast<char>(0x80 | (code_point & 0x3F));
+	}
+}
+
+static void append_utf16(std::u16string &utf16, char32_t code_point) {
+	if (code_point < 0x10000) {
+		utf16 += static_cast<char16_t>(code_point);
+	} else {
+		utf16 += static_cast<char16_t>(0xD800 + ((code_point - 0x10000) >> 10));
+		utf16 += static_cast<char16_t>(0xDC00 + ((code_point - 0x10000) & 0x3FF));
+	}
+}
+
+static void test_valid() {
+	assert_true(decode("") == u"");
+	assert_true(decode("plain ASCII that is longer than 16 bytes") == u"plain ASCII that is longer than 16 bytes");
+	assert_true(decode("Gr\xC3\xBC\xC3\x9F" "e \xE2\x82\xAC \xF0\x9F\x98\x80!") == u"Grüße € \U0001F600!");
+	std::mt19937 random{42};
+	std::uniform_int_distribution<std::uint32_t> code_points{0, 0x10FFFF};
+	std::uniform_int_distribution<int> ascii_run{0, 40};
+	for (int round = 0; round < 100; round++) { //mixes ASCII runs of all lengths with other characters so every SIMD boundary gets hit
+		std::string utf8;
+		std::u16string expected;
+		for (int character = 0; character < 50; character++) {
+			for (int ascii = ascii_run(random); ascii > 0; ascii--) {
+				append_utf8(utf8, 'a' + ascii % 26);
+				append_utf16(expected, 'a' + ascii % 26);
+			}
+			auto code_point = code_points(random);
+			if (code_point >= 0xD800 && code_point <= 0xDFFF) {
+				code_point = 0xFFFD;
+			}
+			append_utf8(utf8, code_point);
+			append_utf16(expected, code_point);
+		}
+		assert_true(decode(utf8) == expected);
+	}
+}
+
+static void test_invalid() {
+	assert_true(decode("a\x80" "b") == u"a�b");                          //stray continuation byte
+	assert_true(decode("\xC0\xAF") == u"��");                       //overlong
+	assert_true(decode("\xE0\x80\xAF") == u"���");             //overlong
+	assert_true(decode("\xED\xA0\x80") == u"���");             //surrogate
+	assert_true(decode("\xF4\x90\x80\x80") == u"����");   //above U+10FFFF
+	assert_true(decode("\xF0\x9F\x98x") == u"�x");                       //truncated, one replacement for the maximal subpart
+	assert_true(decode("\xE2\x82") == u"�");                             //truncated at the end
+	assert_true(decode("\xFF\xFE") == u"��");
+	assert_true(decode("0123456789abcde\xE2\x82\xAC" "0123456789abcdef\xC3") == u"0123456789abcde€0123456789abcdef�");
+}
+
+static void benchmark_decoding_speed() {
+	std::string output;
+	while (output.size() < 32 * 1024 * 1024) {
+		output += "[ 42%] Building CXX object src/CMakeFiles/module.dir/file.cpp.o \xE2\x80\x98quoted\xE2\x80\x99\n";
+	}
+	std::u16string utf16(output.size(), u'\0');
+	const auto start = std::chrono::steady_clock::now();
+	const auto size = Utility::decode_utf8(output, utf16.data());
+	const auto decoded = std::chrono::steady_clock::now();
+	const auto string = QString::fromUtf8(output.data(), static_cast<int>(output.size()));
+	const auto qt_decoded = std::chrono::steady_clock::now();
+	assert_equal(static_cast<int>(size), string.size());
+	using seconds = std::chrono::duration<double>;
+	std::cout << "UTF-8 decoding: " << output.size() / seconds{decoded - start}.count() / 1e9 << " GB/s, QString::fromUtf8 "
+			  << output.size() / seconds{qt_decoded - decoded}.count() / 1e9 << " GB/s\n";
+}
+
+void test_utf8_decoder() {
+	test_valid();
+	test_invalid();
+}
+
+void benchmark_utf8_decoder() {
+	benchmark_decoding_speed();
+}
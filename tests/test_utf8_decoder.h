@@ -0,0 +1,7 @@
+#ifndef TEST_UTF8_DECODER_H
+#define TEST_UTF8_DECODER_H
+
+void test_utf8_decoder();
+void benchmark_utf8_decoder();
+
+#endif // TEST_UTF8_DECODER_H
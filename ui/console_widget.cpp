@@ -0,0 +1,167 @@
+#include "console_widget.h"
+#include "logic/settings.h"
+
+#include <QFont>
+#include <QFontMetrics>
+#include <QMouseEvent>
+#include <QPainter>
+#include <QPaintEvent>
+#include <QScrollBar>
+#include <algorithm>
+#include <iterator>
+#include <limits>
+#include <utility>
+
+Console_widget::Console_widget(QWidget *parent)
+	: QAbstractScrollArea{parent} {
+	QFont font;
+	font.fromString(Settings::get<Settings::Key::font>("monospace"));
+	setFont(font);
+	update_scroll_bars();
+}
+
+void Console_widget::append(std::string_view output, Console_buffer::Stream_state &state, Diagnostic_parser *parser) {
+	auto scroll_bar = verticalScrollBar();
+	const bool at_bottom = scroll_bar->value() == scroll_bar->maximum();
+	const auto dropped_line_count = buffer.get_dropped_line_count();
+	if (parser == nullptr) {
+		buffer.append(output, state);
+	}
+	while (parser && output.empty() == false) { //line by line to know which line a diagnostic is in
+		const auto newline = output.find('\n');
+		const auto line = output.substr(0, newline == std::string_view::npos ? output.size() : newline + 1);
+		output.remove_prefix(line.size());
+		buffer.append(line, state);
+		const auto diagnostic_id = diagnostics.get_end_id();
+		parser->feed(line, diagnostics);
+		if (diagnostics.get_end_id() != diagnostic_id) { //diagnostics are only parsed at the newline which started a new line
+			diagnostic_lines[buffer.get_dropped_line_count() + buffer.get_line_count() - 2] = diagnostic_id;
+		}
+	}
+	drop_diagnostics();
+	const auto newly_dropped_line_count = static_cast<int>(std::min<std::uint64_t>(buffer.get_dropped_line_count() - dropped_line_count, std::numeric_limits<int>::max()));
+	const auto value = scroll_bar->value();
+	update_scroll_bars();
+	scroll_bar->setValue(at_bottom ? scroll_bar->maximum() : std::max(0, value - newly_dropped_line_count));
+	viewport()->update();
+}
+
+void Console_widget::finish(Diagnostic_parser &parser) {
+	const auto diagnostic_id = diagnostics.get_end_id();
+	parser.finish(diagnostics);
+	if (diagnostics.get_end_id() != diagnostic_id) { //still the last line, nothing started a new one
+		diagnostic_lines[buffer.get_dropped_line_count() + buffer.get_line_count() - 1] = diagnostic_id;
+	}
+}
+
+void Console_widget::clear() {
+	buffer.clear();
+	diagnostics.clear();
+	diagnostic_lines.clear();
+	update_scroll_bars();
+	viewport()->update();
+}
+
+void Console_widget::set_max_line_count(std::size_t max_line_count) {
+	buffer.set_max_line_count(max_line_count);
+	drop_diagnostics();
+	update_scroll_bars();
+	viewport()->update();
+}
+
+void Console_widget::set_diagnostic_handler(std::function<void(const Diagnostic &)> handler) {
+	diagnostic_handler = std::move(handler);
+}
+
+const Console_buffer &Console_widget::get_buffer() const {
+	return buffer;
+}
+
+const Diagnostic_index &Console_widget::get_diagnostics() const {
+	return diagnostics;
+}
+
+void Console_widget::paintEvent(QPaintEvent *event) {
+	QPainter painter{viewport()};
+	const auto area = event->rect();
+	const auto background_color = palette().color(QPalette::Base);
+	const auto text_color = palette().color(QPalette::Text);
+	painter.fillRect(area, background_color);
+	const QFontMetrics metrics{font()};
+	const auto line_height = get_line_height();
+	const auto first_line = static_cast<std::size_t>(verticalScrollBar()->value() + area.top() / line_height);
+	const auto line_count = buffer.get_line_count();
+	for (auto line = first_line; line < line_count; line++) {
+		const int y = static_cast<int>(line - verticalScrollBar()->value()) * line_height;
+		if (y > area.bottom()) {
+			break;
+		}
+		int x = -horizontalScrollBar()->value();
+		for (const auto &run : buffer.get_runs(line)) {
+			if (x > area.right()) {
+				break;
+			}
+			const auto &attributes = run.attributes;
+			QFont run_font = font();
+			run_font.setBold(attributes.has(Sgr_attributes::bold));
+			run_font.setItalic(attributes.has(Sgr_attributes::italic));
+			run_font.setUnderline(attributes.has(Sgr_attributes::underline));
+			run_font.setStrikeOut(attributes.has(Sgr_attributes::crossed_out));
+			run_font.setOverline(attributes.has(Sgr_attributes::overline));
+			const auto [foreground, background] = attributes.get_colors(text_color.rgb(), background_color.rgb());
+			const auto text = QString::fromUtf8(run.text.data(), static_cast<int>(run.text.size()));
+			const auto width = QFontMetrics{run_font}.horizontalAdvance(text);
+			if (background) {
+				painter.fillRect(x, y, width, line_height, QColor::fromRgb(*background));
+			}
+			painter.setPen(foreground ? QColor::fromRgb(*foreground) : text_color);
+			painter.setFont(run_font);
+			painter.drawText(x, y + metrics.ascent(), text);
+			x += width;
+		}
+	}
+}
+
+void Console_widget::resizeEvent(QResizeEvent *event) {
+	QAbstractScrollArea::resizeEvent(event);
+	const bool at_bottom = verticalScrollBar()->value() == verticalScrollBar()->maximum();
+	update_scroll_bars();
+	if (at_bottom) {
+		verticalScrollBar()->setValue(verticalScrollBar()->maximum());
+	}
+}
+
+void Console_widget::scrollContentsBy(int, int) {
+	viewport()->update(); //everything is painted relative to the scroll bars anyways
+}
+
+void Console_widget::mousePressEvent(QMouseEvent *event) {
+	const auto line = buffer.get_dropped_line_count() + verticalScrollBar()->value() + event->pos().y() / get_line_height();
+	const auto diagnostic_line = diagnostic_lines.find(line);
+	if (event->button() != Qt::LeftButton || diagnostic_line == std::end(diagnostic_lines) || !diagnostic_handler) {
+		QAbstractScrollArea::mousePressEvent(event);
+		return;
+	}
+	diagnostic_handler(diagnostics.get(diagnostic_line->second));
+}
+
+void Console_widget::drop_diagnostics() {
+	diagnostic_lines.erase(std::begin(diagnostic_lines), diagnostic_lines.lower_bound(buffer.get_dropped_line_count()));
+	diagnostics.drop_before(diagnostic_lines.empty() ? diagnostics.get_end_id() : diagnostic_lines.begin()->second);
+}
+
+//the vertical scroll bar counts lines and the horizontal one pixels
+void Console_widget::update_scroll_bars() {
+	const auto page_line_count = std::max(1, viewport()->height() / get_line_height());
+	const auto line_count = static_cast<int>(std::min<std::size_t>(buffer.get_line_count(), std::numeric_limits<int>::max()));
+	verticalScrollBar()->setPageStep(page_line_count);
+	verticalScrollBar()->setRange(0, std::max(0, line_count - page_line_count));
+	const auto max_width = static_cast<int>(std::min<std::size_t>(buffer.get_max_line_length() * QFontMetrics{font()}.averageCharWidth(),
+																   std::numeric_limits<int>::max()));
+	horizontalScrollBar()->setPageStep(viewport()->width());
+	horizontalScrollBar()->setRange(0, std::max(0, max_width - viewport()->width()));
+}
+
+int Console_widget::get_line_height() const {
+	return std::max(1, QFontMetrics{font()}.lineSpacing());
+}
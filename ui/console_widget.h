@@ -0,0 +1,44 @@
+#ifndef CONSOLE_WIDGET_H
+#define CONSOLE_WIDGET_H
+
+#include "logic/console_buffer.h"
+#include "logic/diagnostic_parser.h"
+
+#include <QAbstractScrollArea>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <string_view>
+
+//Shows tool output from a Console_buffer. Only the visible lines are laid out and painted, so the amount of output doesn't matter.
+class Console_widget : public QAbstractScrollArea {
+	Q_OBJECT
+	public:
+	Console_widget(QWidget *parent = nullptr);
+
+	//stays at the bottom if it was scrolled there, otherwise the visible lines stay in place
+	//with a parser the diagnostics in the output can be clicked as soon as their line is complete
+	void append(std::string_view output, Console_buffer::Stream_state &state, Diagnostic_parser *parser = nullptr);
+	void finish(Diagnostic_parser &parser); //once the output is complete, the last line may be a diagnostic without a newline
+	void clear();
+	void set_max_line_count(std::size_t max_line_count);
+	void set_diagnostic_handler(std::function<void(const Diagnostic &)> handler); //called when a line with a diagnostic is clicked
+	const Console_buffer &get_buffer() const;
+	const Diagnostic_index &get_diagnostics() const;
+
+	private:
+	void paintEvent(QPaintEvent *event) override;
+	void resizeEvent(QResizeEvent *event) override;
+	void scrollContentsBy(int dx, int dy) override;
+	void mousePressEvent(QMouseEvent *event) override;
+	void drop_diagnostics(); //of the lines the buffer dropped
+	void update_scroll_bars();
+	int get_line_height() const;
+
+	Console_buffer buffer;
+	Diagnostic_index diagnostics;
+	std::map<std::uint64_t, std::size_t> diagnostic_lines; //line number counting dropped lines to diagnostic id
+	std::function<void(const Diagnostic &)> diagnostic_handler;
+};
+
+#endif // CONSOLE_WIDGET_H
@@ -3,20 +3,42 @@
 #include "logic/syntax_highligher.h"
 #include "logic/tool.h"
 #include "logic/tool_actions.h"
+#include "logic/tool_scheduler.h"
 
 #include <QAction>
 #include <QMessageBox>
+#include <QTextBlock>
 #include <memory>
+#include <utility>
 
 Edit_window::Edit_window() {
-	auto highlighter = std::make_unique<Syntax_highligher>(document());
-	highlighter->load_rules(TEST_DATA_PATH "c++-syntax.json");
-	syntax_highlighter = std::move(highlighter);
+	syntax_highlighter = std::make_unique<Syntax_highligher>(document());
+	syntax_highlighter->load_rules(TEST_DATA_PATH "c++-syntax.json");
+	//sent when scrolling, resizing and editing, so the blocks highlighted in the background first follow what is visible
+	connect(this, &QPlainTextEdit::updateRequest, [this] { update_highlighting_viewport(); });
 	Tool_actions::add_widget(this);
 }
 
 Edit_window::~Edit_window() {
 	Tool_actions::remove_widget(this);
+	Tool_scheduler::remove_edit_window(this);
+}
+
+bool Edit_window::apply_semantic_tokens(std::uint64_t version, std::size_t first_line, std::vector<std::vector<Semantic_token_parser::Run>> lines) {
+	return syntax_highlighter->apply_semantic_tokens(version, first_line, std::move(lines));
+}
+
+void Edit_window::update_highlighting_viewport() {
+	const auto first_block = firstVisibleBlock();
+	if (first_block.isValid() == false) {
+		return;
+	}
+	auto block = first_block;
+	const auto offset = contentOffset();
+	while (block.next().isValid() && blockBoundingGeometry(block.next()).translated(offset).top() < viewport()->height()) {
+		block = block.next();
+	}
+	syntax_highlighter->set_viewport(first_block.blockNumber(), block.blockNumber() - first_block.blockNumber() + 1);
 }
 
 void Edit_window::wheelEvent(QWheelEvent *we) {
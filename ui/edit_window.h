@@ -1,14 +1,17 @@
 #ifndef EDIT_WINDOW_H
 #define EDIT_WINDOW_H
 
+#include "logic/semantic_token_parser.h"
 #include "logic/tool.h"
 
 #include <QPlainTextEdit>
+#include <cstddef>
+#include <cstdint>
 #include <memory>
 #include <vector>
 
 class QAction;
-class QSyntaxHighlighter;
+class Syntax_highligher;
 
 //Widget for code editing
 class Edit_window : public QPlainTextEdit {
@@ -16,14 +19,17 @@ class Edit_window : public QPlainTextEdit {
 	public:
 	Edit_window();
 	~Edit_window();
+	//the tokens of a semantic highlighting tool for the document revision version, see Syntax_highligher::apply_semantic_tokens
+	bool apply_semantic_tokens(std::uint64_t version, std::size_t first_line, std::vector<std::vector<Semantic_token_parser::Run>> lines);
 
 	private:
 	void wheelEvent(QWheelEvent *we) override;
+	void update_highlighting_viewport();
 	void show_output(const QString &output, Tool_output_target::Type output_target, const QString &title, bool is_error);
 
 	int zoom_remainder{};
 	std::vector<std::unique_ptr<QAction>> actions;
-	std::unique_ptr<QSyntaxHighlighter> syntax_highlighter;
+	std::unique_ptr<Syntax_highligher> syntax_highlighter;
 };
 
 #endif // EDIT_WINDOW_H
\ No newline at end of file
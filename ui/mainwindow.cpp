@@ -1,15 +1,27 @@
 #include "mainwindow.h"
+#include "console_widget.h"
 #include "edit_window.h"
+#include "logic/diagnostic_parser.h"
 #include "logic/settings.h"
 #include "logic/tool_actions.h"
+#include "logic/tool_scheduler.h"
+#include "logic/tool_statistics.h"
 #include "tool_editor_widget.h"
 #include "ui_mainwindow.h"
 
+#include <QDockWidget>
 #include <QFile>
 #include <QFileDialog>
 #include <QFont>
 #include <QFontDialog>
 #include <QFontMetrics>
+#include <QInputDialog>
+#include <QLineEdit>
+#include <QPlainTextEdit>
+#include <QStatusBar>
+#include <QTextBlock>
+#include <algorithm>
+#include <regex>
 
 static MainWindow *main_window{};
 
@@ -18,24 +30,36 @@ MainWindow::MainWindow(QWidget *parent)
 	, ui{std::make_unique<Ui::MainWindow>()} {
 	main_window = this;
 	ui->setupUi(this);
+	console_dock = new QDockWidget{tr("Console"), this};
+	console_dock->setObjectName("console_dock");
+	console = new Console_widget{console_dock};
+	console->set_max_line_count(std::max(1, Settings::get<Settings::Key::console_scrollback_lines>(Console_buffer::default_max_line_count)));
+	console->set_diagnostic_handler([this](const Diagnostic &diagnostic) { open_diagnostic_location(diagnostic); });
+	console_dock->setWidget(console);
+	addDockWidget(Qt::BottomDockWidgetArea, console_dock);
+	console_dock->hide();
+	ui->menu_Tools->addAction(console_dock->toggleViewAction());
 	load_last_files();
-	Tool_actions::set_actions(Settings::get<Settings::Key::tools>());
+	const auto tools = Settings::get<Settings::Key::tools>();
+	Tool_actions::set_actions(tools);
+	Tool_scheduler::set_tools(tools);
 }
 
 MainWindow::~MainWindow() { //required for destructors of otherwise incomplete type Ui::MainWindow
+	Tool_actions::stop_running_tools();
+	Tool_scheduler::stop();
 	save_last_files();
 }
 
 Edit_window *MainWindow::get_current_edit_window() {
+	if (main_window == nullptr) {
+		return nullptr;
+	}
 	return dynamic_cast<Edit_window *>(main_window->ui->file_tabs->currentWidget());
 }
 
 QString MainWindow::get_current_path() {
-	if (main_window == nullptr) {
-		return {};
-	}
-	const auto tab_bar = main_window->ui->file_tabs->tabBar();
-	return tab_bar->tabText(tab_bar->currentIndex());
+	return get_path(nullptr);
 }
 
 MainWindow *MainWindow::get_main_window() {
@@ -43,16 +67,52 @@ MainWindow *MainWindow::get_main_window() {
 }
 
 QString MainWindow::get_current_selection() {
+	return get_selection(nullptr);
+}
+
+QString MainWindow::get_path(const Edit_window *edit_window) {
 	if (main_window == nullptr) {
 		return {};
 	}
-	auto edit_window = dynamic_cast<Edit_window *>(main_window->ui->file_tabs->currentWidget());
+	const auto file_tabs = main_window->ui->file_tabs;
+	const auto index = edit_window == nullptr ? file_tabs->currentIndex() : file_tabs->indexOf(const_cast<Edit_window *>(edit_window));
+	return file_tabs->tabBar()->tabText(index);
+}
+
+QString MainWindow::get_selection(const Edit_window *edit_window) {
+	if (main_window == nullptr) {
+		return {};
+	}
+	if (edit_window == nullptr) {
+		edit_window = dynamic_cast<Edit_window *>(main_window->ui->file_tabs->currentWidget());
+	}
 	if (edit_window == nullptr) {
 		return {};
 	}
 	return edit_window->textCursor().selectedText().replace("\u2029", "\n");
 }
 
+QString MainWindow::get_document_version(const Edit_window *edit_window) {
+	if (main_window == nullptr) {
+		return {};
+	}
+	if (edit_window == nullptr) {
+		edit_window = dynamic_cast<Edit_window *>(main_window->ui->file_tabs->currentWidget());
+	}
+	if (edit_window == nullptr) {
+		return {};
+	}
+	return QString::number(edit_window->document()->revision());
+}
+
+Console_widget *MainWindow::show_console() {
+	if (main_window == nullptr) {
+		return nullptr;
+	}
+	main_window->console_dock->show();
+	return main_window->console;
+}
+
 void MainWindow::on_actionOpen_File_triggered() {
 	for (const auto &filename : QFileDialog::getOpenFileNames(this, tr("Select File(s) to open"))) {
 		add_file_tab(filename);
@@ -103,10 +163,32 @@ void MainWindow::add_file_tab(const QString &filename) {
 	file_edit->setFont(font);
 	file_edit->setTabStopWidth(QFontMetrics{font}.width("    "));
 	file_edit->setLineWrapMode(Edit_window::LineWrapMode::NoWrap);
+	connect(file_edit.get(), &Edit_window::textChanged, [edit_window = file_edit.get()] { Tool_scheduler::file_edited(edit_window); });
 	auto index = ui->file_tabs->addTab(file_edit.release(), filename);
 	ui->file_tabs->setTabToolTip(index, filename);
 }
 
+void MainWindow::open_diagnostic_location(const Diagnostic &diagnostic) {
+	add_file_tab(QString::fromStdString(diagnostic.file));
+	for (int tab_index = 0; tab_index < ui->file_tabs->count(); tab_index++) {
+		if (ui->file_tabs->tabText(tab_index) == QString::fromStdString(diagnostic.file)) {
+			ui->file_tabs->setCurrentIndex(tab_index);
+		}
+	}
+	const auto edit = get_current_edit_window();
+	if (edit == nullptr) {
+		return;
+	}
+	const auto block = edit->document()->findBlockByNumber(diagnostic.line - 1);
+	if (block.isValid()) {
+		QTextCursor cursor{block};
+		cursor.movePosition(QTextCursor::Right, QTextCursor::MoveAnchor, std::clamp(diagnostic.column - 1, 0, block.length() - 1));
+		edit->setTextCursor(cursor);
+	}
+	edit->setFocus();
+	statusBar()->showMessage(QString::fromStdString(diagnostic.message));
+}
+
 void MainWindow::apply_to_all_edit_windows(const std::function<void(Edit_window *)> &function) {
 	for (int tab_index = 0; tab_index < ui->file_tabs->count(); tab_index++) {
 		auto edit = dynamic_cast<Edit_window *>(ui->file_tabs->widget(tab_index));
@@ -132,3 +214,45 @@ void MainWindow::on_action_Edit_triggered() {
 		tool_editor_widget->show();
 	}
 }
+
+void MainWindow::on_action_Cancel_running_tools_triggered() {
+	Tool_actions::cancel_running_tools();
+}
+
+void MainWindow::on_action_Tool_statistics_triggered() {
+	show_report(tr("Tool Statistics"), Tool_statistics::get_report());
+}
+
+void MainWindow::on_action_Search_tool_output_triggered() {
+	bool success;
+	const auto pattern = QInputDialog::getText(this, tr("Search Tool Output"), tr("Regular expression:"), QLineEdit::Normal, {}, &success);
+	if (success == false || pattern.isEmpty()) {
+		return;
+	}
+	const auto &search = Tool_actions::get_output_search();
+	QString report;
+	try {
+		for (const auto &match : search.find_regex(pattern.toStdString(), Output_search::Case::insensitive)) {
+			report += QString::fromStdString(search.get_run_name(match.run)) + ": " +
+					  QString::fromUtf8(match.text.data(), static_cast<int>(match.text.size())) + '\n';
+		}
+	} catch (const std::regex_error &error) {
+		report = tr("Invalid regular expression: %1").arg(error.what());
+	}
+	show_report(tr("Tool Output Matching %1").arg(pattern), report.isEmpty() ? tr("No matches") : report);
+}
+
+void MainWindow::show_report(const QString &title, const QString &text) {
+	auto report = new QPlainTextEdit(this);
+	report->setAttribute(Qt::WA_DeleteOnClose);
+	report->setWindowFlag(Qt::WindowType::Window);
+	report->setWindowTitle(title);
+	report->setReadOnly(true);
+	report->setLineWrapMode(QPlainTextEdit::LineWrapMode::NoWrap);
+	QFont font;
+	font.fromString(Settings::get<Settings::Key::font>("monospace"));
+	report->setFont(font);
+	report->setPlainText(text);
+	report->resize(size() * 3 / 4);
+	report->show();
+}
@@ -9,7 +9,10 @@ namespace Ui {
 	class MainWindow;
 }
 
+class Console_widget;
+struct Diagnostic;
 class Edit_window;
+class QDockWidget;
 class Tool_editor_widget;
 
 class MainWindow : public QMainWindow {
@@ -22,22 +25,36 @@ class MainWindow : public QMainWindow {
 	static QString get_current_path();
 	static MainWindow *get_main_window();
 	static QString get_current_selection();
+	//path and selection of edit_window, or of the current edit window if edit_window is nullptr
+	static QString get_path(const Edit_window *edit_window);
+	static QString get_selection(const Edit_window *edit_window);
+	//revision of the document of edit_window, semantic highlighting tools report it back with their tokens
+	static QString get_document_version(const Edit_window *edit_window);
+	//makes the console dock visible, nullptr if there is no main window
+	static Console_widget *show_console();
 
 	private slots:
 	void on_actionOpen_File_triggered();
 	void on_action_Font_triggered();
 	void on_file_tabs_tabCloseRequested(int index);
 	void on_action_Edit_triggered();
+	void on_action_Cancel_running_tools_triggered();
+	void on_action_Tool_statistics_triggered();
+	void on_action_Search_tool_output_triggered();
 	void closeEvent(QCloseEvent *event) override;
 
 	private:
 	void load_last_files();
 	void save_last_files();
 	void add_file_tab(const QString &filename);
+	void open_diagnostic_location(const Diagnostic &diagnostic);
+	void show_report(const QString &title, const QString &text); //in a read only window of its own
 	void apply_to_all_edit_windows(const std::function<void(Edit_window *)> &function);
 
 	std::unique_ptr<Ui::MainWindow> ui;
 	std::unique_ptr<Tool_editor_widget> tool_editor_widget;
+	QDockWidget *console_dock{};
+	Console_widget *console{};
 
 	private:
 	Ui::MainWindow *_; //Qt Designer only works correctly if it finds this string
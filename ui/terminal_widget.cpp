@@ -0,0 +1,205 @@
+#include "terminal_widget.h"
+#include "logic/process_reader.h"
+#include "logic/settings.h"
+
+#include <QCloseEvent>
+#include <QFont>
+#include <QFontMetrics>
+#include <QKeyEvent>
+#include <QPainter>
+#include <QPaintEvent>
+#include <algorithm>
+#include <utility>
+
+//what a key sends to the tool, the same as xterm
+static std::string get_key_input(const QKeyEvent &event, bool application_cursor_keys) {
+	const auto cursor_key = [application_cursor_keys](char key) { return std::string{application_cursor_keys ? "\033O" : "\033["} + key; };
+	switch (event.key()) {
+		case Qt::Key_Up:
+			return cursor_key('A');
+		case Qt::Key_Down:
+			return cursor_key('B');
+		case Qt::Key_Right:
+			return cursor_key('C');
+		case Qt::Key_Left:
+			return cursor_key('D');
+		case Qt::Key_Home:
+			return cursor_key('H');
+		case Qt::Key_End:
+			return cursor_key('F');
+		case Qt::Key_Insert:
+			return "\033[2~";
+		case Qt::Key_Delete:
+			return "\033[3~";
+		case Qt::Key_PageUp:
+			return "\033[5~";
+		case Qt::Key_PageDown:
+			return "\033[6~";
+		case Qt::Key_Backspace:
+			return "\x7f";
+		case Qt::Key_Return:
+		case Qt::Key_Enter:
+			return "\r";
+		case Qt::Key_Tab:
+			return "\t";
+		case Qt::Key_Escape:
+			return "\033";
+		case Qt::Key_F1:
+			return "\033OP";
+		case Qt::Key_F2:
+			return "\033OQ";
+		case Qt::Key_F3:
+			return "\033OR";
+		case Qt::Key_F4:
+			return "\033OS";
+		case Qt::Key_F5:
+			return "\033[15~";
+		case Qt::Key_F6:
+			return "\033[17~";
+		case Qt::Key_F7:
+			return "\033[18~";
+		case Qt::Key_F8:
+			return "\033[19~";
+		case Qt::Key_F9:
+			return "\033[20~";
+		case Qt::Key_F10:
+			return "\033[21~";
+		case Qt::Key_F11:
+			return "\033[23~";
+		case Qt::Key_F12:
+			return "\033[24~";
+	}
+	auto text = event.text().toStdString(); //control characters such as Ctrl+C are already in the text
+	if (!text.empty() && (event.modifiers() & Qt::AltModifier)) {
+		text.insert(0, 1, '\033');
+	}
+	return text;
+}
+
+Terminal_widget::Terminal_widget(QWidget *parent)
+	: QWidget{parent} {
+	QFont font;
+	font.fromString(Settings::get<Settings::Key::font>("monospace"));
+	setFont(font);
+	const QFontMetrics metrics{font};
+	cell_width = std::max(1, metrics.horizontalAdvance("M"));
+	cell_height = std::max(1, metrics.lineSpacing());
+	setFocusPolicy(Qt::StrongFocus);
+}
+
+void Terminal_widget::set_process_reader(Process_reader *process_reader) {
+	this->process_reader = process_reader;
+	if (process_reader) {
+		process_reader->set_terminal_size(screen.get_rows(), screen.get_columns());
+	}
+}
+
+void Terminal_widget::feed(std::string_view output) {
+	screen.feed(output);
+	if (auto responses = screen.take_responses(); !responses.empty()) {
+		send(std::move(responses));
+	}
+	const auto &damage = screen.get_damage();
+	for (int row = 0; row < static_cast<int>(damage.size()); row++) {
+		if (damage[row].first_column != damage[row].end_column) {
+			update(get_cells_rect(row, damage[row].first_column, damage[row].end_column));
+		}
+	}
+	screen.clear_damage();
+}
+
+const Terminal_screen &Terminal_widget::get_screen() const {
+	return screen;
+}
+
+void Terminal_widget::paintEvent(QPaintEvent *event) {
+	QPainter painter{this};
+	const auto area = event->rect();
+	const auto background_color = palette().color(QPalette::Base);
+	const auto text_color = palette().color(QPalette::Text);
+	painter.fillRect(area, background_color);
+	const QFontMetrics metrics{font()};
+	const auto first_row = std::max(0, area.top() / cell_height);
+	const auto end_row = std::min(screen.get_rows(), area.bottom() / cell_height + 1);
+	const auto first_column = std::max(0, area.left() / cell_width);
+	const auto end_column = std::min(screen.get_columns(), area.right() / cell_width + 1);
+	const auto is_cursor = [this](int row, int column) {
+		return screen.is_cursor_visible() && row == screen.get_cursor_row() && column == screen.get_cursor_column();
+	};
+	std::u32string characters;
+	for (int row = first_row; row < end_row; row++) {
+		//cells with the same attributes are drawn together, the cursor is a run of its own
+		for (int column = first_column, run_end; column < end_column; column = run_end) {
+			const auto &attributes = screen.get_cell(row, column).attributes;
+			const bool cursor = is_cursor(row, column);
+			characters.assign(1, screen.get_cell(row, column).character);
+			for (run_end = column + 1; !cursor && run_end < end_column; run_end++) {
+				const auto &cell = screen.get_cell(row, run_end);
+				if (cell.attributes != attributes || is_cursor(row, run_end)) {
+					break;
+				}
+				characters += cell.character;
+			}
+			auto [foreground, background] = attributes.get_colors(text_color.rgb(), background_color.rgb());
+			if (cursor) {
+				foreground = std::exchange(background, foreground.value_or(text_color.rgb())).value_or(background_color.rgb());
+			}
+			const auto cells_rect = get_cells_rect(row, column, run_end);
+			if (background) {
+				painter.fillRect(cells_rect, QColor::fromRgb(*background));
+			}
+			QFont run_font = font();
+			run_font.setBold(attributes.has(Sgr_attributes::bold));
+			run_font.setItalic(attributes.has(Sgr_attributes::italic));
+			run_font.setUnderline(attributes.has(Sgr_attributes::underline));
+			run_font.setStrikeOut(attributes.has(Sgr_attributes::crossed_out));
+			run_font.setOverline(attributes.has(Sgr_attributes::overline));
+			painter.setPen(foreground ? QColor::fromRgb(*foreground) : text_color);
+			painter.setFont(run_font);
+			painter.drawText(cells_rect.left(), cells_rect.top() + metrics.ascent(), QString::fromUcs4(characters.data(), static_cast<int>(characters.size())));
+		}
+	}
+}
+
+void Terminal_widget::resizeEvent(QResizeEvent *) {
+	const auto rows = std::max(1, height() / cell_height);
+	const auto columns = std::max(1, width() / cell_width);
+	if (rows != screen.get_rows() || columns != screen.get_columns()) {
+		screen.resize(rows, columns);
+		screen.clear_damage();
+		if (process_reader) {
+			process_reader->set_terminal_size(rows, columns);
+		}
+	}
+	update();
+}
+
+void Terminal_widget::keyPressEvent(QKeyEvent *event) {
+	auto input = get_key_input(*event, screen.is_application_cursor_keys());
+	if (input.empty()) {
+		QWidget::keyPressEvent(event);
+		return;
+	}
+	send(std::move(input));
+}
+
+bool Terminal_widget::focusNextPrevChild(bool) {
+	return false;
+}
+
+void Terminal_widget::closeEvent(QCloseEvent *event) {
+	if (process_reader) {
+		process_reader->kill();
+	}
+	event->accept();
+}
+
+QRect Terminal_widget::get_cells_rect(int row, int first_column, int end_column) const {
+	return {first_column * cell_width, row * cell_height, (end_column - first_column) * cell_width, cell_height};
+}
+
+void Terminal_widget::send(std::string input) {
+	if (process_reader) {
+		process_reader->write_terminal_input(std::move(input));
+	}
+}
@@ -0,0 +1,38 @@
+#ifndef TERMINAL_WIDGET_H
+#define TERMINAL_WIDGET_H
+
+#include "logic/terminal_screen.h"
+
+#include <QWidget>
+#include <string_view>
+
+class Process_reader;
+
+//Window for a tool running in a pseudo terminal. Output goes into a Terminal_screen and only the cells it changed are repainted,
+//keystrokes and size changes go back to the tool.
+class Terminal_widget : public QWidget {
+	Q_OBJECT
+	public:
+	Terminal_widget(QWidget *parent = nullptr);
+
+	//process_reader must stay alive until it is replaced, set it to nullptr once the tool finished
+	void set_process_reader(Process_reader *process_reader);
+	void feed(std::string_view output);
+	const Terminal_screen &get_screen() const;
+
+	private:
+	void paintEvent(QPaintEvent *event) override;
+	void resizeEvent(QResizeEvent *event) override;
+	void keyPressEvent(QKeyEvent *event) override;
+	bool focusNextPrevChild(bool next) override; //so Tab goes to the tool instead of moving the focus
+	void closeEvent(QCloseEvent *event) override;
+	QRect get_cells_rect(int row, int first_column, int end_column) const;
+	void send(std::string input);
+
+	Terminal_screen screen;
+	Process_reader *process_reader{};
+	int cell_width;
+	int cell_height;
+};
+
+#endif // TERMINAL_WIDGET_H
@@ -90,7 +90,7 @@ Tool_editor_widget::Tool_editor_widget(QWidget *parent)
 	ui->setupUi(this);
 	load_tools_from_settings();
 	fill_combobox<Tool_output_target::get_texts>(ui->output_comboBox);
-	fill_combobox<Tool_output_target::get_texts>(ui->errors_comboBox);
+	fill_combobox<Tool_output_target::get_error_texts>(ui->errors_comboBox);
 	fill_combobox<Tool_activation::get_texts>(ui->activation_comboBox);
 	update_tools_list();
 	ui->splitter->setSizes({1, 1});
@@ -0,0 +1,36 @@
+#include "binary_io.h"
+
+#include <stdexcept>
+
+void Utility::Binary_writer::write_string(std::string_view text) {
+	write<std::uint64_t>(text.size());
+	data += text;
+}
+
+const std::string &Utility::Binary_writer::get_data() const {
+	return data;
+}
+
+Utility::Binary_reader::Binary_reader(std::string_view data)
+	: data{data} {}
+
+std::string Utility::Binary_reader::read_string() {
+	const auto size = read<std::uint64_t>();
+	if (size > data.size()) {
+		throw std::runtime_error{"Binary data ends in the middle of a string"};
+	}
+	return std::string{get(static_cast<std::size_t>(size))};
+}
+
+bool Utility::Binary_reader::is_at_end() const {
+	return data.empty();
+}
+
+std::string_view Utility::Binary_reader::get(std::size_t size) {
+	if (size > data.size()) {
+		throw std::runtime_error{"Binary data ends early"};
+	}
+	const auto value = data.substr(0, size);
+	data.remove_prefix(size);
+	return value;
+}
@@ -0,0 +1,49 @@
+#ifndef BINARY_IO_H
+#define BINARY_IO_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+namespace Utility {
+	//Writes values for caches that never leave the machine, so integers are stored as they are in memory. Strings are stored with their size first.
+	class Binary_writer {
+		public:
+		template <class T>
+		void write(T value) {
+			static_assert(std::is_arithmetic_v<T> || std::is_enum_v<T>);
+			data.append(reinterpret_cast<const char *>(&value), sizeof value);
+		}
+		void write_string(std::string_view text);
+		const std::string &get_data() const;
+
+		private:
+		std::string data;
+	};
+
+	//Reads what Binary_writer wrote, throws std::runtime_error when the data ends early
+	class Binary_reader {
+		public:
+		Binary_reader(std::string_view data);
+
+		template <class T>
+		T read() {
+			static_assert(std::is_arithmetic_v<T> || std::is_enum_v<T>);
+			T value;
+			std::memcpy(&value, get(sizeof value).data(), sizeof value);
+			return value;
+		}
+		std::string read_string();
+		bool is_at_end() const;
+
+		private:
+		std::string_view get(std::size_t size);
+
+		std::string_view data;
+	};
+} // namespace Utility
+
+#endif // BINARY_IO_H
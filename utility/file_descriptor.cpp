@@ -0,0 +1 @@
+#include "file_descriptor.h"
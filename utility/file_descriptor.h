@@ -0,0 +1,33 @@
+#ifndef FILE_DESCRIPTOR_H
+#define FILE_DESCRIPTOR_H
+
+#include "unique_handle.h"
+
+#include <stdexcept>
+#include <unistd.h>
+
+namespace Utility {
+	struct File_descriptor_policy {
+		using Handle_type = int;
+
+		constexpr static auto invalid_file_descriptor = -1;
+
+		constexpr static Handle_type get_null() {
+			return invalid_file_descriptor;
+		}
+
+		constexpr static bool is_null(int file_descriptor) {
+			return file_descriptor == invalid_file_descriptor;
+		}
+
+		static void close(int file_descriptor) {
+			if (::close(file_descriptor) != 0) {
+				throw std::runtime_error("Failed to close file descriptor");
+			}
+		}
+	};
+
+	using File_descriptor = Unique_handle<File_descriptor_policy>;
+} // namespace Utility
+
+#endif // FILE_DESCRIPTOR_H
@@ -0,0 +1,185 @@
+#include "reactor.h"
+
+#include <array>
+#include <cassert>
+#include <cerrno>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+
+using namespace std::string_literals;
+
+//epoll data of the wake up event, registrations use the file descriptor in the lower and the generation in the upper 32 bits
+constexpr auto wake_up_id = std::numeric_limits<std::uint64_t>::max();
+
+static std::uint64_t to_epoll_data(int file_descriptor, std::uint32_t generation) {
+	return std::uint64_t{generation} << 32 | static_cast<std::uint32_t>(file_descriptor);
+}
+
+Utility::Reactor &Utility::Reactor::get() {
+	static Reactor reactor;
+	return reactor;
+}
+
+Utility::Reactor::Reactor()
+	: epoll{epoll_create1(EPOLL_CLOEXEC)}
+	, wake_up_event{eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK)} {
+	if (!epoll || !wake_up_event) {
+		throw std::runtime_error("Failed creating reactor: "s + strerror(errno));
+	}
+	epoll_event event{};
+	event.events = EPOLLIN;
+	event.data.u64 = wake_up_id;
+	if (epoll_ctl(epoll.get(), EPOLL_CTL_ADD, wake_up_event.get(), &event) != 0) {
+		throw std::runtime_error("Failed watching reactor wake up event: "s + strerror(errno));
+	}
+	thread = std::thread{&Reactor::run, this};
+}
+
+Utility::Reactor::~Reactor() {
+	post([this] { running = false; });
+	thread.join();
+}
+
+void Utility::Reactor::add(int file_descriptor, std::uint32_t events, Handler handler) {
+	assert(is_reactor_thread());
+	auto &registration = registrations[file_descriptor];
+	registration.generation = ++generation;
+	registration.handler = std::make_shared<Handler>(std::move(handler));
+	epoll_event event{};
+	event.events = events;
+	event.data.u64 = to_epoll_data(file_descriptor, registration.generation);
+	if (epoll_ctl(epoll.get(), EPOLL_CTL_ADD, file_descriptor, &event) != 0) {
+		registrations.erase(file_descriptor);
+		throw std::runtime_error("Failed watching file descriptor: "s + strerror(errno));
+	}
+}
+
+void Utility::Reactor::modify(int file_descriptor, std::uint32_t events) {
+	assert(is_reactor_thread());
+	const auto registration = registrations.find(file_descriptor);
+	assert(registration != std::end(registrations)); //if this assert fails the file descriptor was not added
+	epoll_event event{};
+	event.events = events;
+	event.data.u64 = to_epoll_data(file_descriptor, registration->second.generation);
+	if (epoll_ctl(epoll.get(), EPOLL_CTL_MOD, file_descriptor, &event) != 0) {
+		throw std::runtime_error("Failed modifying watched file descriptor: "s + strerror(errno));
+	}
+}
+
+void Utility::Reactor::remove(int file_descriptor) {
+	assert(is_reactor_thread());
+	if (registrations.erase(file_descriptor) == 0) {
+		return;
+	}
+	//closing the last file descriptor of a file already removes it from the epoll set, so EBADF and ENOENT are fine
+	if (epoll_ctl(epoll.get(), EPOLL_CTL_DEL, file_descriptor, nullptr) != 0 && errno != EBADF && errno != ENOENT) {
+		throw std::runtime_error("Failed removing watched file descriptor: "s + strerror(errno));
+	}
+}
+
+Utility::Reactor::Timer_id Utility::Reactor::add_timer(Clock::time_point deadline, std::function<void()> callback) {
+	assert(is_reactor_thread());
+	const auto timer_id = ++next_timer_id;
+	timers.emplace(std::make_pair(deadline, timer_id), std::move(callback));
+	timer_deadlines.emplace(timer_id, deadline);
+	return timer_id;
+}
+
+void Utility::Reactor::remove_timer(Timer_id timer_id) {
+	assert(is_reactor_thread());
+	const auto deadline = timer_deadlines.find(timer_id);
+	if (deadline == std::end(timer_deadlines)) { //already expired
+		return;
+	}
+	timers.erase({deadline->second, timer_id});
+	timer_deadlines.erase(deadline);
+}
+
+void Utility::Reactor::post(std::function<void()> function) {
+	{
+		std::lock_guard lock{posted_mutex};
+		posted.push_back(std::move(function));
+	}
+	const std::uint64_t one = 1;
+	if (::write(wake_up_event.get(), &one, sizeof one) != sizeof one && errno != EAGAIN) {
+		throw std::runtime_error("Failed waking up reactor: "s + strerror(errno));
+	}
+}
+
+bool Utility::Reactor::is_reactor_thread() const {
+	return std::this_thread::get_id() == thread.get_id();
+}
+
+std::size_t Utility::Reactor::get_watched_count() const {
+	assert(is_reactor_thread());
+	return registrations.size();
+}
+
+void Utility::Reactor::run() {
+	std::array<epoll_event, 64> events;
+	while (running) {
+		const auto event_count = epoll_wait(epoll.get(), events.data(), events.size(), get_wait_timeout());
+		if (event_count == -1) {
+			if (errno == EINTR) {
+				continue;
+			}
+			throw std::runtime_error("Waiting for file descriptors failed: "s + strerror(errno));
+		}
+		for (int event_index = 0; event_index < event_count; event_index++) {
+			const auto &event = events[event_index];
+			if (event.data.u64 == wake_up_id) {
+				run_posted();
+				continue;
+			}
+			const auto file_descriptor = static_cast<int>(event.data.u64 & 0xffffffff);
+			const auto registration = registrations.find(file_descriptor);
+			if (registration == std::end(registrations) || registration->second.generation != event.data.u64 >> 32) {
+				continue; //removed by a previous handler in this batch, possibly reused for a different file already
+			}
+			//keep the handler alive even if it removes itself
+			const auto handler = registration->second.handler;
+			(*handler)(event.events);
+		}
+		run_expired_timers();
+	}
+}
+
+void Utility::Reactor::run_posted() {
+	std::uint64_t count;
+	while (::read(wake_up_event.get(), &count, sizeof count) > 0) {
+	}
+	std::vector<std::function<void()>> functions;
+	{
+		std::lock_guard lock{posted_mutex};
+		functions.swap(posted);
+	}
+	for (auto &function : functions) {
+		function();
+	}
+}
+
+void Utility::Reactor::run_expired_timers() {
+	const auto now = Clock::now();
+	while (timers.empty() == false && timers.begin()->first.first <= now) {
+		auto callback = std::move(timers.begin()->second);
+		timer_deadlines.erase(timers.begin()->first.second);
+		timers.erase(timers.begin());
+		callback();
+	}
+}
+
+int Utility::Reactor::get_wait_timeout() const {
+	if (timers.empty()) {
+		return -1;
+	}
+	const auto time_left = timers.begin()->first.first - Clock::now();
+	if (time_left <= Clock::duration::zero()) {
+		return 0;
+	}
+	//round up so we don't wake up just before the deadline and spin
+	return static_cast<int>(std::chrono::ceil<std::chrono::milliseconds>(time_left).count());
+}
@@ -0,0 +1,69 @@
+#ifndef REACTOR_H
+#define REACTOR_H
+
+#include "file_descriptor.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace Utility {
+	/* A single epoll event loop that owns the file descriptors of all running tools and dispatches their readiness to handlers.
+	 * Handlers and timers always run in the reactor thread, so no matter how many tools run there is only one thread waiting on them.
+	 * add, modify, remove, add_timer and remove_timer must be called from the reactor thread. Use post to get there from other threads. */
+	class Reactor {
+		public:
+		using Clock = std::chrono::steady_clock;
+		using Handler = std::function<void(std::uint32_t events)>; //events is a combination of EPOLLIN, EPOLLOUT, EPOLLHUP and EPOLLERR
+		using Timer_id = std::uint64_t;
+
+		//the reactor shared by all Process_readers, started on first use
+		static Reactor &get();
+
+		Reactor();
+		Reactor(const Reactor &) = delete;
+		~Reactor();
+
+		void add(int file_descriptor, std::uint32_t events, Handler handler);
+		void modify(int file_descriptor, std::uint32_t events);
+		void remove(int file_descriptor);
+		Timer_id add_timer(Clock::time_point deadline, std::function<void()> callback);
+		void remove_timer(Timer_id timer_id);
+
+		void post(std::function<void()> function);
+		bool is_reactor_thread() const;
+		std::size_t get_watched_count() const;
+
+		private:
+		struct Registration {
+			std::uint32_t generation;
+			std::shared_ptr<Handler> handler;
+		};
+
+		void run();
+		void run_posted();
+		void run_expired_timers();
+		int get_wait_timeout() const;
+
+		File_descriptor epoll;
+		File_descriptor wake_up_event;
+		std::unordered_map<int, Registration> registrations;
+		std::uint32_t generation{};
+		std::map<std::pair<Clock::time_point, Timer_id>, std::function<void()>> timers;
+		std::unordered_map<Timer_id, Clock::time_point> timer_deadlines;
+		Timer_id next_timer_id{};
+		std::mutex posted_mutex;
+		std::vector<std::function<void()>> posted;
+		std::atomic<bool> running{true};
+		std::thread thread;
+	};
+} // namespace Utility
+
+#endif // REACTOR_H
@@ -0,0 +1,54 @@
+#include "ring_buffer.h"
+
+#include <cassert>
+
+Utility::Ring_buffer::Ring_buffer(std::size_t capacity)
+	: buffer{std::make_unique<char[]>(capacity)}
+	, capacity{capacity} {
+	assert(capacity > 0);
+}
+
+std::size_t Utility::Ring_buffer::get_capacity() const {
+	return capacity;
+}
+
+std::size_t Utility::Ring_buffer::get_size() const {
+	return size;
+}
+
+std::size_t Utility::Ring_buffer::get_free_space() const {
+	return capacity - size;
+}
+
+bool Utility::Ring_buffer::is_empty() const {
+	return size == 0;
+}
+
+std::array<Utility::Ring_buffer::Region, 2> Utility::Ring_buffer::get_free_regions() {
+	const auto end = (begin + size) % capacity;
+	if (size == capacity) {
+		return {Region{buffer.get() + end, 0}, Region{buffer.get(), 0}};
+	}
+	if (end >= begin) {
+		return {Region{buffer.get() + end, capacity - end}, Region{buffer.get(), begin}};
+	}
+	return {Region{buffer.get() + end, begin - end}, Region{buffer.get(), 0}};
+}
+
+void Utility::Ring_buffer::commit(std::size_t bytes) {
+	assert(bytes <= get_free_space());
+	size += bytes;
+}
+
+std::array<std::string_view, 2> Utility::Ring_buffer::get_data() const {
+	if (begin + size <= capacity) {
+		return {std::string_view{buffer.get() + begin, size}, std::string_view{}};
+	}
+	return {std::string_view{buffer.get() + begin, capacity - begin}, std::string_view{buffer.get(), begin + size - capacity}};
+}
+
+void Utility::Ring_buffer::consume(std::size_t bytes) {
+	assert(bytes <= size);
+	begin = (begin + bytes) % capacity;
+	size -= bytes;
+}
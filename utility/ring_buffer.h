@@ -0,0 +1,42 @@
+#ifndef RING_BUFFER_H
+#define RING_BUFFER_H
+
+#include <array>
+#include <cstddef>
+#include <memory>
+#include <string_view>
+
+namespace Utility {
+	//Fixed capacity byte buffer that wraps around. It is filled through its free regions (for example with readv) and drained as string_views,
+	//so data passes through without being copied or allocated.
+	class Ring_buffer {
+		public:
+		struct Region {
+			char *data;
+			std::size_t size;
+		};
+
+		Ring_buffer(std::size_t capacity);
+
+		std::size_t get_capacity() const;
+		std::size_t get_size() const;
+		std::size_t get_free_space() const;
+		bool is_empty() const;
+
+		//free space in write order, the second region is empty unless the free space wraps around the end of the buffer
+		std::array<Region, 2> get_free_regions();
+		//marks bytes written into the free regions as data
+		void commit(std::size_t bytes);
+		//data in read order, the second view is empty unless the data wraps around the end of the buffer
+		std::array<std::string_view, 2> get_data() const;
+		void consume(std::size_t bytes);
+
+		private:
+		std::unique_ptr<char[]> buffer;
+		std::size_t capacity;
+		std::size_t begin{};
+		std::size_t size{};
+	};
+} // namespace Utility
+
+#endif // RING_BUFFER_H
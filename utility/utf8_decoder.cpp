@@ -0,0 +1,90 @@
+#include "utf8_decoder.h"
+
+#include <array>
+#include <cstdint>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+namespace {
+	//what a lead byte needs to be followed by, the range of the first continuation byte excludes overlong encodings, surrogates and code points
+	//above U+10FFFF so that every other continuation byte is just 0x80 to 0xBF
+	struct Lead_byte {
+		std::uint8_t continuation_count;
+		std::uint8_t first_min;
+		std::uint8_t first_max;
+		std::uint8_t value_mask;
+	};
+
+	constexpr std::array<Lead_byte, 256> create_lead_bytes() {
+		std::array<Lead_byte, 256> lead_bytes{}; //invalid lead bytes have no continuations
+		for (int c = 0xC2; c <= 0xDF; c++) {
+			lead_bytes[c] = {1, 0x80, 0xBF, 0x1F};
+		}
+		for (int c = 0xE0; c <= 0xEF; c++) {
+			lead_bytes[c] = {2, std::uint8_t(c == 0xE0 ? 0xA0 : 0x80), std::uint8_t(c == 0xED ? 0x9F : 0xBF), 0x0F};
+		}
+		for (int c = 0xF0; c <= 0xF4; c++) {
+			lead_bytes[c] = {3, std::uint8_t(c == 0xF0 ? 0x90 : 0x80), std::uint8_t(c == 0xF4 ? 0x8F : 0xBF), 0x07};
+		}
+		return lead_bytes;
+	}
+	constexpr auto lead_bytes = create_lead_bytes();
+	constexpr char16_t replacement_character = 0xFFFD;
+} // namespace
+
+std::size_t Utility::decode_utf8(std::string_view utf8, char16_t *out) {
+	auto in = reinterpret_cast<const unsigned char *>(utf8.data());
+	const auto end = in + utf8.size();
+	const auto out_begin = out;
+	while (in != end) {
+#ifdef __SSE2__
+		if (end - in >= 16) {
+			const auto bytes = _mm_loadu_si128(reinterpret_cast<const __m128i *>(in));
+			const auto non_ascii = static_cast<unsigned int>(_mm_movemask_epi8(bytes));
+			//writing 16 code units is fine even if fewer of them are ASCII, the output has room for one per remaining input byte
+			const auto zero = _mm_setzero_si128();
+			_mm_storeu_si128(reinterpret_cast<__m128i *>(out), _mm_unpacklo_epi8(bytes, zero));
+			_mm_storeu_si128(reinterpret_cast<__m128i *>(out + 8), _mm_unpackhi_epi8(bytes, zero));
+			const auto ascii_count = non_ascii == 0 ? 16 : __builtin_ctz(non_ascii);
+			in += ascii_count;
+			out += ascii_count;
+			if (ascii_count == 16) {
+				continue;
+			}
+		}
+#endif
+		const auto lead = *in;
+		if (lead < 0x80) {
+			*out++ = lead;
+			in++;
+			continue;
+		}
+		const auto &info = lead_bytes[lead];
+		//stray continuation bytes and invalid lead bytes have no continuations and are replaced on their own
+		if (info.continuation_count == 0 || end - in < 2 || in[1] < info.first_min || in[1] > info.first_max) {
+			*out++ = replacement_character;
+			in++;
+			continue;
+		}
+		char32_t code_point = (lead & info.value_mask) << 6 | (in[1] & 0x3F);
+		int length = 2;
+		for (; length <= info.continuation_count && in + length < end && (in[length] & 0xC0) == 0x80; length++) {
+			code_point = code_point << 6 | (in[length] & 0x3F);
+		}
+		if (length <= info.continuation_count) { //truncated, the bytes so far are the maximal invalid sequence
+			*out++ = replacement_character;
+			in += length;
+			continue;
+		}
+		in += length;
+		if (code_point >= 0x10000) {
+			*out++ = static_cast<char16_t>(0xD800 + ((code_point - 0x10000) >> 10));
+			*out++ = static_cast<char16_t>(0xDC00 + ((code_point - 0x10000) & 0x3FF));
+		} else {
+			*out++ = static_cast<char16_t>(code_point);
+		}
+	}
+	return static_cast<std::size_t>(out - out_begin);
+}
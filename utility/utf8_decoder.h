@@ -0,0 +1,15 @@
+#ifndef UTF8_DECODER_H
+#define UTF8_DECODER_H
+
+#include <cstddef>
+#include <string_view>
+
+namespace Utility {
+	//Decodes UTF-8 straight into UTF-16 without an intermediate copy. out needs room for utf8.size() code units, which is the most it can take.
+	//Returns the number of code units written. Every maximal invalid sequence becomes one U+FFFD as recommended by Unicode.
+	//Runs of ASCII are validated and widened 16 bytes at a time with SSE2 where available, other characters are decoded with table lookups in the
+	//same loop, so invalid input costs no more than valid input.
+	std::size_t decode_utf8(std::string_view utf8, char16_t *out);
+} // namespace Utility
+
+#endif // UTF8_DECODER_H